@@ -4,6 +4,7 @@
       "use_vl32%": "false",
       "use_fixed_size%": "false",
       "use_posix_semaphores%": "false",
+      "use_io_uring%": "false",
       "openssl_fips": ""
   },
   "targets": [
@@ -35,6 +36,9 @@
                 "-Wimplicit-fallthrough=2",
               ],
             }],
+            ["use_io_uring=='true'", {
+              "defines": ["MDB_USE_IO_URING"]
+            }],
           ],
           "ldflags": [
             "-fPIC",
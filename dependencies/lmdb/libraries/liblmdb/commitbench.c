@@ -0,0 +1,115 @@
+/* commitbench.c - write transaction commit latency benchmark */
+/*
+ * Copyright 2011-2020 Howard Chu, Symas Corp.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted only as authorized by the OpenLDAP
+ * Public License.
+ *
+ * A copy of this license is available in the file LICENSE in the
+ * top-level directory of the distribution or, alternatively, at
+ * <http://www.OpenLDAP.org/license.html>.
+ */
+
+/* Runs write txns that each put a number of random keys, and reports
+ * how long mdb_txn_commit() takes, which is mostly flushing the dirty
+ * pages and syncing the data file. Build it once as is and once with
+ * XCFLAGS=-DMDB_USE_IO_URING to compare the two flush paths.
+ * Usage: commitbench [dir] [txns] [puts per txn] [value size] [nosync]
+ * With "nosync" the env is opened with MDB_NOSYNC, to time the writes alone.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "lmdb.h"
+
+#define E(expr) CHECK((rc = (expr)) == MDB_SUCCESS, #expr)
+#define CHECK(test, msg) ((test) ? (void)0 : ((void)fprintf(stderr, \
+	"%s:%d: %s: %s\n", __FILE__, __LINE__, msg, mdb_strerror(rc)), abort()))
+
+static unsigned long long seed = 1;
+
+static unsigned long long rnd(void)
+{
+	seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+	return seed >> 11;
+}
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+	return x < y ? -1 : x > y;
+}
+
+int main(int argc, char *argv[])
+{
+	const char *dir = argc > 1 ? argv[1] : "./testdb";
+	int txns = argc > 2 ? atoi(argv[2]) : 200;
+	int puts = argc > 3 ? atoi(argv[3]) : 1000;
+	int vsize = argc > 4 ? atoi(argv[4]) : 100;
+	unsigned flags = argc > 5 && !strcmp(argv[5], "nosync") ? MDB_NOSYNC : 0;
+	int i, j, rc;
+	double *lat, t, start, total = 0;
+	char *buf;
+	MDB_env *env;
+	MDB_dbi dbi;
+	MDB_txn *txn;
+	MDB_val key, data;
+	MDB_stat st;
+	unsigned long long k;
+
+	lat = malloc(txns * sizeof(double));
+	buf = calloc(1, vsize);
+	if (!lat || !buf) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+	E(mdb_env_create(&env));
+	E(mdb_env_set_mapsize(env, (size_t)1 << 34));
+	E(mdb_env_open(env, dir, flags, 0664));
+	E(mdb_txn_begin(env, NULL, 0, &txn));
+	E(mdb_dbi_open(txn, NULL, 0, &dbi));
+	E(mdb_txn_commit(txn));
+
+	start = now();
+	for (i = 0; i < txns; i++) {
+		E(mdb_txn_begin(env, NULL, 0, &txn));
+		for (j = 0; j < puts; j++) {
+			k = rnd();
+			key.mv_size = sizeof(k);
+			key.mv_data = &k;
+			memcpy(buf, &k, vsize < (int)sizeof(k) ? vsize : (int)sizeof(k));
+			data.mv_size = vsize;
+			data.mv_data = buf;
+			E(mdb_put(txn, dbi, &key, &data, 0));
+		}
+		t = now();
+		E(mdb_txn_commit(txn));
+		lat[i] = now() - t;
+		total += lat[i];
+	}
+	t = now() - start;
+
+	E(mdb_env_stat(env, &st));
+	qsort(lat, txns, sizeof(double), cmp_double);
+	printf("%d txns of %d puts, %"MDB_PRIy(u)" pages in the DB\n",
+		txns, puts, st.ms_branch_pages + st.ms_leaf_pages + st.ms_overflow_pages);
+	printf("commit ms: avg %.3f  p50 %.3f  p99 %.3f  max %.3f\n",
+		total * 1e3 / txns, lat[txns / 2] * 1e3,
+		lat[txns * 99 / 100] * 1e3, lat[txns - 1] * 1e3);
+	printf("%.1f txns/s, %.0f%% of the time in commit\n",
+		txns / t, total * 100 / t);
+	mdb_env_close(env);
+	free(lat);
+	free(buf);
+	return 0;
+}
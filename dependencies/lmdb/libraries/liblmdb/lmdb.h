@@ -505,6 +505,11 @@ typedef struct MDB_envinfo {
 	mdb_size_t	me_last_txnid;			/**< ID of the last committed transaction */
 	unsigned int me_maxreaders;		/**< max reader slots in the environment */
 	unsigned int me_numreaders;		/**< max reader slots used in the environment */
+	uint64_t	me_alloc_time;			/**< nanoseconds write txns spent searching for free pages */
+	mdb_size_t	me_arena_size;			/**< bytes of freed dirty pages kept for reuse */
+	uint64_t	me_arena_hits;			/**< dirty page allocations served from kept pages */
+	uint64_t	me_arena_misses;		/**< dirty page allocations that called malloc() */
+	uint64_t	me_arena_frees;			/**< freed dirty pages given back with free() */
 } MDB_envinfo;
 
 	/** @brief Return the LMDB library version information.
@@ -721,6 +726,8 @@ int  mdb_env_copyfd(MDB_env *env, mdb_filehandle_t fd);
 	 *		pages and sequentially renumber all pages in output. This option
 	 *		consumes more CPU and runs more slowly than the default.
 	 *		Currently it fails if the environment has suffered a page leak.
+	 *		Large environments copied to a regular file are split into
+	 *		subtrees which are copied by several threads at once.
 	 * </ul>
 	 * @return A non-zero error value on failure and 0 on success.
 	 */
@@ -745,6 +752,75 @@ int  mdb_env_copy2(MDB_env *env, const char *path, unsigned int flags);
 	 */
 int  mdb_env_copyfd2(MDB_env *env, mdb_filehandle_t fd, unsigned int flags);
 
+	/** @brief A callback function reporting the progress of a copy.
+	 *
+	 * It is called by the thread writing the copy after each chunk
+	 * (of at most 1MB with #MDB_CP_COMPACT), so it may also slow
+	 * the copy down.
+	 * @param[in] ctx An arbitrary context pointer for the callback.
+	 * @param[in] done The number of bytes written so far.
+	 * @param[in] total The number of bytes the copy will have.
+	 * @return 0 to continue, or an error code to fail the copy with.
+	 */
+typedef int (MDB_copy_func)(void *ctx, mdb_size_t done, mdb_size_t total);
+
+	/** @brief Copy an LMDB environment to the specified file descriptor,
+	 *	with options and progress reports.
+	 *
+	 * This is #mdb_env_copyfd2(), calling \b func as the copy proceeds.
+	 * The read-only transaction of the copy stays open until it is done,
+	 * so a slow copy keeps old pages from being reused for longer.
+	 * @param[in] env An environment handle returned by #mdb_env_create(). It
+	 * must have already been opened successfully.
+	 * @param[in] fd The filedescriptor to write the copy to. It must
+	 * have already been opened for Write access.
+	 * @param[in] flags Special options for this operation.
+	 * See #mdb_env_copy2() for options.
+	 * @param[in] func A #MDB_copy_func function, or NULL.
+	 * @param[in] ctx Anything the copy function needs
+	 * @return A non-zero error value on failure and 0 on success.
+	 */
+int  mdb_env_copyfd3(MDB_env *env, mdb_filehandle_t fd, unsigned int flags,
+	MDB_copy_func *func, void *ctx);
+
+	/** @brief Make a compacted copy of an LMDB environment for #mdb_env_compact_swap().
+	 *
+	 * This is #mdb_env_copy2() with #MDB_CP_COMPACT, which also reports
+	 * whether the copy still matches the environment. It may run in
+	 * parallel with write transactions.
+	 * @param[in] env An environment handle returned by #mdb_env_create(). It
+	 * must have already been opened successfully.
+	 * @param[in] path Where to write the copy, like for #mdb_env_copy2().
+	 * @param[out] txnid The ID of the transaction the copy holds, or 0 if
+	 * write transactions committed while copying.
+	 * @return A non-zero error value on failure and 0 on success.
+	 */
+int  mdb_env_compact_copy(MDB_env *env, const char *path, mdb_size_t *txnid);
+
+	/** @brief Replace the data file of an LMDB environment by a compacted copy.
+	 *
+	 * The copy made by #mdb_env_compact_copy() is renamed over the data file
+	 * and mapped instead of it, so the file shrinks to the size of the data
+	 * it holds. If write transactions committed since the copy was made,
+	 * the copy is made again first, holding the write lock. The call fails
+	 * if transactions of this process are active or another process has
+	 * the environment open. Read transactions that begin meanwhile, in any
+	 * thread, wait until the copy is mapped. Not supported on Windows and
+	 * with MDB_VL32.
+	 * @param[in] env An environment handle returned by #mdb_env_create(). It
+	 * must have already been opened successfully, without #MDB_RDONLY.
+	 * @param[in] path The path the copy was written to.
+	 * @param[in] txnid The transaction ID from #mdb_env_compact_copy().
+	 * @return A non-zero error value on failure and 0 on success. Some possible
+	 * errors are:
+	 * <ul>
+	 *	<li>EBUSY - another process uses the environment, or a transaction
+	 *	of this process is active.
+	 *	<li>EINVAL - the environment is read-only or has no lockfile.
+	 * </ul>
+	 */
+int  mdb_env_compact_swap(MDB_env *env, const char *path, mdb_size_t txnid);
+
 	/** @brief Return statistics about the LMDB environment.
 	 *
 	 * @param[in] env An environment handle returned by #mdb_env_create()
@@ -884,6 +960,70 @@ int  mdb_env_get_fd(MDB_env *env, mdb_filehandle_t *fd);
 	 */
 int  mdb_env_set_mapsize(MDB_env *env, mdb_size_t size);
 
+	/** @brief Let the memory map grow automatically when it gets full.
+	 *
+	 * Address space for \b upper bytes is reserved when the environment
+	 * is opened, and the map grows within it instead of failing with
+	 * #MDB_MAP_FULL. Growing in place keeps all pointers into the map
+	 * valid, so it happens while transactions are active, also in other
+	 * threads. Only the writer resizes the map, and with #MDB_WRITEMAP
+	 * extends the file. Read transactions that find the environment
+	 * grown by another process read the new pages within the reservation
+	 * instead of returning #MDB_MAP_RESIZED, and the next write
+	 * transaction adopts the new size. Growth persists like an increase by
+	 * #mdb_env_set_mapsize(). Not supported on Windows and with MDB_VL32,
+	 * where the call has no effect.
+	 *
+	 * This function may only be called after #mdb_env_create() and before
+	 * #mdb_env_open().
+	 * @param[in] env An environment handle returned by #mdb_env_create()
+	 * @param[in] upper The maximum size of the map in bytes
+	 * @param[in] step Bytes to add on each growth, or 0 to grow geometrically
+	 * @param[in] percent Size after a geometric growth, in percent of the
+	 * size before (e.g. 200 to double it)
+	 * @return A non-zero error value on failure and 0 on success. Some possible
+	 * errors are:
+	 * <ul>
+	 *	<li>EINVAL - an invalid parameter was specified, or the environment is
+	 *	already open.
+	 * </ul>
+	 */
+int  mdb_env_set_mapgrowth(MDB_env *env, mdb_size_t upper, mdb_size_t step, unsigned int percent);
+
+	/** @brief Set how much dirty data a write transaction may hold in memory.
+	 *
+	 * A write transaction keeps the pages it changed in memory until it
+	 * commits. When there are too many of them, it writes some out to the
+	 * map early ("spilling"), and a nested transaction which still needs
+	 * them returns #MDB_TXN_FULL. The dirty page list grows as needed up
+	 * to \b size bytes of pages, so large transactions and nested
+	 * transactions can avoid both. The default and minimum is 131071 pages.
+	 *
+	 * This function may be called at any time. The new size takes effect
+	 * when the next write transaction starts.
+	 * @param[in] env An environment handle returned by #mdb_env_create()
+	 * @param[in] size The maximum size of a transaction's dirty pages, in bytes
+	 * @return A non-zero error value on failure and 0 on success.
+	 */
+int  mdb_env_set_dirtysize(MDB_env *env, mdb_size_t size);
+
+	/** @brief Set how much memory the environment keeps for dirty pages.
+	 *
+	 * Write transactions copy the pages they change into malloc'd memory.
+	 * When a transaction ends, those chunks are kept for reuse by later
+	 * write transactions, sorted by size, up to 16 pages per chunk and
+	 * \b size bytes in total. Larger chunks and any excess are given back
+	 * with free(). The default is 64MB. #mdb_env_info() reports how
+	 * often allocations were served this way.
+	 *
+	 * This function may be called at any time. Chunks kept under a larger
+	 * size are released once they have been reused.
+	 * @param[in] env An environment handle returned by #mdb_env_create()
+	 * @param[in] size The maximum size of the kept chunks, in bytes
+	 * @return A non-zero error value on failure and 0 on success.
+	 */
+int  mdb_env_set_arenasize(MDB_env *env, mdb_size_t size);
+
 	/** @brief Set the maximum number of threads/reader slots for the environment.
 	 *
 	 * This defines the number of slots in the lock table that is used to track readers in the
@@ -915,6 +1055,25 @@ int  mdb_env_set_maxreaders(MDB_env *env, unsigned int readers);
 	 */
 int  mdb_env_get_maxreaders(MDB_env *env, unsigned int *readers);
 
+	/** @brief Set the page size for a new environment.
+	 *
+	 * Larger pages hold more and larger items, so trees are shallower and
+	 * fewer values need overflow pages. The default is the OS page size.
+	 * The size is stored in the data file, so this only has an effect when
+	 * #mdb_env_open() creates the file. Existing environments and copies
+	 * made by #mdb_env_copy2() keep the page size of the original.
+	 * This function may only be called after #mdb_env_create() and before #mdb_env_open().
+	 * @param[in] env An environment handle returned by #mdb_env_create()
+	 * @param[in] size The page size in bytes: a power of two, at least the
+	 * OS page size and at most 32768 (65536 with MDB_DEVEL).
+	 * @return A non-zero error value on failure and 0 on success. Some possible
+	 * errors are:
+	 * <ul>
+	 *	<li>EINVAL - an invalid parameter was specified, or the environment is already open.
+	 * </ul>
+	 */
+int  mdb_env_set_pagesize(MDB_env *env, unsigned int size);
+
 	/** @brief Set the maximum number of named databases for the environment.
 	 *
 	 * This function is only needed if multiple databases will be used in the
@@ -922,9 +1081,10 @@ int  mdb_env_get_maxreaders(MDB_env *env, unsigned int *readers);
 	 * unnamed database can ignore this option.
 	 * This function may only be called after #mdb_env_create() and before #mdb_env_open().
 	 *
-	 * Currently a moderate number of slots are cheap but a huge number gets
-	 * expensive: 7-120 words per transaction, and every #mdb_dbi_open()
-	 * does a linear search of the opened slots.
+	 * Each slot reserves 7-120 words of memory per transaction, but a
+	 * transaction only sets up the slots it actually uses, and
+	 * #mdb_dbi_open() finds opened names through a hash table, so
+	 * thousands of slots are affordable.
 	 * @param[in] env An environment handle returned by #mdb_env_create()
 	 * @param[in] dbs The maximum number of databases
 	 * @return A non-zero error value on failure and 0 on success. Some possible
@@ -1022,6 +1182,21 @@ int  mdb_txn_begin(MDB_env *env, MDB_txn *parent, unsigned int flags, MDB_txn **
 	 */
 MDB_env *mdb_txn_env(MDB_txn *txn);
 
+	/** @brief Create a read-only transaction on the snapshot of another one.
+	 *
+	 * The new transaction reads the same MVCC version as \b src, and uses
+	 * its own reader slot to keep the pages of that version alive, so it
+	 * may outlive \b src and be used by another thread.
+	 * @param[in] env An environment handle returned by #mdb_env_create()
+	 * @param[in] src An active read-only transaction of \b env. The caller
+	 * must make sure it is not ended or reset during this call.
+	 * @param[out] ret Address where the new #MDB_txn handle will be stored
+	 * @return A non-zero error value on failure and 0 on success. Errors
+	 * are the same as for #mdb_txn_begin(), and EINVAL if \b src is not
+	 * an active read-only transaction of \b env.
+	 */
+int  mdb_txn_begin_snapshot(MDB_env *env, MDB_txn *src, MDB_txn **ret);
+
 	/** @brief Return the transaction's ID.
 	 *
 	 * This returns the identifier associated with this transaction. For a
@@ -1456,6 +1631,26 @@ void mdb_cursor_close(MDB_cursor *cursor);
 	 */
 int  mdb_cursor_renew(MDB_txn *txn, MDB_cursor *cursor);
 
+	/** @brief Read ahead sibling pages while the cursor scans the database.
+	 *
+	 * When #MDB_NEXT or #MDB_PREV moves the cursor to another leaf page,
+	 * the next \b pages leaf pages in the same direction are requested
+	 * from the OS, so that a scan of data which is not in memory reads
+	 * several pages at once instead of faulting them in one by one.
+	 * Only leaf pages under the same branch page are read ahead, and
+	 * overflow pages of large values are not.
+	 * The setting is reset by #mdb_cursor_renew(). It has no effect with
+	 * MDB_VL32.
+	 * @param[in] cursor A cursor handle returned by #mdb_cursor_open()
+	 * @param[in] pages The number of pages to read ahead, or 0 to turn it off
+	 * @return A non-zero error value on failure and 0 on success. Some possible
+	 * errors are:
+	 * <ul>
+	 *	<li>EINVAL - an invalid parameter was specified.
+	 * </ul>
+	 */
+int  mdb_cursor_readahead(MDB_cursor *cursor, unsigned int pages);
+
 	/** @brief Return the cursor's transaction handle.
 	 *
 	 * @param[in] cursor A cursor handle returned by #mdb_cursor_open()
@@ -1589,6 +1784,57 @@ int  mdb_cursor_del(MDB_cursor *cursor, unsigned int flags);
 	 */
 int  mdb_cursor_count(MDB_cursor *cursor, mdb_size_t *countp);
 
+	/** @brief Estimate the number of keys in a range.
+	 *
+	 * The estimate is computed from the root-to-leaf paths of the two
+	 * range boundaries, so it costs O(depth) page accesses regardless of
+	 * the size of the range. Keys on the two boundary leaves are counted
+	 * exactly; the contents of the pages between them are extrapolated from
+	 * the fan-out of the boundary pages. For #MDB_DUPSORT databases, each
+	 * key is counted once regardless of its number of data items.
+	 * @param[in] txn A transaction handle returned by #mdb_txn_begin()
+	 * @param[in] dbi A database handle returned by #mdb_dbi_open()
+	 * @param[in] start The first key of the range (inclusive), or NULL
+	 * to start at the first key of the database.
+	 * @param[in] end The end of the range (exclusive), or NULL to
+	 * end after the last key of the database.
+	 * @param[out] countp Address where the estimated count will be stored.
+	 * @param[out] errorp Optional address where the number of keys that
+	 * were extrapolated rather than counted will be stored. Zero means
+	 * the estimate is exact.
+	 * @return A non-zero error value on failure and 0 on success. Some possible
+	 * errors are:
+	 * <ul>
+	 *	<li>EINVAL - an invalid parameter was specified.
+	 * </ul>
+	 */
+int  mdb_estimate_range(MDB_txn *txn, MDB_dbi dbi, MDB_val *start, MDB_val *end,
+	mdb_size_t *countp, mdb_size_t *errorp);
+
+	/** @brief Find keys that split a database into parts of similar size.
+	 *
+	 * This reads only the branch pages near the root: it descends to the
+	 * first level of the tree with more than the requested number of
+	 * entries and picks evenly spaced keys of that level. Parts are thus
+	 * balanced by the number of pages below each key, not by an exact
+	 * count of keys. The returned keys point into the map and are only
+	 * valid for the lifetime of the transaction.
+	 * @param[in] txn A transaction handle returned by #mdb_txn_begin()
+	 * @param[in] dbi A database handle returned by #mdb_dbi_open()
+	 * @param[out] keys An array of at least *countp elements to store the
+	 * split keys in, in ascending order.
+	 * @param[in,out] countp On input the number of split keys wanted,
+	 * on output the number of keys found. This is smaller than requested
+	 * for databases with fewer entries.
+	 * @return A non-zero error value on failure and 0 on success. Some possible
+	 * errors are:
+	 * <ul>
+	 *	<li>EINVAL - an invalid parameter was specified.
+	 *	<li>ENOMEM - out of memory.
+	 * </ul>
+	 */
+int  mdb_split_points(MDB_txn *txn, MDB_dbi dbi, MDB_val *keys, unsigned int *countp);
+
 	/** @brief Compare two data items according to a particular database.
 	 *
 	 * This returns a comparison as if the two data items were keys in the
@@ -130,6 +130,19 @@ extern int cacheflush(char *addr, int nbytes, int cache);
 #define	BROKEN_FDATASYNC
 #endif
 
+#if defined(MDB_USE_IO_URING) && !defined(__linux)
+#undef MDB_USE_IO_URING
+#endif
+#ifdef MDB_USE_IO_URING
+/** Define MDB_USE_IO_URING to let #mdb_page_flush() submit the
+ *	writes of a commit, and the data file sync that follows them,
+ *	to an io_uring instead of writing synchronously. The kernel
+ *	must be 5.5 or newer; otherwise the ordinary writes are used.
+ */
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#endif
+
 #include <errno.h>
 #include <limits.h>
 #include <stddef.h>
@@ -260,6 +273,18 @@ union semun {
 #define ESECT
 #endif
 
+#ifdef __GNUC__
+/** Hint that memory at \b p will be read soon */
+# define MDB_PREFETCH(p)	__builtin_prefetch(p)
+#else
+# define MDB_PREFETCH(p)	((void)0)
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+# include <emmintrin.h>
+# define MDB_SSE2	1
+#endif
+
 #ifdef _WIN32
 #define CALL_CONV WINAPI
 #else
@@ -1290,6 +1315,11 @@ struct MDB_txn {
 		/** For read txns: This thread/txn's reader table slot, or NULL. */
 		MDB_reader	*reader;
 	} mt_u;
+	/** Sorted dirty pages which did not go at the end of dirty_list.
+	 *	They are merged into it #MDB_DL_PEND at a time, so a large
+	 *	dirty_list is not shifted for each one. NULL with MDB_WRITEMAP.
+	 */
+	MDB_ID2L	mt_dirty_pend;
 	/** Array of records for each DB known in the environment. */
 	MDB_dbx		*mt_dbxs;
 	/** Array of MDB_db records for each known DB */
@@ -1306,11 +1336,19 @@ struct MDB_txn {
 #define DB_VALID	0x08		/**< DB handle is valid, see also #MDB_VALID */
 #define DB_USRVALID	0x10		/**< As #DB_VALID, but not set for #FREE_DBI */
 #define DB_DUPDATA	0x20		/**< DB is #MDB_DUPSORT data */
+#define DB_TOUCHED	0x40		/**< DB is set up in this txn, see #mdb_dbi_touch() */
 /** @} */
 	/** In write txns, array of cursors for each DB */
 	MDB_cursor	**mt_cursors;
 	/** Array of flags for each DB */
 	unsigned char	*mt_dbflags;
+	/** The DBs set up in this txn: the core DBs, then named DBs in the
+	 *	order they were first used. Only these have #DB_TOUCHED, and
+	 *	only their #mt_dbs, #mt_dbflags and #mt_cursors entries are valid.
+	 */
+	MDB_dbi		*mt_dbtouch;
+	/** Number of entries in #mt_dbtouch */
+	MDB_dbi		mt_numtouch;
 #ifdef MDB_VL32
 	/** List of read-only pages (actually chunks) */
 	MDB_ID3L	mt_rpages;
@@ -1350,7 +1388,7 @@ struct MDB_txn {
 #define MDB_TXN_BLOCKED		(MDB_TXN_FINISHED|MDB_TXN_ERROR|MDB_TXN_HAS_CHILD)
 /** @} */
 	unsigned int	mt_flags;		/**< @ref mdb_txn */
-	/** #dirty_list room: Array size - \#dirty pages visible to this txn.
+	/** #dirty_list room: #MDB_env.me_dirty_max - \#dirty pages visible to this txn.
 	 *	Includes ancestor txns' dirty pages not hidden by other txns'
 	 *	dirty/spilled pages. Thus commit(nested txn) has room to merge
 	 *	dirty_list into mt_parent after freeing hidden mt_parent pages.
@@ -1358,6 +1396,21 @@ struct MDB_txn {
 	unsigned int	mt_dirty_room;
 };
 
+	/** Number of dirty pages kept apart before merging, see #MDB_txn.mt_dirty_pend */
+#define MDB_DL_PEND	4096
+
+	/** Largest chunk, in pages, that #mdb_page_free() keeps for reuse.
+	 *	#MDB_env.me_dpages has a list for each size up to this.
+	 */
+#ifndef MDB_ARENA_CLASSES
+#define MDB_ARENA_CLASSES	16
+#endif
+
+	/** Default for #mdb_env_set_arenasize(), in bytes */
+#ifndef MDB_ARENA_SIZE
+#define MDB_ARENA_SIZE	(64 << 20)
+#endif
+
 /** Enough space for 2^32 nodes with minimum of 2 keys per node. I.e., plenty.
  * At 4 keys per node, enough for 2^64 nodes, so there's probably no need to
  * raise this on a 64 bit machine.
@@ -1411,6 +1464,9 @@ struct MDB_cursor {
 #define C_ORIG_RDONLY	MDB_TXN_RDONLY
 /** @} */
 	unsigned int	mc_flags;	/**< @ref mdb_cursor */
+	unsigned int	mc_ra;		/**< sibling pages to read ahead, see #mdb_cursor_readahead() */
+	MDB_page	*mc_ra_pg;		/**< branch page whose children were read ahead */
+	int			mc_ra_ki;		/**< last index in mc_ra_pg read ahead */
 	MDB_page	*mc_pg[CURSOR_STACK];	/**< stack of pushed pages */
 	indx_t		mc_ki[CURSOR_STACK];	/**< stack of page indices */
 #ifdef MDB_VL32
@@ -1462,6 +1518,64 @@ typedef struct MDB_pgstate {
 	txnid_t		mf_pglast;	/**< ID of last used record, or 0 if !mf_pghead */
 } MDB_pgstate;
 
+	/** A run of consecutive page numbers in me_pghead, in an #MDB_pgruns.
+	 *	Single-page allocations take the lowest pages in me_pghead without
+	 *	updating the index, so the low end of a run may already be used.
+	 *	Such pages never return to me_pghead while the index is valid.
+	 */
+typedef struct MDB_prnode {
+	pgno_t		pn_lo;		/**< first page, or an already used page below it */
+	pgno_t		pn_hi;		/**< last page of the run, the search key */
+	pgno_t		pn_max;		/**< longest run in this subtree */
+	unsigned	pn_left;	/**< left child, or next free node */
+	unsigned	pn_right;	/**< right child */
+	unsigned	pn_prio;	/**< random treap priority */
+} MDB_prnode;
+
+	/** Index of the runs of at least two pages in me_pghead, so
+	 *	#mdb_page_alloc() need not scan the whole list for a contiguous
+	 *	range. It is a treap ordered by run, with each node also holding
+	 *	the longest run in its subtree.
+	 */
+typedef struct MDB_pgruns {
+	MDB_prnode	*pr_nodes;	/**< node pool, node 0 is unused */
+	unsigned	pr_root;	/**< root node, or 0 if empty */
+	unsigned	pr_free;	/**< list of free nodes */
+	unsigned	pr_next;	/**< first never used node */
+	unsigned	pr_size;	/**< number of nodes in pool */
+	unsigned	pr_seed;	/**< priority generator state */
+	int			pr_valid;	/**< index matches me_pghead */
+	mdb_size_t	pr_scanned;	/**< entries scanned by this txn without the index */
+} MDB_pgruns;
+
+#ifdef MDB_USE_IO_URING
+	/** Number of writes #mdb_page_flush() keeps in flight on the
+	 *	io_uring, each of up to #MDB_COMMIT_PAGES pages.
+	 */
+#ifndef MDB_URING_DEPTH
+#define MDB_URING_DEPTH	64
+#endif
+
+	/** An io_uring for the writes of #mdb_page_flush(), set up by
+	 *	the first flush. If that fails, #ur_fd is -1 and later flushes
+	 *	write synchronously.
+	 */
+typedef struct MDB_uring {
+	int			ur_fd;		/**< the ring, or -1 */
+	unsigned	ur_depth;	/**< number of SQ entries */
+	unsigned	ur_queued;	/**< SQEs not yet submitted */
+	unsigned	ur_inflight;	/**< SQEs not yet completed */
+	int			ur_err;		/**< first error since the last #mdb_uring_wait() */
+	unsigned	*ur_sqtail, *ur_sqmask, *ur_sqarray;
+	unsigned	*ur_cqhead, *ur_cqtail, *ur_cqmask;
+	struct io_uring_sqe	*ur_sqes;
+	struct io_uring_cqe	*ur_cqes;
+	void		*ur_sqmap, *ur_cqmap;	/**< the ring mappings */
+	size_t		ur_sqlen, ur_cqlen, ur_sqelen;	/**< their lengths */
+	struct iovec	*ur_iov;	/**< #MDB_COMMIT_PAGES iovecs per SQE */
+} MDB_uring;
+#endif
+
 	/** The database environment. */
 struct MDB_env {
 	HANDLE		me_fd;		/**< The main data file */
@@ -1482,11 +1596,13 @@ struct MDB_env {
 	/** fdatasync is unreliable */
 #define	MDB_FSYNCONLY	0x08000000U
 	uint32_t 	me_flags;		/**< @ref mdb_env */
-	unsigned int	me_psize;	/**< DB page size, inited from me_os_psize */
+	unsigned int	me_psize;	/**< DB page size, inited from me_os_psize or #mdb_env_set_pagesize() */
 	unsigned int	me_os_psize;	/**< OS page size, from #GET_PAGESIZE */
 	unsigned int	me_maxreaders;	/**< size of the reader table */
 	/** Max #MDB_txninfo.%mti_numreaders of interest to #mdb_env_close() */
 	volatile int	me_close_readers;
+	/** Set by #mdb_env_compact_swap() while it holds me_rmutex to replace the map */
+	volatile int	me_swapping;
 	MDB_dbi		me_numdbs;		/**< number of DBs opened */
 	MDB_dbi		me_maxdbs;		/**< size of the DB table */
 	MDB_PID_T	me_pid;		/**< process ID of this env */
@@ -1498,9 +1614,16 @@ struct MDB_env {
 	MDB_txn		*me_txn;		/**< current write transaction */
 	MDB_txn		*me_txn0;		/**< prealloc'd write transaction */
 	mdb_size_t	me_mapsize;		/**< size of the data memory map */
-	MDB_OFF_T	me_size;		/**< current file size */
+	mdb_size_t	me_maplen;		/**< length of the mapping, >= me_mapsize */
+	mdb_size_t	me_mapupper;	/**< address space reserved for growth */
+	mdb_size_t	me_growstep;	/**< bytes added by each growth, or 0 */
+	unsigned int	me_growpct;	/**< size after a geometric growth, in percent */
+	MDB_OFF_T	me_size;		/**< file size the writer made sure of, with #MDB_WRITEMAP */
 	pgno_t		me_maxpg;		/**< me_mapsize / me_psize */
 	MDB_dbx		*me_dbxs;		/**< array of static DB info */
+	MDB_dbi		*me_dbhash;		/**< open-addressed index of me_dbxs names, 0 if empty */
+	unsigned int	me_dbhmask;		/**< size of me_dbhash - 1 */
+	MDB_dbi		me_dbfree;		/**< all names below this slot are in use */
 	uint16_t	*me_dbflags;	/**< array of flags from MDB_db.md_flags */
 	unsigned int	*me_dbiseqs;	/**< array of dbi sequence numbers */
 	pthread_key_t	me_txkey;	/**< thread-key for readers */
@@ -1508,11 +1631,25 @@ struct MDB_env {
 	MDB_pgstate	me_pgstate;		/**< state of old pages from freeDB */
 #	define		me_pglast	me_pgstate.mf_pglast
 #	define		me_pghead	me_pgstate.mf_pghead
-	MDB_page	*me_dpages;		/**< list of malloc'd blocks for re-use */
+	MDB_pgruns	me_pgruns;		/**< index of page runs in me_pghead */
+	uint64_t	me_alloc_time;	/**< nanoseconds spent searching for free pages */
+	/** Malloc'd chunks for re-use: me_dpages[n-1] lists chunks of n pages */
+	MDB_page	*me_dpages[MDB_ARENA_CLASSES];
+	mdb_size_t	me_arena_size;	/**< bytes of pages in me_dpages */
+	mdb_size_t	me_arena_max;	/**< max me_arena_size, see #mdb_env_set_arenasize() */
+	uint64_t	me_arena_hits;	/**< page allocations served from me_dpages */
+	uint64_t	me_arena_misses;	/**< page allocations that called malloc() */
+	uint64_t	me_arena_frees;	/**< freed chunks given back to free() */
 	/** IDL of pages that became unused in a write txn */
 	MDB_IDL		me_free_pgs;
-	/** ID2L of pages written during a write txn. Length MDB_IDL_UM_SIZE. */
+	/** ID2L of pages written during a write txn. Grows as needed. */
 	MDB_ID2L	me_dirty_list;
+	/** Pending part of me_dirty_list, see #MDB_txn.mt_dirty_pend */
+	MDB_ID2L	me_dirty_pend;
+	/** Bytes of dirty pages a write txn may keep before spilling */
+	mdb_size_t	me_dirty_size;
+	/** Max dirty pages of a write txn, from me_dirty_size */
+	unsigned int	me_dirty_max;
 	/** Max number of freelist items that can fit in a single overflow page */
 	int			me_maxfree_1pg;
 	/** Max size of a node on a page */
@@ -1526,6 +1663,9 @@ struct MDB_env {
 	OVERLAPPED	*ov;			/**< Used for for overlapping I/O requests */
 	int		ovs;				/**< Count of OVERLAPPEDs */
 #endif
+#ifdef MDB_USE_IO_URING
+	MDB_uring	*me_uring;		/**< io_uring for page writes, or NULL */
+#endif
 #ifdef MDB_USE_POSIX_MUTEX	/* Posix mutexes reside in shared mem */
 #	define		me_rmutex	me_txns->mti_rmutex /**< Shared reader lock */
 #	define		me_wmutex	me_txns->mti_wmutex /**< Shared writer lock */
@@ -1564,9 +1704,13 @@ typedef struct MDB_ntxn {
 	/** max bytes to write in one call */
 #define MAX_WRITE		(0x40000000U >> (sizeof(ssize_t) == 4))
 
-	/** Check \b txn and \b dbi arguments to a function */
+	/** Check \b txn and \b dbi arguments to a function.
+	 *	Sets up the DB in \b txn on first use.
+	 */
 #define TXN_DBI_EXIST(txn, dbi, validity) \
-	((txn) && (dbi)<(txn)->mt_numdbs && ((txn)->mt_dbflags[dbi] & (validity)))
+	((txn) && (dbi)<(txn)->mt_numdbs && \
+	 (((txn)->mt_dbflags[dbi] & DB_TOUCHED) || mdb_dbi_touch(txn, dbi)) && \
+	 ((txn)->mt_dbflags[dbi] & (validity)))
 
 	/** Check for misused \b dbi handles */
 #define TXN_DBI_CHANGED(txn, dbi) \
@@ -1607,6 +1751,8 @@ static int	mdb_page_split(MDB_cursor *mc, MDB_val *newkey, MDB_val *newdata,
 static int  mdb_env_read_header(MDB_env *env, int prev, MDB_meta *meta);
 static MDB_meta *mdb_env_pick_meta(const MDB_env *env);
 static int  mdb_env_write_meta(MDB_txn *txn);
+static int  mdb_env_grow(MDB_env *env, pgno_t maxpg);
+static int  mdb_fsize(HANDLE fd, mdb_size_t *size);
 #if defined(MDB_USE_POSIX_MUTEX) && !defined(MDB_ROBUST_SUPPORTED) /* Drop unused excl arg */
 # define mdb_env_close0(env, excl) mdb_env_close1(env)
 #endif
@@ -1645,6 +1791,8 @@ static void	mdb_xcursor_init2(MDB_cursor *mc, MDB_xcursor *src_mx, int force);
 
 static int	mdb_drop0(MDB_cursor *mc, int subs);
 static void mdb_default_cmp(MDB_txn *txn, MDB_dbi dbi);
+static int  mdb_dbi_touch(MDB_txn *txn, MDB_dbi dbi);
+static void mdb_dbi_unhash(MDB_env *env, MDB_dbi dbi);
 static int mdb_reader_check0(MDB_env *env, int rlocked, int *dead);
 
 /** @cond */
@@ -1945,7 +2093,7 @@ static void mdb_audit(MDB_txn *txn)
 	count = 0;
 	for (i = 0; i<txn->mt_numdbs; i++) {
 		MDB_xcursor mx;
-		if (!(txn->mt_dbflags[i] & DB_VALID))
+		if (!TXN_DBI_EXIST(txn, i, DB_VALID))
 			continue;
 		mdb_cursor_init(&mc, txn, i, &mx);
 		if (txn->mt_dbs[i].md_root == P_INVALID)
@@ -1996,32 +2144,34 @@ mdb_dcmp(MDB_txn *txn, MDB_dbi dbi, const MDB_val *a, const MDB_val *b)
 }
 
 /** Allocate memory for a page.
- * Re-use old malloc'd pages first for singletons, otherwise just malloc.
+ * Re-use an old malloc'd chunk of the same size first, otherwise just malloc.
  * Set #MDB_TXN_ERROR on failure.
  */
 static MDB_page *
 mdb_page_malloc(MDB_txn *txn, unsigned num)
 {
 	MDB_env *env = txn->mt_env;
-	MDB_page *ret = env->me_dpages;
-	size_t psize = env->me_psize, sz = psize, off;
+	MDB_page *ret;
+	size_t psize = env->me_psize, sz = psize * num, off;
+
+	if (num <= MDB_ARENA_CLASSES && (ret = env->me_dpages[num-1]) != NULL) {
+		VGMEMP_ALLOC(env, ret, sz);
+		VGMEMP_DEFINED(ret, sizeof(ret->mp_next));
+		env->me_dpages[num-1] = ret->mp_next;
+		env->me_arena_size -= sz;
+		env->me_arena_hits++;
+		return ret;
+	}
+	env->me_arena_misses++;
 	/* For ! #MDB_NOMEMINIT, psize counts how much to init.
 	 * For a single page alloc, we init everything after the page header.
 	 * For multi-page, we init the final page; if the caller needed that
 	 * many pages they will be filling in at least up to the last page.
 	 */
-	if (num == 1) {
-		if (ret) {
-			VGMEMP_ALLOC(env, ret, sz);
-			VGMEMP_DEFINED(ret, sizeof(ret->mp_next));
-			env->me_dpages = ret->mp_next;
-			return ret;
-		}
+	if (num == 1)
 		psize -= off = PAGEHDRSZ;
-	} else {
-		sz *= num;
+	else
 		off = sz - psize;
-	}
 	if ((ret = malloc(sz)) != NULL) {
 		VGMEMP_ALLOC(env, ret, sz);
 		if (!(env->me_flags & MDB_NOMEMINIT)) {
@@ -2033,29 +2183,110 @@ mdb_page_malloc(MDB_txn *txn, unsigned num)
 	}
 	return ret;
 }
-/** Free a single page.
- * Saves single pages to a list, for future reuse.
- * (This is not used for multi-page overflow pages.)
+/** Free a chunk of \b num pages from #mdb_page_malloc().
+ * Saves it to the list for its size, for future reuse, unless
+ * it is too large or that would exceed #MDB_env.me_arena_max.
  */
 static void
-mdb_page_free(MDB_env *env, MDB_page *mp)
+mdb_page_free(MDB_env *env, MDB_page *mp, unsigned num)
 {
-	mp->mp_next = env->me_dpages;
+	size_t sz = (size_t)env->me_psize * num;
+
+	if (num > MDB_ARENA_CLASSES || env->me_arena_size + sz > env->me_arena_max) {
+		VGMEMP_FREE(env, mp);
+		free(mp);
+		env->me_arena_frees++;
+		return;
+	}
+	mp->mp_next = env->me_dpages[num-1];
 	VGMEMP_FREE(env, mp);
-	env->me_dpages = mp;
+	env->me_dpages[num-1] = mp;
+	env->me_arena_size += sz;
 }
 
 /** Free a dirty page */
 static void
 mdb_dpage_free(MDB_env *env, MDB_page *dp)
 {
-	if (!IS_OVERFLOW(dp) || dp->mp_pages == 1) {
-		mdb_page_free(env, dp);
-	} else {
-		/* large pages just get freed directly */
-		VGMEMP_FREE(env, dp);
-		free(dp);
+	mdb_page_free(env, dp, IS_OVERFLOW(dp) ? dp->mp_pages : 1);
+}
+
+/** Merge the pending dirty pages into the dirty list.
+ *	#mdb_dlist_add() keeps room for them, so this cannot fail.
+ */
+static void
+mdb_dlist_sync(MDB_txn *txn)
+{
+	MDB_ID2L dl = txn->mt_u.dirty_list, pl = txn->mt_dirty_pend;
+	unsigned i, j, k, n;
+
+	if (!pl || !(j = pl[0].mid))
+		return;
+	i = dl[0].mid;
+	k = n = i + j;
+	dl[0].mid = 0;		/* below any pgno, ends the loop */
+	while (j) {
+		if (dl[i].mid > pl[j].mid)
+			dl[k--] = dl[i--];
+		else
+			dl[k--] = pl[j--];
+	}
+	dl[0].mid = n;
+	pl[0].mid = 0;
+}
+
+/** Add a page to the txn's dirty list, growing it as needed.
+ *	A page which does not go at the end goes to #MDB_txn.mt_dirty_pend.
+ * @param[in] txn the transaction.
+ * @param[in] id the page number and page.
+ * @param[in] append just append, the list need not be sorted.
+ * @return 0 on success, ENOMEM, or -1 if the page was already there.
+ */
+static int
+mdb_dlist_add(MDB_txn *txn, MDB_ID2 *id, int append)
+{
+	MDB_ID2L dl = txn->mt_u.dirty_list, pl = txn->mt_dirty_pend;
+	unsigned x, n = dl[0].mid;
+
+	if (n + (pl ? pl[0].mid : 0) >= MDB_ID2L_ALLOCLEN(dl)) {
+		if (mdb_mid2l_need(&txn->mt_u.dirty_list, (pl ? MDB_DL_PEND : 0) + 1))
+			return ENOMEM;
+		dl = txn->mt_u.dirty_list;
+		if (!txn->mt_parent)
+			txn->mt_env->me_dirty_list = dl;
+	}
+	if (append)
+		return mdb_mid2l_append(dl, id);
+	if (!pl || !n || id->mid > dl[n].mid)
+		return mdb_mid2l_insert(dl, id);
+	x = mdb_mid2l_search(dl, id->mid);
+	if (x <= n && dl[x].mid == id->mid)
+		return -1;
+	if (pl[0].mid >= MDB_DL_PEND)
+		mdb_dlist_sync(txn);
+	return mdb_mid2l_insert(pl, id);
+}
+
+/** Find a page in the txn's own dirty list.
+ * @return the dirty page, or NULL if not found.
+ */
+static MDB_page *
+mdb_dlist_find(MDB_txn *txn, pgno_t pgno)
+{
+	MDB_ID2L dl = txn->mt_u.dirty_list;
+	unsigned x;
+
+	if (dl[0].mid) {
+		x = mdb_mid2l_search(dl, pgno);
+		if (x <= dl[0].mid && dl[x].mid == pgno)
+			return dl[x].mptr;
 	}
+	if ((dl = txn->mt_dirty_pend) && dl[0].mid) {
+		x = mdb_mid2l_search(dl, pgno);
+		if (x <= dl[0].mid && dl[x].mid == pgno)
+			return dl[x].mptr;
+	}
+	return NULL;
 }
 
 /**	Return all dirty pages to dpage list */
@@ -2064,9 +2295,10 @@ mdb_dlist_free(MDB_txn *txn)
 {
 	MDB_env *env = txn->mt_env;
 	MDB_ID2L dl = txn->mt_u.dirty_list;
-	unsigned i, n = dl[0].mid;
+	unsigned i, n;
 
-	for (i = 1; i <= n; i++) {
+	mdb_dlist_sync(txn);
+	for (i = 1, n = dl[0].mid; i <= n; i++) {
 		mdb_dpage_free(env, dl[i].mptr);
 	}
 	dl[0].mid = 0;
@@ -2138,21 +2370,18 @@ mdb_page_loose(MDB_cursor *mc, MDB_page *mp)
 
 	if ((mp->mp_flags & P_DIRTY) && mc->mc_dbi != FREE_DBI) {
 		if (txn->mt_parent) {
-			MDB_ID2 *dl = txn->mt_u.dirty_list;
 			/* If txn has a parent, make sure the page is in our
 			 * dirty list.
 			 */
-			if (dl[0].mid) {
-				unsigned x = mdb_mid2l_search(dl, pgno);
-				if (x <= dl[0].mid && dl[x].mid == pgno) {
-					if (mp != dl[x].mptr) { /* bad cursor? */
-						mc->mc_flags &= ~(C_INITIALIZED|C_EOF);
-						txn->mt_flags |= MDB_TXN_ERROR;
-						return MDB_PROBLEM;
-					}
-					/* ok, it's ours */
-					loose = 1;
+			MDB_page *dp = mdb_dlist_find(txn, pgno);
+			if (dp) {
+				if (mp != dp) { /* bad cursor? */
+					mc->mc_flags &= ~(C_INITIALIZED|C_EOF);
+					txn->mt_flags |= MDB_TXN_ERROR;
+					return MDB_PROBLEM;
 				}
+				/* ok, it's ours */
+				loose = 1;
 			}
 		} else {
 			/* no parent txn, so it's just ours */
@@ -2194,7 +2423,7 @@ mdb_pages_xkeep(MDB_cursor *mc, unsigned pflags, int all)
 	int rc = MDB_SUCCESS, level;
 
 	/* Mark pages seen by cursors: First m0, then tracked cursors */
-	for (i = txn->mt_numdbs;; ) {
+	for (i = txn->mt_numtouch;; ) {
 		if (mc->mc_flags & C_INITIALIZED) {
 			for (m3 = mc;; m3 = &mx->mx_cursor) {
 				mp = NULL;
@@ -2215,7 +2444,7 @@ mdb_pages_xkeep(MDB_cursor *mc, unsigned pflags, int all)
 			}
 		}
 		mc = mc->mc_next;
-		for (; !mc || mc == m0; mc = txn->mt_cursors[--i])
+		for (; !mc || mc == m0; mc = txn->mt_cursors[txn->mt_dbtouch[--i]])
 			if (i == 0)
 				goto mark_done;
 	}
@@ -2223,7 +2452,8 @@ mdb_pages_xkeep(MDB_cursor *mc, unsigned pflags, int all)
 mark_done:
 	if (all) {
 		/* Mark dirty root pages */
-		for (i=0; i<txn->mt_numdbs; i++) {
+		for (j=0; j<txn->mt_numtouch; j++) {
+			i = txn->mt_dbtouch[j];
 			if (txn->mt_dbflags[i] & DB_DIRTY) {
 				pgno_t pgno = txn->mt_dbs[i].md_root;
 				if (pgno == P_INVALID)
@@ -2239,7 +2469,7 @@ mark_done:
 	return rc;
 }
 
-static int mdb_page_flush(MDB_txn *txn, int keep);
+static int mdb_page_flush(MDB_txn *txn, int keep, int *sync);
 
 /**	Spill pages from the dirty list back to disk.
  * This is intended to prevent running into #MDB_TXN_FULL situations,
@@ -2299,6 +2529,7 @@ mdb_page_spill(MDB_cursor *m0, MDB_val *key, MDB_val *data)
 	if (txn->mt_dirty_room > i)
 		return MDB_SUCCESS;
 
+	mdb_dlist_sync(txn);
 	if (!txn->mt_spill_pgs) {
 		txn->mt_spill_pgs = mdb_midl_alloc(MDB_IDL_UM_MAX);
 		if (!txn->mt_spill_pgs)
@@ -2326,8 +2557,8 @@ mdb_page_spill(MDB_cursor *m0, MDB_val *key, MDB_val *data)
 	 * of the dirty pages. Testing revealed this to be a good tradeoff,
 	 * better than 1/2, 1/4, or 1/10.
 	 */
-	if (need < MDB_IDL_UM_MAX / 8)
-		need = MDB_IDL_UM_MAX / 8;
+	if (need < txn->mt_env->me_dirty_max / 8)
+		need = txn->mt_env->me_dirty_max / 8;
 
 	/* Save the page IDs of all the pages we're flushing */
 	/* flush from the tail forward, this saves a lot of shifting later on. */
@@ -2360,7 +2591,7 @@ mdb_page_spill(MDB_cursor *m0, MDB_val *key, MDB_val *data)
 	mdb_midl_sort(txn->mt_spill_pgs);
 
 	/* Flush the spilled part of dirty list */
-	if ((rc = mdb_page_flush(txn, i)) != MDB_SUCCESS)
+	if ((rc = mdb_page_flush(txn, i, NULL)) != MDB_SUCCESS)
 		goto done;
 
 	/* Reset any dirty pages we kept that page_flush didn't see */
@@ -2391,26 +2622,328 @@ mdb_find_oldest(MDB_txn *txn)
 }
 
 /** Add a page to the txn's dirty list */
-static void
+static int
 mdb_page_dirty(MDB_txn *txn, MDB_page *mp)
 {
 	MDB_ID2 mid;
-	int rc, (*insert)(MDB_ID2L, MDB_ID2 *);
+	int rc, append;
 #ifdef _WIN32	/* With Windows we always write dirty pages with WriteFile,
 				 * so we always want them ordered */
-	insert = mdb_mid2l_insert;
+	append = 0;
 #else			/* but otherwise with writemaps, we just use msync, we
 				 * don't need the ordering and just append */
-	if (txn->mt_flags & MDB_TXN_WRITEMAP)
-		insert = mdb_mid2l_append;
-	else
-		insert = mdb_mid2l_insert;
+	append = txn->mt_flags & MDB_TXN_WRITEMAP;
 #endif
 	mid.mid = mp->mp_pgno;
 	mid.mptr = mp;
-	rc = insert(txn->mt_u.dirty_list, &mid);
+	rc = mdb_dlist_add(txn, &mid, append);
+	if (rc == ENOMEM)
+		return rc;
 	mdb_tassert(txn, rc == 0);
 	txn->mt_dirty_room--;
+	return MDB_SUCCESS;
+}
+
+/** @defgroup pgruns	Page Run Index
+ *	Find ranges of consecutive pages in me_pghead[], see #MDB_pgruns.
+ *	@{
+ */
+#define PR_NODE(pr, n)	((pr)->pr_nodes + (n))
+#define PR_LEN(nd)	((nd)->pn_hi - (nd)->pn_lo + 1)
+
+	/** Build the index once a txn scanned me_pghead[] this many times over */
+#define MDB_PR_SCANS	8
+
+/** Recompute the longest run in a subtree after its children changed */
+static void
+mdb_pr_fix(MDB_pgruns *pr, unsigned n)
+{
+	MDB_prnode *nd = PR_NODE(pr, n);
+	pgno_t max = PR_LEN(nd);
+
+	if (nd->pn_left && PR_NODE(pr, nd->pn_left)->pn_max > max)
+		max = PR_NODE(pr, nd->pn_left)->pn_max;
+	if (nd->pn_right && PR_NODE(pr, nd->pn_right)->pn_max > max)
+		max = PR_NODE(pr, nd->pn_right)->pn_max;
+	nd->pn_max = max;
+}
+
+/** Split a subtree into the runs ending below key and the rest */
+static void
+mdb_pr_split(MDB_pgruns *pr, unsigned t, pgno_t key, unsigned *l, unsigned *r)
+{
+	if (!t) {
+		*l = *r = 0;
+		return;
+	}
+	if (PR_NODE(pr, t)->pn_hi < key) {
+		mdb_pr_split(pr, PR_NODE(pr, t)->pn_right, key, &PR_NODE(pr, t)->pn_right, r);
+		*l = t;
+	} else {
+		mdb_pr_split(pr, PR_NODE(pr, t)->pn_left, key, l, &PR_NODE(pr, t)->pn_left);
+		*r = t;
+	}
+	mdb_pr_fix(pr, t);
+}
+
+/** Join two subtrees, all runs in l being below those in r */
+static unsigned
+mdb_pr_join(MDB_pgruns *pr, unsigned l, unsigned r)
+{
+	if (!l || !r)
+		return l ? l : r;
+	if (PR_NODE(pr, l)->pn_prio > PR_NODE(pr, r)->pn_prio) {
+		PR_NODE(pr, l)->pn_right = mdb_pr_join(pr, PR_NODE(pr, l)->pn_right, r);
+		mdb_pr_fix(pr, l);
+		return l;
+	}
+	PR_NODE(pr, r)->pn_left = mdb_pr_join(pr, l, PR_NODE(pr, r)->pn_left);
+	mdb_pr_fix(pr, r);
+	return r;
+}
+
+/** Get a node for the run of pages lo..hi.
+ * @return the node, or 0 if out of memory.
+ */
+static unsigned
+mdb_pr_node(MDB_pgruns *pr, pgno_t lo, pgno_t hi)
+{
+	MDB_prnode *nd;
+	unsigned n;
+
+	if ((n = pr->pr_free) != 0) {
+		pr->pr_free = PR_NODE(pr, n)->pn_left;
+	} else {
+		if (pr->pr_next >= pr->pr_size) {
+			unsigned size = pr->pr_size ? pr->pr_size * 2 : 256;
+			if (!(nd = realloc(pr->pr_nodes, size * sizeof(MDB_prnode))))
+				return 0;
+			pr->pr_nodes = nd;
+			pr->pr_size = size;
+		}
+		n = pr->pr_next++;
+	}
+	nd = PR_NODE(pr, n);
+	nd->pn_lo = lo;
+	nd->pn_hi = hi;
+	nd->pn_max = hi - lo + 1;
+	nd->pn_left = nd->pn_right = 0;
+	pr->pr_seed = pr->pr_seed * 1103515245 + 12345;
+	nd->pn_prio = pr->pr_seed >> 8;
+	return n;
+}
+
+/** Add the run of pages lo..hi to the index */
+static int
+mdb_pr_insert(MDB_pgruns *pr, pgno_t lo, pgno_t hi)
+{
+	unsigned n, l, r;
+
+	if (!(n = mdb_pr_node(pr, lo, hi)))
+		return ENOMEM;
+	mdb_pr_split(pr, pr->pr_root, hi, &l, &r);
+	pr->pr_root = mdb_pr_join(pr, mdb_pr_join(pr, l, n), r);
+	return MDB_SUCCESS;
+}
+
+/** Remove a run from the index */
+static void
+mdb_pr_remove(MDB_pgruns *pr, unsigned n)
+{
+	pgno_t hi = PR_NODE(pr, n)->pn_hi;
+	unsigned l, m, r;
+
+	mdb_pr_split(pr, pr->pr_root, hi, &l, &m);
+	mdb_pr_split(pr, m, hi + 1, &m, &r);
+	PR_NODE(pr, n)->pn_left = pr->pr_free;
+	pr->pr_free = n;
+	pr->pr_root = mdb_pr_join(pr, l, r);
+}
+
+/** Move the start of a run up to lo, dropping it if less than two
+ *	pages are left. Cannot fail: the node just freed is reused.
+ */
+static void
+mdb_pr_trim(MDB_pgruns *pr, unsigned n, pgno_t lo)
+{
+	pgno_t hi = PR_NODE(pr, n)->pn_hi;
+
+	mdb_pr_remove(pr, n);
+	if (lo < hi)
+		mdb_pr_insert(pr, lo, hi);
+}
+
+/** Find the first run ending at or above key, or 0 */
+static unsigned
+mdb_pr_find(MDB_pgruns *pr, pgno_t key)
+{
+	unsigned t = pr->pr_root, found = 0;
+
+	while (t) {
+		if (PR_NODE(pr, t)->pn_hi < key) {
+			t = PR_NODE(pr, t)->pn_right;
+		} else {
+			found = t;
+			t = PR_NODE(pr, t)->pn_left;
+		}
+	}
+	return found;
+}
+
+/** Find the lowest run of at least num pages, or 0 */
+static unsigned
+mdb_pr_first(MDB_pgruns *pr, pgno_t num)
+{
+	unsigned t = pr->pr_root;
+	MDB_prnode *nd;
+
+	if (!t || PR_NODE(pr, t)->pn_max < num)
+		return 0;
+	for (;;) {
+		nd = PR_NODE(pr, t);
+		if (nd->pn_left && PR_NODE(pr, nd->pn_left)->pn_max >= num)
+			t = nd->pn_left;
+		else if (PR_LEN(nd) >= num)
+			return t;
+		else
+			t = nd->pn_right;
+	}
+}
+
+/** Index all runs in me_pghead[]. They come in ascending order, so
+ *	build the treap directly, keeping its right spine on a stack of
+ *	nodes linked through pn_right.
+ */
+static int
+mdb_pr_build(MDB_pgruns *pr, pgno_t *mop)
+{
+	unsigned i, j, n, last, top = 0;
+
+	pr->pr_root = pr->pr_free = 0;
+	pr->pr_next = 1;
+	for (i = mop[0]; i > 1; i = j) {
+		for (j = i-1; j && mop[j] == mop[j+1] + 1; j--) ;
+		if (i - j < 2)
+			continue;
+		if (!(n = mdb_pr_node(pr, mop[i], mop[j+1])))
+			return ENOMEM;
+		for (last = 0; top && PR_NODE(pr, top)->pn_prio < PR_NODE(pr, n)->pn_prio; ) {
+			unsigned below = PR_NODE(pr, top)->pn_right;
+			PR_NODE(pr, top)->pn_right = last;
+			mdb_pr_fix(pr, top);
+			last = top;
+			top = below;
+		}
+		PR_NODE(pr, n)->pn_left = last;
+		PR_NODE(pr, n)->pn_right = top;
+		top = n;
+	}
+	for (last = 0; top; ) {
+		unsigned below = PR_NODE(pr, top)->pn_right;
+		PR_NODE(pr, top)->pn_right = last;
+		mdb_pr_fix(pr, top);
+		last = top;
+		top = below;
+	}
+	pr->pr_root = last;
+	pr->pr_valid = 1;
+	return MDB_SUCCESS;
+}
+
+/** Update the index for the pages of idl, just merged into me_pghead[].
+ *	Any new run must contain one of them, and go through it in
+ *	ascending order so each run is only extended upwards once.
+ */
+static int
+mdb_pr_merge(MDB_pgruns *pr, pgno_t *mop, MDB_IDL idl)
+{
+	unsigned i, n, p;
+	pgno_t x, lo, hi;
+	int rc;
+
+	for (i = idl[0]; i; i--) {
+		x = idl[i];
+		n = mdb_pr_find(pr, x);
+		if (n && PR_NODE(pr, n)->pn_lo <= x)
+			continue;	/* joined while adding a lower page */
+		p = mdb_midl_search(mop, x);
+		lo = hi = x;
+		if (p < mop[0] && mop[p+1] == x-1) {
+			n = mdb_pr_find(pr, x-1);
+			if (n && PR_NODE(pr, n)->pn_hi == x-1) {
+				lo = PR_NODE(pr, n)->pn_lo;
+				mdb_pr_remove(pr, n);
+			} else {
+				lo = x-1;
+			}
+		}
+		while (p > 1 && mop[p-1] == hi+1) {
+			n = mdb_pr_find(pr, hi+1);
+			if (n && PR_NODE(pr, n)->pn_lo <= hi+1) {
+				hi = PR_NODE(pr, n)->pn_hi;
+				mdb_pr_remove(pr, n);
+				break;
+			}
+			hi++;
+			p--;
+		}
+		if (lo < hi && (rc = mdb_pr_insert(pr, lo, hi)) != 0)
+			return rc;
+	}
+	return MDB_SUCCESS;
+}
+
+/** Find the lowest run of at least num pages in me_pghead[], the
+ *	same one a scan from the tail would find, and drop it from the index.
+ * @return the position in me_pghead[] of its first page, or 0 if none.
+ */
+static unsigned
+mdb_pr_take(MDB_env *env, unsigned num)
+{
+	MDB_pgruns *pr = &env->me_pgruns;
+	pgno_t *mop = env->me_pghead, lo, hi;
+	unsigned i, n, n2 = num-1;
+
+	/* Scan from the tail until that has cost more than the index would */
+	if (!pr->pr_valid &&
+		(pr->pr_scanned < (mdb_size_t)mop[0] * MDB_PR_SCANS ||
+		 mdb_pr_build(pr, mop) != MDB_SUCCESS))
+	{
+		for (i = mop[0]; i > n2; i--)
+			if (mop[i-n2] == mop[i]+n2)
+				break;
+		pr->pr_scanned += mop[0] - i + 1;
+		return i > n2 ? i : 0;
+	}
+	while ((n = mdb_pr_first(pr, num)) != 0) {
+		lo = PR_NODE(pr, n)->pn_lo;
+		hi = PR_NODE(pr, n)->pn_hi;
+		i = mdb_midl_search(mop, lo);
+		if (i <= mop[0] && mop[i] == lo) {
+			mdb_pr_trim(pr, n, lo + num);
+			return i;
+		}
+		/* The low end was used, mop[i-1] is what is left of the run */
+		mdb_pr_trim(pr, n, (i > 1 && mop[i-1] <= hi) ? mop[i-1] : hi);
+	}
+	return 0;
+}
+/** @} */
+
+/** Read a monotonic clock, in nanoseconds */
+static uint64_t
+mdb_clock(void)
+{
+#ifdef _WIN32
+	LARGE_INTEGER now, freq;
+	QueryPerformanceCounter(&now);
+	QueryPerformanceFrequency(&freq);
+	return (uint64_t)(now.QuadPart * (1e9 / freq.QuadPart));
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
 }
 
 /** Allocate page numbers and memory for writing.  Maintain me_pglast,
@@ -2454,6 +2987,7 @@ mdb_page_alloc(MDB_cursor *mc, int num, MDB_page **mp)
 	MDB_cursor_op op;
 	MDB_cursor m2;
 	int found_old = 0;
+	uint64_t start = 0;
 
 	/* If there are any loose pages, just use them */
 	if (num == 1 && txn->mt_loose_pgs) {
@@ -2473,6 +3007,14 @@ mdb_page_alloc(MDB_cursor *mc, int num, MDB_page **mp)
 		goto fail;
 	}
 
+	/* A single page is just taken from the tail */
+	if (num == 1 && mop_len) {
+		i = mop_len;
+		pgno = mop[i];
+		goto search_done;
+	}
+	start = mdb_clock();
+
 	for (op = MDB_FIRST;; op = MDB_NEXT) {
 		MDB_val key, data;
 		MDB_node *leaf;
@@ -2482,12 +3024,10 @@ mdb_page_alloc(MDB_cursor *mc, int num, MDB_page **mp)
 		 * pages at the tail, just truncating the list.
 		 */
 		if (mop_len > n2) {
-			i = mop_len;
-			do {
+			if ((i = (num == 1) ? mop_len : mdb_pr_take(env, num)) != 0) {
 				pgno = mop[i];
-				if (mop[i-n2] == pgno+n2)
-					goto search_done;
-			} while (--i > n2);
+				goto search_done;
+			}
 			if (--retry < 0)
 				break;
 		}
@@ -2570,12 +3110,14 @@ mdb_page_alloc(MDB_cursor *mc, int num, MDB_page **mp)
 		/* Merge in descending sorted order */
 		mdb_midl_xmerge(mop, idl);
 		mop_len = mop[0];
+		if (env->me_pgruns.pr_valid && mdb_pr_merge(&env->me_pgruns, mop, idl))
+			env->me_pgruns.pr_valid = 0;	/* rebuild when next needed */
 	}
 
 	/* Use new pages from the map when nothing suitable in the freeDB */
 	i = 0;
 	pgno = txn->mt_next_pgno;
-	if (pgno + num >= env->me_maxpg) {
+	if (pgno + num >= env->me_maxpg && mdb_env_grow(env, pgno + num + 1)) {
 			DPUTS("DB size maxed out");
 			rc = MDB_MAP_FULL;
 			goto fail;
@@ -2613,12 +3155,20 @@ search_done:
 		txn->mt_next_pgno = pgno + num;
 	}
 	np->mp_pgno = pgno;
-	mdb_page_dirty(txn, np);
+	if ((rc = mdb_page_dirty(txn, np)) != MDB_SUCCESS) {
+		if (!(env->me_flags & MDB_WRITEMAP))
+			mdb_page_free(env, np, num);
+		goto fail;
+	}
 	*mp = np;
+	if (start)
+		env->me_alloc_time += mdb_clock() - start;
 
 	return MDB_SUCCESS;
 
 fail:
+	if (start)
+		env->me_alloc_time += mdb_clock() - start;
 	txn->mt_flags |= MDB_TXN_ERROR;
 	return rc;
 }
@@ -2700,7 +3250,11 @@ mdb_page_unspill(MDB_txn *txn, MDB_page *mp, MDB_page **ret)
 				 * page remains spilled until child commits
 				 */
 
-			mdb_page_dirty(txn, np);
+			if (mdb_page_dirty(txn, np) != MDB_SUCCESS) {
+				if (!(env->me_flags & MDB_WRITEMAP))
+					mdb_dpage_free(env, np);
+				return ENOMEM;
+			}
 			np->mp_flags |= P_DIRTY;
 			*ret = np;
 			break;
@@ -2749,30 +3303,31 @@ mdb_page_touch(MDB_cursor *mc)
 			mc->mc_db->md_root = pgno;
 		}
 	} else if (txn->mt_parent && !IS_SUBP(mp)) {
-		MDB_ID2 mid, *dl = txn->mt_u.dirty_list;
+		MDB_ID2 mid;
+		MDB_page *dp;
 		pgno = mp->mp_pgno;
 		/* If txn has a parent, make sure the page is in our
 		 * dirty list.
 		 */
-		if (dl[0].mid) {
-			unsigned x = mdb_mid2l_search(dl, pgno);
-			if (x <= dl[0].mid && dl[x].mid == pgno) {
-				if (mp != dl[x].mptr) { /* bad cursor? */
-					mc->mc_flags &= ~(C_INITIALIZED|C_EOF);
-					txn->mt_flags |= MDB_TXN_ERROR;
-					return MDB_PROBLEM;
-				}
-				return 0;
+		if ((dp = mdb_dlist_find(txn, pgno)) != NULL) {
+			if (mp != dp) { /* bad cursor? */
+				mc->mc_flags &= ~(C_INITIALIZED|C_EOF);
+				txn->mt_flags |= MDB_TXN_ERROR;
+				return MDB_PROBLEM;
 			}
+			return 0;
 		}
-		mdb_cassert(mc, dl[0].mid < MDB_IDL_UM_MAX);
 		/* No - copy it */
 		np = mdb_page_malloc(txn, 1);
 		if (!np)
 			return ENOMEM;
 		mid.mid = pgno;
 		mid.mptr = np;
-		rc = mdb_mid2l_insert(dl, &mid);
+		rc = mdb_dlist_add(txn, &mid, 0);
+		if (rc == ENOMEM) {
+			mdb_page_free(txn->mt_env, np, 1);
+			goto fail;
+		}
 		mdb_cassert(mc, rc == 0);
 	} else {
 		return 0;
@@ -2860,9 +3415,11 @@ mdb_cursor_shadow(MDB_txn *src, MDB_txn *dst)
 	MDB_cursor *mc, *bk;
 	MDB_xcursor *mx;
 	size_t size;
-	int i;
+	MDB_dbi i;
+	int k;
 
-	for (i = src->mt_numdbs; --i >= 0; ) {
+	for (k = src->mt_numtouch; --k >= 0; ) {
+		i = src->mt_dbtouch[k];
 		if ((mc = src->mt_cursors[i]) != NULL) {
 			size = sizeof(MDB_cursor);
 			if (mc->mc_xcursor)
@@ -2902,9 +3459,11 @@ mdb_cursors_close(MDB_txn *txn, unsigned merge)
 {
 	MDB_cursor **cursors = txn->mt_cursors, *mc, *next, *bk;
 	MDB_xcursor *mx;
-	int i;
+	MDB_dbi i;
+	int k;
 
-	for (i = txn->mt_numdbs; --i >= 0; ) {
+	for (k = txn->mt_numtouch; --k >= 0; ) {
+		i = txn->mt_dbtouch[k];
 		for (mc = cursors[i]; mc; mc = next) {
 			next = mc->mc_next;
 			if ((bk = mc->mc_backup) != NULL) {
@@ -2997,7 +3556,6 @@ mdb_txn_renew0(MDB_txn *txn)
 	MDB_txninfo *ti = env->me_txns;
 	MDB_meta *meta;
 	unsigned int i, nr, flags = txn->mt_flags;
-	uint16_t x;
 	int rc, new_notls = 0;
 
 	if ((flags &= MDB_TXN_RDONLY) != 0) {
@@ -3055,9 +3613,31 @@ mdb_txn_renew0(MDB_txn *txn)
 					return rc;
 				}
 			}
-			do /* LY: Retry on a race, ITS#7970. */
-				r->mr_txnid = ti->mti_txnid;
-			while(r->mr_txnid != ti->mti_txnid);
+			for (;;) {
+				do /* LY: Retry on a race, ITS#7970. */
+					r->mr_txnid = ti->mti_txnid;
+				while(r->mr_txnid != ti->mti_txnid);
+#if !defined(_WIN32) && !defined(MDB_VL32)
+				/* A compaction swap that started before our slot
+				 * showed the txnid may replace the map, so wait for
+				 * it on the reader table mutex it holds meanwhile.
+				 * It checks the slots after setting the flag, so one
+				 * of us always sees the other.
+				 */
+				__sync_synchronize();
+				if (env->me_swapping) {
+					r->mr_txnid = (txnid_t)-1;
+					if (LOCK_MUTEX(rc, env, env->me_rmutex)) {
+						if (new_notls)
+							r->mr_pid = 0;
+						return rc;
+					}
+					UNLOCK_MUTEX(env->me_rmutex);
+					continue;
+				}
+#endif
+				break;
+			}
 			txn->mt_txnid = r->mr_txnid;
 			txn->mt_u.reader = r;
 			meta = env->me_metas[txn->mt_txnid & 1];
@@ -3082,14 +3662,23 @@ mdb_txn_renew0(MDB_txn *txn)
 		txn->mt_child = NULL;
 		txn->mt_loose_pgs = NULL;
 		txn->mt_loose_count = 0;
-		txn->mt_dirty_room = MDB_IDL_UM_MAX;
+		{
+			/* the dirty page budget takes effect from the next write txn */
+			mdb_size_t max = env->me_dirty_size / env->me_psize;
+			if (max > UINT_MAX/2)
+				max = UINT_MAX/2;
+			env->me_dirty_max = max > MDB_IDL_UM_MAX ? max : MDB_IDL_UM_MAX;
+		}
+		txn->mt_dirty_room = env->me_dirty_max;
 		txn->mt_u.dirty_list = env->me_dirty_list;
 		txn->mt_u.dirty_list[0].mid = 0;
+		txn->mt_dirty_pend = env->me_dirty_pend;
+		if (txn->mt_dirty_pend)
+			txn->mt_dirty_pend[0].mid = 0;
 		txn->mt_free_pgs = env->me_free_pgs;
 		txn->mt_free_pgs[0] = 0;
 		txn->mt_spill_pgs = NULL;
 		env->me_txn = txn;
-		memcpy(txn->mt_dbiseqs, env->me_dbiseqs, env->me_maxdbs * sizeof(unsigned int));
 	}
 
 	/* Copy the DB info and flags */
@@ -3103,23 +3692,33 @@ mdb_txn_renew0(MDB_txn *txn)
 
 	txn->mt_flags = flags;
 
-	/* Setup db info */
+	/* Setup db info. Named DBs are set up when first used */
 	txn->mt_numdbs = env->me_numdbs;
-	for (i=CORE_DBS; i<txn->mt_numdbs; i++) {
-		x = env->me_dbflags[i];
-		txn->mt_dbs[i].md_flags = x & PERSISTENT_FLAGS;
-		txn->mt_dbflags[i] = (x & MDB_VALID) ? DB_VALID|DB_USRVALID|DB_STALE : 0;
-	}
-	txn->mt_dbflags[MAIN_DBI] = DB_VALID|DB_USRVALID;
-	txn->mt_dbflags[FREE_DBI] = DB_VALID;
+	txn->mt_dbflags[MAIN_DBI] = DB_TOUCHED|DB_VALID|DB_USRVALID;
+	txn->mt_dbflags[FREE_DBI] = DB_TOUCHED|DB_VALID;
+	txn->mt_dbtouch[FREE_DBI] = FREE_DBI;
+	txn->mt_dbtouch[MAIN_DBI] = MAIN_DBI;
+	txn->mt_numtouch = CORE_DBS;
 
 	if (env->me_flags & MDB_FATAL_ERROR) {
 		DPUTS("environment had fatal error, must shutdown!");
 		rc = MDB_PANIC;
-	} else if (env->me_maxpg < txn->mt_next_pgno) {
+	} else if (flags & MDB_TXN_RDONLY) {
+		/* Readers never resize the map or the file. Pages that a
+		 * writer grew the map over are already in the reservation.
+		 */
+		if (txn->mt_next_pgno <= env->me_maxpg
+#if !defined(MDB_VL32) && !defined(_WIN32)
+			|| (mdb_size_t)txn->mt_next_pgno * env->me_psize <= env->me_maplen
+#endif
+			)
+			return MDB_SUCCESS;
 		rc = MDB_MAP_RESIZED;
-	} else {
+	} else if (mdb_env_grow(env, txn->mt_next_pgno) == MDB_SUCCESS) {
+		/* We hold me_wmutex, so this is the only thread resizing */
 		return MDB_SUCCESS;
+	} else {
+		rc = MDB_MAP_RESIZED;
 	}
 	mdb_txn_end(txn, new_notls /*0 or MDB_END_SLOT*/ | MDB_END_FAIL_BEGIN);
 	return rc;
@@ -3162,10 +3761,10 @@ mdb_txn_begin(MDB_env *env, MDB_txn *parent, unsigned int flags, MDB_txn **ret)
 			return (parent->mt_flags & MDB_TXN_RDONLY) ? EINVAL : MDB_BAD_TXN;
 		}
 		/* Child txns save MDB_pgstate and use own copy of cursors */
-		size = env->me_maxdbs * (sizeof(MDB_db)+sizeof(MDB_cursor *)+1);
+		size = env->me_maxdbs * (sizeof(MDB_db)+sizeof(MDB_cursor *)+sizeof(MDB_dbi)+1);
 		size += tsize = sizeof(MDB_ntxn);
 	} else if (flags & MDB_RDONLY) {
-		size = env->me_maxdbs * (sizeof(MDB_db)+1);
+		size = env->me_maxdbs * (sizeof(MDB_db)+sizeof(MDB_dbi)+1);
 		size += tsize = sizeof(MDB_txn);
 	} else {
 		/* Reuse preallocated write txn. However, do not touch it until
@@ -3174,10 +3773,14 @@ mdb_txn_begin(MDB_env *env, MDB_txn *parent, unsigned int flags, MDB_txn **ret)
 		txn = env->me_txn0;
 		goto renew;
 	}
-	if ((txn = calloc(1, size)) == NULL) {
-		DPRINTF(("calloc: %s", strerror(errno)));
+	if ((txn = malloc(size)) == NULL) {
+		DPRINTF(("malloc: %s", strerror(errno)));
 		return ENOMEM;
 	}
+	/* Per-DB state is set up as each DB is touched, see #mdb_dbi_touch().
+	 * Only the txn itself and the DB flags need to start out zeroed.
+	 */
+	memset(txn, 0, tsize);
 #ifdef MDB_VL32
 	if (!parent) {
 		txn->mt_rpages = malloc(MDB_TRPAGE_SIZE * sizeof(MDB_ID3));
@@ -3192,24 +3795,30 @@ mdb_txn_begin(MDB_env *env, MDB_txn *parent, unsigned int flags, MDB_txn **ret)
 	txn->mt_dbxs = env->me_dbxs;	/* static */
 	txn->mt_dbs = (MDB_db *) ((char *)txn + tsize);
 	txn->mt_dbflags = (unsigned char *)txn + size - env->me_maxdbs;
+	txn->mt_dbtouch = (MDB_dbi *)txn->mt_dbflags - env->me_maxdbs;
+	memset(txn->mt_dbflags, 0, env->me_maxdbs);
 	txn->mt_flags = flags;
 	txn->mt_env = env;
 
 	if (parent) {
 		unsigned int i;
 		txn->mt_cursors = (MDB_cursor **)(txn->mt_dbs + env->me_maxdbs);
+		memset(txn->mt_cursors, 0, env->me_maxdbs * sizeof(MDB_cursor *));
 		txn->mt_dbiseqs = parent->mt_dbiseqs;
-		txn->mt_u.dirty_list = malloc(sizeof(MDB_ID2)*MDB_IDL_UM_SIZE);
+		txn->mt_u.dirty_list = mdb_mid2l_alloc(MDB_IDL_UM_MAX);
+		txn->mt_dirty_pend = NULL;
 		if (!txn->mt_u.dirty_list ||
+			(!(flags & MDB_TXN_WRITEMAP) &&
+			 !(txn->mt_dirty_pend = mdb_mid2l_alloc(MDB_DL_PEND))) ||
 			!(txn->mt_free_pgs = mdb_midl_alloc(MDB_IDL_UM_MAX)))
 		{
-			free(txn->mt_u.dirty_list);
+			mdb_mid2l_free(txn->mt_dirty_pend);
+			mdb_mid2l_free(txn->mt_u.dirty_list);
 			free(txn);
 			return ENOMEM;
 		}
 		txn->mt_txnid = parent->mt_txnid;
 		txn->mt_dirty_room = parent->mt_dirty_room;
-		txn->mt_u.dirty_list[0].mid = 0;
 		txn->mt_spill_pgs = NULL;
 		txn->mt_next_pgno = parent->mt_next_pgno;
 		parent->mt_flags |= MDB_TXN_HAS_CHILD;
@@ -3219,10 +3828,14 @@ mdb_txn_begin(MDB_env *env, MDB_txn *parent, unsigned int flags, MDB_txn **ret)
 #ifdef MDB_VL32
 		txn->mt_rpages = parent->mt_rpages;
 #endif
-		memcpy(txn->mt_dbs, parent->mt_dbs, txn->mt_numdbs * sizeof(MDB_db));
-		/* Copy parent's mt_dbflags, but clear DB_NEW */
-		for (i=0; i<txn->mt_numdbs; i++)
-			txn->mt_dbflags[i] = parent->mt_dbflags[i] & ~DB_NEW;
+		/* Copy the DBs the parent has set up, but clear DB_NEW */
+		for (i=0; i<parent->mt_numtouch; i++) {
+			MDB_dbi dbi = parent->mt_dbtouch[i];
+			txn->mt_dbs[dbi] = parent->mt_dbs[dbi];
+			txn->mt_dbflags[dbi] = parent->mt_dbflags[dbi] & ~DB_NEW;
+			txn->mt_dbtouch[i] = dbi;
+		}
+		txn->mt_numtouch = parent->mt_numtouch;
 		rc = 0;
 		ntxn = (MDB_ntxn *)txn;
 		ntxn->mnt_pgstate = env->me_pgstate; /* save parent me_pghead & co */
@@ -3268,6 +3881,36 @@ mdb_txn_env(MDB_txn *txn)
 	return txn->mt_env;
 }
 
+int
+mdb_txn_begin_snapshot(MDB_env *env, MDB_txn *src, MDB_txn **ret)
+{
+	MDB_txn *txn;
+	int rc;
+
+	if (!src || src->mt_env != env ||
+		(src->mt_flags & (MDB_TXN_RDONLY|MDB_TXN_FINISHED)) != MDB_TXN_RDONLY)
+		return EINVAL;
+
+	rc = mdb_txn_begin(env, NULL, MDB_RDONLY, &txn);
+	if (rc)
+		return rc;
+
+	/* Step back to the snapshot of src. Its reader slot keeps that
+	 * version alive until ours shows it too, and our slot only ever
+	 * moves to an older txnid, so no writer can free its pages.
+	 */
+	if (txn->mt_u.reader)
+		txn->mt_u.reader->mr_txnid = src->mt_txnid;
+	txn->mt_txnid = src->mt_txnid;
+	memcpy(txn->mt_dbs, src->mt_dbs, CORE_DBS * sizeof(MDB_db));
+	txn->mt_next_pgno = src->mt_next_pgno;
+#ifdef MDB_VL32
+	txn->mt_last_pgno = src->mt_last_pgno;
+#endif
+	*ret = txn;
+	return MDB_SUCCESS;
+}
+
 mdb_size_t
 mdb_txn_id(MDB_txn *txn)
 {
@@ -3279,18 +3922,20 @@ mdb_txn_id(MDB_txn *txn)
 static void
 mdb_dbis_update(MDB_txn *txn, int keep)
 {
-	int i;
-	MDB_dbi n = txn->mt_numdbs;
+	int k;
+	MDB_dbi i, n = txn->mt_numdbs;
 	MDB_env *env = txn->mt_env;
 	unsigned char *tdbflags = txn->mt_dbflags;
 
-	for (i = n; --i >= CORE_DBS;) {
+	for (k = txn->mt_numtouch; --k >= CORE_DBS;) {
+		i = txn->mt_dbtouch[k];
 		if (tdbflags[i] & DB_NEW) {
 			if (keep) {
 				env->me_dbflags[i] = txn->mt_dbs[i].md_flags | MDB_VALID;
 			} else {
 				char *ptr = env->me_dbxs[i].md_name.mv_data;
 				if (ptr) {
+					mdb_dbi_unhash(env, i);
 					env->me_dbxs[i].md_name.mv_data = NULL;
 					env->me_dbxs[i].md_name.mv_size = 0;
 					env->me_dbflags[i] = 0;
@@ -3304,6 +3949,19 @@ mdb_dbis_update(MDB_txn *txn, int keep)
 		env->me_numdbs = n;
 }
 
+/** Forget the named DBs set up in this txn, so the txn can be reused
+ * without clearing its whole DB table.
+ */
+static void
+mdb_dbis_reset(MDB_txn *txn)
+{
+	MDB_dbi k;
+
+	for (k = CORE_DBS; k < txn->mt_numtouch; k++)
+		txn->mt_dbflags[txn->mt_dbtouch[k]] = 0;
+	txn->mt_numtouch = CORE_DBS;
+}
+
 /** End a transaction, except successful commit of a nested transaction.
  * May be called twice for readonly txns: First reset it, then abort.
  * @param[in] txn the transaction handle to end
@@ -3335,6 +3993,7 @@ mdb_txn_end(MDB_txn *txn, unsigned mode)
 				txn->mt_u.reader = NULL;
 			} /* else txn owns the slot until it does MDB_END_SLOT */
 		}
+		mdb_dbis_reset(txn);
 		txn->mt_numdbs = 0;		/* prevent further DBI activity */
 		txn->mt_flags |= MDB_TXN_FINISHED;
 
@@ -3343,6 +4002,7 @@ mdb_txn_end(MDB_txn *txn, unsigned mode)
 
 		if (!(mode & MDB_END_UPDATE)) /* !(already closed cursors) */
 			mdb_cursors_close(txn, 0);
+		mdb_dbis_reset(txn);
 		if (!(env->me_flags & MDB_WRITEMAP)) {
 			mdb_dlist_free(txn);
 		}
@@ -3356,6 +4016,8 @@ mdb_txn_end(MDB_txn *txn, unsigned mode)
 			/* me_pgstate: */
 			env->me_pghead = NULL;
 			env->me_pglast = 0;
+			env->me_pgruns.pr_valid = 0;
+			env->me_pgruns.pr_scanned = 0;
 
 			env->me_txn = NULL;
 			mode = 0;	/* txn == env->me_txn0, do not free() it */
@@ -3367,8 +4029,10 @@ mdb_txn_end(MDB_txn *txn, unsigned mode)
 			txn->mt_parent->mt_child = NULL;
 			txn->mt_parent->mt_flags &= ~MDB_TXN_HAS_CHILD;
 			env->me_pgstate = ((MDB_ntxn *)txn)->mnt_pgstate;
+			env->me_pgruns.pr_valid = 0;	/* it tracked our copy */
 			mdb_midl_free(txn->mt_free_pgs);
-			free(txn->mt_u.dirty_list);
+			mdb_mid2l_free(txn->mt_dirty_pend);
+			mdb_mid2l_free(txn->mt_u.dirty_list);
 		}
 		mdb_midl_free(txn->mt_spill_pgs);
 
@@ -3466,6 +4130,7 @@ mdb_freelist_save(MDB_txn *txn)
 		unsigned x;
 		if ((rc = mdb_midl_need(&txn->mt_free_pgs, txn->mt_loose_count)) != 0)
 			return rc;
+		mdb_dlist_sync(txn);
 		for (; mp; mp = NEXT_LOOSE_PAGE(mp)) {
 			mdb_midl_xappend(txn->mt_free_pgs, mp->mp_pgno);
 			/* must also remove from dirty list */
@@ -3619,6 +4284,7 @@ mdb_freelist_save(MDB_txn *txn)
 		loose[0] = count;
 		mdb_midl_sort(loose);
 		mdb_midl_xmerge(mop, loose);
+		env->me_pgruns.pr_valid = 0;
 		txn->mt_loose_pgs = NULL;
 		txn->mt_loose_count = 0;
 		mop_len = mop[0];
@@ -3654,18 +4320,220 @@ mdb_freelist_save(MDB_txn *txn)
 	return rc;
 }
 
-/** Flush (some) dirty pages to the map, after clearing their dirty flag.
- * @param[in] txn the transaction that's being committed
- * @param[in] keep number of initial pages in dirty_list to keep dirty.
- * @return 0 on success, non-zero on failure.
+#ifdef MDB_USE_IO_URING
+/** Tear down an io_uring, leaving it marked unavailable.
+ * Closing the ring waits for any writes still in flight.
  */
-static int
-mdb_page_flush(MDB_txn *txn, int keep)
+static void ESECT
+mdb_uring_close(MDB_uring *ur)
+{
+	if (ur->ur_sqes)
+		munmap(ur->ur_sqes, ur->ur_sqelen);
+	if (ur->ur_cqmap && ur->ur_cqmap != ur->ur_sqmap)
+		munmap(ur->ur_cqmap, ur->ur_cqlen);
+	if (ur->ur_sqmap)
+		munmap(ur->ur_sqmap, ur->ur_sqlen);
+	if (ur->ur_fd >= 0)
+		close(ur->ur_fd);
+	free(ur->ur_iov);
+	memset(ur, 0, sizeof(*ur));
+	ur->ur_fd = -1;
+}
+
+/** Return the env's io_uring, setting it up on first use.
+ * @return the ring, or NULL if io_uring is unavailable.
+ */
+static MDB_uring * ESECT
+mdb_uring_get(MDB_env *env)
 {
-	MDB_env		*env = txn->mt_env;
-	MDB_ID2L	dl = txn->mt_u.dirty_list;
-	unsigned	psize = env->me_psize, j;
-	int			i, pagecount = dl[0].mid, rc;
+	MDB_uring *ur = env->me_uring;
+	struct io_uring_params p;
+	char *sq, *cq;
+
+	if (ur)
+		return ur->ur_fd < 0 ? NULL : ur;
+	if ((ur = calloc(1, sizeof(MDB_uring))) == NULL)
+		return NULL;
+	env->me_uring = ur;
+	memset(&p, 0, sizeof(p));
+	ur->ur_fd = syscall(__NR_io_uring_setup, MDB_URING_DEPTH, &p);
+	if (ur->ur_fd < 0)
+		goto fail;
+	/* The iovecs of an SQE are reused as soon as it is submitted */
+	if (!(p.features & IORING_FEAT_SUBMIT_STABLE))
+		goto fail;
+	ur->ur_sqlen = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	ur->ur_cqlen = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		if (ur->ur_sqlen < ur->ur_cqlen)
+			ur->ur_sqlen = ur->ur_cqlen;
+		ur->ur_cqlen = ur->ur_sqlen;
+	}
+	sq = mmap(NULL, ur->ur_sqlen, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE,
+		ur->ur_fd, IORING_OFF_SQ_RING);
+	if (sq == MAP_FAILED)
+		goto fail;
+	ur->ur_sqmap = sq;
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		cq = sq;
+	} else {
+		cq = mmap(NULL, ur->ur_cqlen, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE,
+			ur->ur_fd, IORING_OFF_CQ_RING);
+		if (cq == MAP_FAILED)
+			goto fail;
+	}
+	ur->ur_cqmap = cq;
+	ur->ur_sqelen = p.sq_entries * sizeof(struct io_uring_sqe);
+	ur->ur_sqes = mmap(NULL, ur->ur_sqelen, PROT_READ|PROT_WRITE,
+		MAP_SHARED|MAP_POPULATE, ur->ur_fd, IORING_OFF_SQES);
+	if (ur->ur_sqes == MAP_FAILED) {
+		ur->ur_sqes = NULL;
+		goto fail;
+	}
+	ur->ur_iov = malloc(p.sq_entries * MDB_COMMIT_PAGES * sizeof(struct iovec));
+	if (!ur->ur_iov)
+		goto fail;
+	ur->ur_depth = p.sq_entries;
+	ur->ur_sqtail = (unsigned *)(sq + p.sq_off.tail);
+	ur->ur_sqmask = (unsigned *)(sq + p.sq_off.ring_mask);
+	ur->ur_sqarray = (unsigned *)(sq + p.sq_off.array);
+	ur->ur_cqhead = (unsigned *)(cq + p.cq_off.head);
+	ur->ur_cqtail = (unsigned *)(cq + p.cq_off.tail);
+	ur->ur_cqmask = (unsigned *)(cq + p.cq_off.ring_mask);
+	ur->ur_cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+	return ur;
+
+fail:
+	mdb_uring_close(ur);
+	return NULL;
+}
+
+/** Submit the queued SQEs, wait for at least \b wait completions,
+ * and reap all the completions that are available.
+ * A failed or short write is recorded in #MDB_uring.ur_err.
+ * @return 0 on success, non-zero if the ring itself failed.
+ */
+static int
+mdb_uring_enter(MDB_uring *ur, unsigned wait)
+{
+	unsigned head, tail;
+	int rc;
+
+	for (;;) {
+		rc = syscall(__NR_io_uring_enter, ur->ur_fd, ur->ur_queued, wait,
+			wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+		if (rc >= 0)
+			break;
+		rc = ErrCode();
+		if (rc != EINTR && rc != EAGAIN)
+			return rc;
+	}
+	ur->ur_queued -= rc;
+	head = *ur->ur_cqhead;
+	tail = __atomic_load_n(ur->ur_cqtail, __ATOMIC_ACQUIRE);
+	for (; head != tail; head++) {
+		struct io_uring_cqe *cqe = &ur->ur_cqes[head & *ur->ur_cqmask];
+		/* user_data is the number of bytes the SQE was to write */
+		if (cqe->res < 0) {
+			if (!ur->ur_err)
+				ur->ur_err = -cqe->res;
+			DPRINTF(("io_uring write error: %s", strerror(-cqe->res)));
+		} else if ((__u64)cqe->res != cqe->user_data) {
+			if (!ur->ur_err)
+				ur->ur_err = EIO;
+			DPUTS("short write, filesystem full?");
+		}
+		ur->ur_inflight--;
+	}
+	__atomic_store_n(ur->ur_cqhead, head, __ATOMIC_RELEASE);
+	return MDB_SUCCESS;
+}
+
+/** Submit everything queued on the ring and wait until it completes.
+ * If the ring fails it is torn down, and later flushes write synchronously.
+ * @return 0 on success, or the first error seen by any write.
+ */
+static int
+mdb_uring_wait(MDB_uring *ur)
+{
+	int rc = MDB_SUCCESS;
+
+	while (ur->ur_inflight) {
+		if ((rc = mdb_uring_enter(ur, ur->ur_inflight))) {
+			mdb_uring_close(ur);
+			return rc;
+		}
+	}
+	rc = ur->ur_err;
+	ur->ur_err = 0;
+	return rc;
+}
+
+/** Return the iovecs to fill for the next SQE of the ring. */
+#define mdb_uring_iov(ur) \
+	((ur)->ur_iov + (*(ur)->ur_sqtail & *(ur)->ur_sqmask) * MDB_COMMIT_PAGES)
+
+/** Queue an SQE on the ring. If the ring is then full, submit
+ * everything queued and wait for one SQE to complete, so the
+ * next SQE and its iovecs are free to fill.
+ * @param[in] ur the ring.
+ * @param[in] op the operation, #IORING_OP_WRITEV or #IORING_OP_FSYNC.
+ * @param[in] fd the file to write.
+ * @param[in] n number of iovecs from #mdb_uring_iov(), or the
+ * fsync flags for #IORING_OP_FSYNC.
+ * @param[in] pos file offset to write at.
+ * @param[in] size total bytes to write.
+ * @return 0 on success, or the first error seen by any write.
+ * On error the ring has been waited for.
+ */
+static int
+mdb_uring_queue(MDB_uring *ur, int op, HANDLE fd, int n, MDB_OFF_T pos, size_t size)
+{
+	unsigned tail = *ur->ur_sqtail, idx = tail & *ur->ur_sqmask;
+	struct io_uring_sqe *sqe = &ur->ur_sqes[idx];
+
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = op;
+	sqe->fd = fd;
+	if (op == IORING_OP_FSYNC) {
+		/* Drain: start only after every earlier write completed */
+		sqe->flags = IOSQE_IO_DRAIN;
+		sqe->fsync_flags = n;
+	} else {
+		sqe->off = pos;
+		sqe->addr = (uintptr_t)(ur->ur_iov + idx * MDB_COMMIT_PAGES);
+		sqe->len = n;
+	}
+	sqe->user_data = size;
+	ur->ur_sqarray[idx] = idx;
+	__atomic_store_n(ur->ur_sqtail, tail + 1, __ATOMIC_RELEASE);
+	ur->ur_queued++;
+	ur->ur_inflight++;
+	if (ur->ur_inflight >= ur->ur_depth) {
+		int rc = mdb_uring_enter(ur, 1);
+		if (rc) {
+			mdb_uring_close(ur);
+			return rc;
+		}
+	}
+	return ur->ur_err ? mdb_uring_wait(ur) : MDB_SUCCESS;
+}
+#endif /* MDB_USE_IO_URING */
+
+/** Flush (some) dirty pages to the map, after clearing their dirty flag.
+ * @param[in] txn the transaction that's being committed
+ * @param[in] keep number of initial pages in dirty_list to keep dirty.
+ * @param[in,out] sync if non-NULL and set, the data file is to be synced
+ * after the writes. It is cleared if the flush already did that.
+ * @return 0 on success, non-zero on failure.
+ */
+static int
+mdb_page_flush(MDB_txn *txn, int keep, int *sync)
+{
+	MDB_env		*env = txn->mt_env;
+	MDB_ID2L	dl = txn->mt_u.dirty_list;
+	unsigned	psize = env->me_psize, j;
+	int			i, pagecount, rc;
 	size_t		size = 0;
 	MDB_OFF_T	pos = 0;
 	pgno_t		pgno = 0;
@@ -3676,13 +4544,18 @@ mdb_page_flush(MDB_txn *txn, int keep)
 	int async_i = 0;
 	HANDLE fd = (env->me_flags & MDB_NOSYNC) ? env->me_fd : env->me_ovfd;
 #else
-	struct iovec iov[MDB_COMMIT_PAGES];
+	struct iovec iovs[MDB_COMMIT_PAGES], *iov = iovs;
 	HANDLE fd = env->me_fd;
+#ifdef MDB_USE_IO_URING
+	MDB_uring	*ur;
+#endif
 #endif
 	ssize_t		wsize = 0, wres;
 	MDB_OFF_T	wpos = 0, next_pos = 1; /* impossible pos, so pos != next_pos */
 	int			n = 0;
 
+	mdb_dlist_sync(txn);
+	pagecount = dl[0].mid;
 	j = i = keep;
 	if (env->me_flags & MDB_WRITEMAP
 #ifdef _WIN32
@@ -3725,6 +4598,10 @@ mdb_page_flush(MDB_txn *txn, int keep)
 		env->ovs = ovs;
 	}
 #endif
+#ifdef MDB_USE_IO_URING
+	if ((ur = mdb_uring_get(env)) != NULL)
+		iov = mdb_uring_iov(ur);
+#endif
 
 	/* Write the pages */
 	for (;;) {
@@ -3787,6 +4664,15 @@ retry_write:
 				}
 				async_i++;
 #else
+#ifdef MDB_USE_IO_URING
+				if (ur) {
+					rc = mdb_uring_queue(ur, IORING_OP_WRITEV, fd, n, wpos, wsize);
+					if (rc)
+						return rc;
+					iov = mdb_uring_iov(ur);
+					goto written;
+				}
+#endif
 #ifdef MDB_USE_PWRITEV
 				wres = pwritev(fd, iov, n, wpos);
 #else
@@ -3817,6 +4703,9 @@ retry_seek:
 					return rc;
 				}
 #endif /* _WIN32 */
+#ifdef MDB_USE_IO_URING
+written:
+#endif
 				n = 0;
 			}
 			if (i > pagecount)
@@ -3860,6 +4749,25 @@ retry_seek:
 		}
 	}
 #endif	/* _WIN32 */
+#ifdef MDB_USE_IO_URING
+	if (ur) {
+		/* Queue the sync behind the writes, so one submission
+		 * usually covers the whole commit.
+		 */
+		if (sync && *sync && !(env->me_flags & MDB_NOSYNC)) {
+			int flags = IORING_FSYNC_DATASYNC;
+#ifdef BROKEN_FDATASYNC
+			if (env->me_flags & MDB_FSYNCONLY)
+				flags = 0;
+#endif
+			if ((rc = mdb_uring_queue(ur, IORING_OP_FSYNC, fd, flags, 0, 0)))
+				return rc;
+			*sync = 0;
+		}
+		if ((rc = mdb_uring_wait(ur)))
+			return rc;
+	}
+#endif
 
 	if (!(env->me_flags & MDB_WRITEMAP)) {
 		/* Don't free pages when using writemap (can only get here in NOSYNC mode in Windows)
@@ -3893,7 +4801,7 @@ static int ESECT mdb_env_share_locks(MDB_env *env, int *excl);
 int
 mdb_txn_commit(MDB_txn *txn)
 {
-	int		rc;
+	int		rc, sync;
 	unsigned int i, end_mode;
 	MDB_env	*env;
 
@@ -3930,6 +4838,16 @@ mdb_txn_commit(MDB_txn *txn)
 		MDB_IDL pspill;
 		unsigned x, y, len, ps_len;
 
+		/* Make room in parent's dirty list for ours */
+		mdb_dlist_sync(txn);
+		mdb_dlist_sync(parent);
+		if (mdb_mid2l_need(&parent->mt_u.dirty_list, txn->mt_u.dirty_list[0].mid)) {
+			rc = ENOMEM;
+			goto fail;
+		}
+		if (!parent->mt_parent)
+			env->me_dirty_list = parent->mt_u.dirty_list;
+
 		/* Append our free list to parent's */
 		rc = mdb_midl_append_list(&parent->mt_free_pgs, txn->mt_free_pgs);
 		if (rc)
@@ -3945,15 +4863,18 @@ mdb_txn_commit(MDB_txn *txn)
 		/* Merge our cursors into parent's and close them */
 		mdb_cursors_close(txn, 1);
 
-		/* Update parent's DB table. */
-		memcpy(parent->mt_dbs, txn->mt_dbs, txn->mt_numdbs * sizeof(MDB_db));
+		/* Update parent's DB table. The parent has set up every DB
+		 * we have, except those we opened.
+		 */
 		parent->mt_numdbs = txn->mt_numdbs;
-		parent->mt_dbflags[FREE_DBI] = txn->mt_dbflags[FREE_DBI];
-		parent->mt_dbflags[MAIN_DBI] = txn->mt_dbflags[MAIN_DBI];
-		for (i=CORE_DBS; i<txn->mt_numdbs; i++) {
+		for (i=0; i<txn->mt_numtouch; i++) {
+			MDB_dbi dbi = txn->mt_dbtouch[i];
 			/* preserve parent's DB_NEW status */
-			x = parent->mt_dbflags[i] & DB_NEW;
-			parent->mt_dbflags[i] = txn->mt_dbflags[i] | x;
+			x = parent->mt_dbflags[dbi] & DB_NEW;
+			if (!(parent->mt_dbflags[dbi] & DB_TOUCHED))
+				parent->mt_dbtouch[parent->mt_numtouch++] = dbi;
+			parent->mt_dbs[dbi] = txn->mt_dbs[dbi];
+			parent->mt_dbflags[dbi] = txn->mt_dbflags[dbi] | x;
 		}
 
 		dst = parent->mt_u.dirty_list;
@@ -4014,7 +4935,7 @@ mdb_txn_commit(MDB_txn *txn)
 				}
 			}
 		} else { /* Simplify the above for single-ancestor case */
-			len = MDB_IDL_UM_MAX - txn->mt_dirty_room;
+			len = env->me_dirty_max - txn->mt_dirty_room;
 		}
 		/* Merge our dirty list with parent's */
 		y = src[0].mid;
@@ -4027,7 +4948,8 @@ mdb_txn_commit(MDB_txn *txn)
 		}
 		mdb_tassert(txn, i == x);
 		dst[0].mid = len;
-		free(txn->mt_u.dirty_list);
+		mdb_mid2l_free(txn->mt_dirty_pend);
+		mdb_mid2l_free(txn->mt_u.dirty_list);
 		parent->mt_dirty_room = txn->mt_dirty_room;
 		if (txn->mt_spill_pgs) {
 			if (parent->mt_spill_pgs) {
@@ -4062,6 +4984,7 @@ mdb_txn_commit(MDB_txn *txn)
 
 	mdb_cursors_close(txn, 0);
 
+	mdb_dlist_sync(txn);
 	if (!txn->mt_u.dirty_list[0].mid &&
 		!(txn->mt_flags & (MDB_TXN_DIRTY|MDB_TXN_SPILLS)))
 		goto done;
@@ -4070,14 +4993,15 @@ mdb_txn_commit(MDB_txn *txn)
 	    txn->mt_txnid, (void*)txn, (void*)env, txn->mt_dbs[MAIN_DBI].md_root));
 
 	/* Update DB root pointers */
-	if (txn->mt_numdbs > CORE_DBS) {
+	if (txn->mt_numtouch > CORE_DBS) {
 		MDB_cursor mc;
-		MDB_dbi i;
+		MDB_dbi i, k;
 		MDB_val data;
 		data.mv_size = sizeof(MDB_db);
 
 		mdb_cursor_init(&mc, txn, MAIN_DBI, NULL);
-		for (i = CORE_DBS; i < txn->mt_numdbs; i++) {
+		for (k = CORE_DBS; k < txn->mt_numtouch; k++) {
+			i = txn->mt_dbtouch[k];
 			if (txn->mt_dbflags[i] & DB_DIRTY) {
 				if (TXN_DBI_CHANGED(txn, i)) {
 					rc = MDB_BAD_DBI;
@@ -4098,16 +5022,18 @@ mdb_txn_commit(MDB_txn *txn)
 
 	mdb_midl_free(env->me_pghead);
 	env->me_pghead = NULL;
+	env->me_pgruns.pr_valid = 0;
+	env->me_pgruns.pr_scanned = 0;
 	mdb_midl_shrink(&txn->mt_free_pgs);
 
 #if (MDB_DEBUG) > 2
 	mdb_audit(txn);
 #endif
 
-	if ((rc = mdb_page_flush(txn, 0)))
+	sync = !F_ISSET(txn->mt_flags, MDB_TXN_NOSYNC);
+	if ((rc = mdb_page_flush(txn, 0, &sync)))
 		goto fail;
-	if (!F_ISSET(txn->mt_flags, MDB_TXN_NOSYNC) &&
-		(rc = mdb_env_sync0(env, 0, txn->mt_next_pgno)))
+	if (sync && (rc = mdb_env_sync0(env, 0, txn->mt_next_pgno)))
 		goto fail;
 	if ((rc = mdb_env_write_meta(txn)))
 		goto fail;
@@ -4417,6 +5343,7 @@ mdb_env_create(MDB_env **env)
 
 	e->me_maxreaders = DEFAULT_READERS;
 	e->me_maxdbs = e->me_numdbs = CORE_DBS;
+	e->me_arena_max = MDB_ARENA_SIZE;
 	e->me_fd = INVALID_HANDLE_VALUE;
 	e->me_lfd = INVALID_HANDLE_VALUE;
 	e->me_mfd = INVALID_HANDLE_VALUE;
@@ -4447,6 +5374,25 @@ mdb_nt2win32(NTSTATUS st)
 }
 #endif
 
+#if !defined(MDB_VL32) && !defined(_WIN32)
+/** Set the size of the data file for #MDB_WRITEMAP. With a growth
+ * reservation this is only done by the writer holding me_wmutex, and
+ * the file never shrinks, since writers of other processes may
+ * already use pages beyond our own mapsize.
+ */
+static int ESECT
+mdb_env_truncate(MDB_env *env, mdb_size_t size)
+{
+	mdb_size_t fsize = 0;
+
+	if (env->me_mapupper && !mdb_fsize(env->me_fd, &fsize) && fsize >= size)
+		return MDB_SUCCESS;
+	if (ftruncate(env->me_fd, size) < 0)
+		return ErrCode();
+	return MDB_SUCCESS;
+}
+#endif
+
 static int ESECT
 mdb_env_map(MDB_env *env, void *addr)
 {
@@ -4519,11 +5465,26 @@ mdb_env_map(MDB_env *env, void *addr)
 	}
 #else
 	if (flags & MDB_WRITEMAP) {
+		int rc;
 		prot |= PROT_WRITE;
-		if (ftruncate(env->me_fd, env->me_mapsize) < 0)
-			return ErrCode();
+		/* With a reservation, the next write txn extends the file
+		 * under me_wmutex, so that it can't race with the writer
+		 * of another process.
+		 */
+		if (env->me_mapupper) {
+			env->me_size = 0;
+		} else {
+			if ((rc = mdb_env_truncate(env, env->me_mapsize)))
+				return rc;
+			env->me_size = env->me_mapsize;
+		}
 	}
-	env->me_map = mmap(addr, env->me_mapsize, prot, mmap_flags,
+	/* Map the reserved address space too, pages beyond the file
+	 * are never touched until the map grows over them.
+	 */
+	env->me_maplen = env->me_mapupper > env->me_mapsize ?
+		env->me_mapupper : env->me_mapsize;
+	env->me_map = mmap(addr, env->me_maplen, prot, mmap_flags,
 		env->me_fd, 0);
 	if (env->me_map == MAP_FAILED) {
 		env->me_map = NULL;
@@ -4533,10 +5494,10 @@ mdb_env_map(MDB_env *env, void *addr)
 	if (flags & MDB_NORDAHEAD) {
 		/* Turn off readahead. It's harmful when the DB is larger than RAM. */
 #ifdef MADV_RANDOM
-		madvise(env->me_map, env->me_mapsize, MADV_RANDOM);
+		madvise(env->me_map, env->me_maplen, MADV_RANDOM);
 #else
 #ifdef POSIX_MADV_RANDOM
-		posix_madvise(env->me_map, env->me_mapsize, POSIX_MADV_RANDOM);
+		posix_madvise(env->me_map, env->me_maplen, POSIX_MADV_RANDOM);
 #endif /* POSIX_MADV_RANDOM */
 #endif /* MADV_RANDOM */
 	}
@@ -4585,7 +5546,15 @@ mdb_env_set_mapsize(MDB_env *env, mdb_size_t size)
 		/* For MDB_VL32 this bit is a noop since we dynamically remap
 		 * chunks of the DB anyway.
 		 */
-		munmap(env->me_map, env->me_mapsize);
+#ifndef _WIN32
+		if (size <= env->me_maplen) {
+			/* Fits in the mapping, no need to remap. The next
+			 * write txn extends the file if needed.
+			 */
+			goto done;
+		}
+#endif
+		munmap(env->me_map, env->me_maplen);
 		env->me_mapsize = size;
 		old = (env->me_flags & MDB_FIXEDMAP) ? env->me_map : NULL;
 		rc = mdb_env_map(env, old);
@@ -4593,12 +5562,99 @@ mdb_env_set_mapsize(MDB_env *env, mdb_size_t size)
 			return rc;
 #endif /* !MDB_VL32 */
 	}
+#if !defined(MDB_VL32) && !defined(_WIN32)
+done:
+#endif
 	env->me_mapsize = size;
 	if (env->me_psize)
 		env->me_maxpg = env->me_mapsize / env->me_psize;
 	return MDB_SUCCESS;
 }
 
+int ESECT
+mdb_env_set_mapgrowth(MDB_env *env, mdb_size_t upper, mdb_size_t step, unsigned int percent)
+{
+	if (env->me_map || (!step && percent <= 100))
+		return EINVAL;
+#if !defined(MDB_VL32) && !defined(_WIN32)
+	env->me_mapupper = upper;
+	env->me_growstep = step;
+	env->me_growpct = percent;
+#endif
+	return MDB_SUCCESS;
+}
+
+int ESECT
+mdb_env_set_dirtysize(MDB_env *env, mdb_size_t size)
+{
+	if (!env)
+		return EINVAL;
+	env->me_dirty_size = size;
+	return MDB_SUCCESS;
+}
+
+int ESECT
+mdb_env_set_arenasize(MDB_env *env, mdb_size_t size)
+{
+	if (!env)
+		return EINVAL;
+	env->me_arena_max = size;
+	return MDB_SUCCESS;
+}
+
+/** Grow the map in place so that it holds at least \b maxpg pages.
+ * This only works within the address space reserved by
+ * #mdb_env_set_mapgrowth(), since remapping would move the map
+ * under active transactions. With #MDB_WRITEMAP the file is also
+ * extended to the map size. Only the writer calls this, holding
+ * me_wmutex, so nobody else changes me_mapsize meanwhile.
+ * @param[in] env the environment
+ * @param[in] maxpg the number of pages needed
+ * @return 0 on success, non-zero if the map can't grow that much.
+ */
+static int ESECT
+mdb_env_grow(MDB_env *env, pgno_t maxpg)
+{
+#if !defined(MDB_VL32) && !defined(_WIN32)
+	mdb_size_t size = env->me_mapsize, need = (mdb_size_t)maxpg * env->me_psize;
+	int rc;
+	mdb_size_t upper = env->me_maplen - env->me_maplen % env->me_psize;
+
+	if (need > size) {
+		if (need > upper)
+			return MDB_MAP_FULL;
+		while (size < need) {
+			mdb_size_t next = env->me_growstep ? size + env->me_growstep :
+				size / 100 * env->me_growpct;
+			size = next > size ? next : need;
+		}
+		if (size > upper)
+			size = upper;
+		size -= size % env->me_psize;
+	}
+	if ((env->me_flags & MDB_WRITEMAP) && (mdb_size_t)env->me_size < size) {
+		if ((rc = mdb_env_truncate(env, size)))
+			return rc;
+		env->me_size = size;
+	}
+	env->me_mapsize = size;
+	env->me_maxpg = size / env->me_psize;
+	return MDB_SUCCESS;
+#else
+	return maxpg <= env->me_maxpg ? MDB_SUCCESS : MDB_MAP_FULL;
+#endif
+}
+
+int ESECT
+mdb_env_set_pagesize(MDB_env *env, unsigned int size)
+{
+	if (env->me_map || size < env->me_os_psize || size > MAX_PAGESIZE ||
+		(size & (size - 1)))
+		return EINVAL;
+	env->me_psize = size;
+	return MDB_SUCCESS;
+}
+
 int ESECT
 mdb_env_set_maxdbs(MDB_env *env, MDB_dbi dbs)
 {
@@ -4927,9 +5983,11 @@ mdb_env_open2(MDB_env *env, int prev)
 			return i;
 		DPUTS("new mdbenv");
 		newenv = 1;
-		env->me_psize = env->me_os_psize;
-		if (env->me_psize > MAX_PAGESIZE)
-			env->me_psize = MAX_PAGESIZE;
+		if (!env->me_psize) {
+			env->me_psize = env->me_os_psize;
+			if (env->me_psize > MAX_PAGESIZE)
+				env->me_psize = MAX_PAGESIZE;
+		}
 		memset(&meta, 0, sizeof(meta));
 		mdb_env_init_meta0(env, &meta);
 		meta.mm_mapsize = DEFAULT_MAPSIZE;
@@ -5572,7 +6630,9 @@ mdb_env_open(MDB_env *env, const char *path, unsigned int flags, mdb_mode_t mode
 		flags &= ~MDB_WRITEMAP;
 	} else {
 		if (!((env->me_free_pgs = mdb_midl_alloc(MDB_IDL_UM_MAX)) &&
-			  (env->me_dirty_list = calloc(MDB_IDL_UM_SIZE, sizeof(MDB_ID2)))))
+			  (env->me_dirty_list = mdb_mid2l_alloc(MDB_IDL_UM_MAX)) &&
+			  ((flags & MDB_WRITEMAP) ||
+			   (env->me_dirty_pend = mdb_mid2l_alloc(MDB_DL_PEND)))))
 			rc = ENOMEM;
 	}
 
@@ -5596,7 +6656,13 @@ mdb_env_open(MDB_env *env, const char *path, unsigned int flags, mdb_mode_t mode
 	env->me_dbxs = calloc(env->me_maxdbs, sizeof(MDB_dbx));
 	env->me_dbflags = calloc(env->me_maxdbs, sizeof(uint16_t));
 	env->me_dbiseqs = calloc(env->me_maxdbs, sizeof(unsigned int));
-	if (!(env->me_dbxs && env->me_path && env->me_dbflags && env->me_dbiseqs)) {
+	/* Name index at most half full */
+	for (env->me_dbhmask = 7; env->me_dbhmask < 2 * env->me_maxdbs; )
+		env->me_dbhmask = env->me_dbhmask * 2 + 1;
+	env->me_dbhash = calloc(env->me_dbhmask + 1, sizeof(MDB_dbi));
+	env->me_dbfree = CORE_DBS;
+	if (!(env->me_dbxs && env->me_path && env->me_dbflags && env->me_dbiseqs &&
+		env->me_dbhash)) {
 		rc = ENOMEM;
 		goto leave;
 	}
@@ -5647,14 +6713,15 @@ mdb_env_open(MDB_env *env, const char *path, unsigned int flags, mdb_mode_t mode
 		if (!(flags & MDB_RDONLY)) {
 			MDB_txn *txn;
 			int tsize = sizeof(MDB_txn), size = tsize + env->me_maxdbs *
-				(sizeof(MDB_db)+sizeof(MDB_cursor *)+sizeof(unsigned int)+1);
+				(sizeof(MDB_db)+sizeof(MDB_cursor *)+sizeof(unsigned int)+sizeof(MDB_dbi)+1);
 			if ((env->me_pbuf = calloc(1, env->me_psize)) &&
 				(txn = calloc(1, size)))
 			{
 				txn->mt_dbs = (MDB_db *)((char *)txn + tsize);
 				txn->mt_cursors = (MDB_cursor **)(txn->mt_dbs + env->me_maxdbs);
 				txn->mt_dbiseqs = (unsigned int *)(txn->mt_cursors + env->me_maxdbs);
-				txn->mt_dbflags = (unsigned char *)(txn->mt_dbiseqs + env->me_maxdbs);
+				txn->mt_dbtouch = (MDB_dbi *)(txn->mt_dbiseqs + env->me_maxdbs);
+				txn->mt_dbflags = (unsigned char *)(txn->mt_dbtouch + env->me_maxdbs);
 				txn->mt_env = env;
 #ifdef MDB_VL32
 				txn->mt_rpages = malloc(MDB_TRPAGE_SIZE * sizeof(MDB_ID3));
@@ -5698,12 +6765,21 @@ mdb_env_close0(MDB_env *env, int excl)
 			free(env->me_dbxs[i].md_name.mv_data);
 		free(env->me_dbxs);
 	}
+	free(env->me_dbhash);
 
 	free(env->me_pbuf);
 	free(env->me_dbiseqs);
 	free(env->me_dbflags);
 	free(env->me_path);
-	free(env->me_dirty_list);
+	mdb_mid2l_free(env->me_dirty_pend);
+	mdb_mid2l_free(env->me_dirty_list);
+#ifdef MDB_USE_IO_URING
+	if (env->me_uring) {
+		mdb_uring_close(env->me_uring);
+		free(env->me_uring);
+		env->me_uring = NULL;
+	}
+#endif
 #ifdef MDB_VL32
 	if (env->me_txn0 && env->me_txn0->mt_rpages)
 		free(env->me_txn0->mt_rpages);
@@ -5717,6 +6793,8 @@ mdb_env_close0(MDB_env *env, int excl)
 #endif
 	free(env->me_txn0);
 	mdb_midl_free(env->me_free_pgs);
+	free(env->me_pgruns.pr_nodes);
+	memset(&env->me_pgruns, 0, sizeof(env->me_pgruns));
 
 	if (env->me_flags & MDB_ENV_TXKEY) {
 		pthread_key_delete(env->me_txkey);
@@ -5735,7 +6813,7 @@ mdb_env_close0(MDB_env *env, int excl)
 #ifdef MDB_VL32
 		munmap(env->me_map, NUM_METAS*env->me_psize);
 #else
-		munmap(env->me_map, env->me_mapsize);
+		munmap(env->me_map, env->me_maplen);
 #endif
 	}
 	if (env->me_mfd != INVALID_HANDLE_VALUE)
@@ -5838,15 +6916,18 @@ void ESECT
 mdb_env_close(MDB_env *env)
 {
 	MDB_page *dp;
+	int i;
 
 	if (env == NULL)
 		return;
 
 	VGMEMP_DESTROY(env);
-	while ((dp = env->me_dpages) != NULL) {
-		VGMEMP_DEFINED(&dp->mp_next, sizeof(dp->mp_next));
-		env->me_dpages = dp->mp_next;
-		free(dp);
+	for (i = 0; i < MDB_ARENA_CLASSES; i++) {
+		while ((dp = env->me_dpages[i]) != NULL) {
+			VGMEMP_DEFINED(&dp->mp_next, sizeof(dp->mp_next));
+			env->me_dpages[i] = dp->mp_next;
+			free(dp);
+		}
 	}
 
 	mdb_env_close0(env, 0);
@@ -5948,6 +7029,53 @@ mdb_cmp_memnr(const MDB_val *a, const MDB_val *b)
 	return len_diff<0 ? -1 : len_diff;
 }
 
+/** Read an integer key of \b size 4 or 8 bytes.
+ *	Keys in leaf pages are only 2-byte aligned.
+ */
+static uint64_t
+mdb_ikey(const void *p, size_t size)
+{
+	if (size == sizeof(uint32_t)) {
+		uint32_t u;
+		memcpy(&u, p, sizeof(u));
+		return u;
+	} else {
+		uint64_t u;
+		memcpy(&u, p, sizeof(u));
+		return u;
+	}
+}
+
+	/** Size of a range of #P_LEAF2 integer keys to scan instead of bisect */
+#define MDB_IKEY_SCAN	16
+
+/** Count the leading keys below \b ik in an array of \b n sorted
+ *	integer keys of \b size bytes.
+ */
+static unsigned
+mdb_ikey_scan(const char *p, unsigned n, size_t size, uint64_t ik)
+{
+	unsigned j = 0;
+#ifdef MDB_SSE2
+	if (size == sizeof(uint32_t)) {
+		/* SSE2 compares signed ints only, so flip the sign bits */
+		__m128i bias = _mm_set1_epi32((int)0x80000000U);
+		__m128i k = _mm_xor_si128(_mm_set1_epi32((int)(uint32_t)ik), bias);
+		for (; j + 4 <= n; j += 4) {
+			__m128i v = _mm_loadu_si128((const __m128i *)(p + j*4));
+			int m = _mm_movemask_ps(_mm_castsi128_ps(
+				_mm_cmplt_epi32(_mm_xor_si128(v, bias), k)));
+			if (m != 0xf)	/* the keys are sorted: m is 0, 1, 3 or 7 */
+				return j + (m & 1) + (m >> 1 & 1) + (m >> 2 & 1);
+		}
+	}
+#endif
+	for (; j < n; j++)
+		if (mdb_ikey(p + j*size, size) >= ik)
+			break;
+	return j;
+}
+
 /** Search for key within a page, using binary search.
  * Returns the smallest entry larger or equal to the key.
  * If exactp is non-null, stores whether the found entry was an exact match
@@ -5965,6 +7093,8 @@ mdb_node_search(MDB_cursor *mc, MDB_val *key, int *exactp)
 	MDB_node	*node = NULL;
 	MDB_val	 nodekey;
 	MDB_cmp_func *cmp;
+	size_t	 isize;
+	uint64_t	 ik = 0;
 	DKBUF;
 
 	nkeys = NUMKEYS(mp);
@@ -5987,7 +7117,34 @@ mdb_node_search(MDB_cursor *mc, MDB_val *key, int *exactp)
 			cmp = mdb_cmp_int;
 	}
 
-	if (IS_LEAF2(mp)) {
+	/* Integer keys are compared inline, saving a call per probe */
+	isize = cmp == mdb_cmp_int ? sizeof(unsigned int) :
+		cmp == mdb_cmp_long ? sizeof(mdb_size_t) :
+		cmp == mdb_cmp_cint ? key->mv_size : 0;
+	if (isize == sizeof(uint32_t) || isize == sizeof(uint64_t))
+		ik = mdb_ikey(key->mv_data, isize);
+	else
+		isize = 0;
+
+	if (IS_LEAF2(mp) && isize && isize == mc->mc_db->md_pad && low <= high) {
+		/* Bisect down to a short range, then scan it */
+		unsigned end = high + 1, lo = low, j;
+		node = NODEPTR(mp, 0);	/* fake */
+		while (end - lo > MDB_IKEY_SCAN) {
+			j = (lo + end) >> 1;
+			if (mdb_ikey(LEAF2KEY(mp, j, isize), isize) < ik)
+				lo = j + 1;
+			else
+				end = j;
+		}
+		i = lo + mdb_ikey_scan(LEAF2KEY(mp, lo, isize), end - lo, isize, ik);
+		if (i > (unsigned)high) {
+			i--;
+			rc = 1;
+		} else {
+			rc = mdb_ikey(LEAF2KEY(mp, i, isize), isize) == ik ? 0 : -1;
+		}
+	} else if (IS_LEAF2(mp)) {
 		nodekey.mv_size = mc->mc_db->md_pad;
 		node = NODEPTR(mp, 0);	/* fake */
 		while (low <= high) {
@@ -6008,10 +7165,22 @@ mdb_node_search(MDB_cursor *mc, MDB_val *key, int *exactp)
 			i = (low + high) >> 1;
 
 			node = NODEPTR(mp, i);
+			if (high - low > 8) {
+				/* Fetch both nodes the next probe may look at */
+				MDB_PREFETCH(NODEPTR(mp, (low + i - 1) >> 1));
+				MDB_PREFETCH(NODEPTR(mp, (i + 1 + high) >> 1));
+			}
 			nodekey.mv_size = NODEKSZ(node);
 			nodekey.mv_data = NODEKEY(node);
 
-			rc = cmp(key, &nodekey);
+			if (isize) {
+				uint64_t u = mdb_ikey(nodekey.mv_data, isize);
+				rc = (ik > u) - (ik < u);
+			} else if (cmp == mdb_cmp_memn) {
+				rc = mdb_cmp_memn(key, &nodekey);
+			} else {
+				rc = cmp(key, &nodekey);
+			}
 #if MDB_DEBUG
 			if (IS_LEAF(mp))
 				DPRINTF(("found leaf index %u [%s], rc = %i",
@@ -6405,7 +7574,6 @@ mdb_page_get(MDB_cursor *mc, pgno_t pgno, MDB_page **ret, int *lvl)
 		MDB_txn *tx2 = txn;
 		level = 1;
 		do {
-			MDB_ID2L dl = tx2->mt_u.dirty_list;
 			unsigned x;
 			/* Spilled pages were dirtied in this txn and flushed
 			 * because the dirty list got full. Bring this page
@@ -6419,13 +7587,8 @@ mdb_page_get(MDB_cursor *mc, pgno_t pgno, MDB_page **ret, int *lvl)
 					goto mapped;
 				}
 			}
-			if (dl[0].mid) {
-				unsigned x = mdb_mid2l_search(dl, pgno);
-				if (x <= dl[0].mid && dl[x].mid == pgno) {
-					p = dl[x].mptr;
-					goto done;
-				}
-			}
+			if ((p = mdb_dlist_find(tx2, pgno)) != NULL)
+				goto done;
 			level++;
 		} while ((tx2 = tx2->mt_parent) != NULL);
 	}
@@ -6703,26 +7866,36 @@ mdb_ovpage_free(MDB_cursor *mc, MDB_page *mp)
 			goto release;
 		}
 		/* Remove from dirty list */
-		dl = txn->mt_u.dirty_list;
-		x = dl[0].mid--;
-		for (ix = dl[x]; ix.mptr != mp; ix = iy) {
-			if (x > 1) {
-				x--;
-				iy = dl[x];
-				dl[x] = ix;
-			} else {
-				mdb_cassert(mc, x > 1);
-				j = ++(dl[0].mid);
-				dl[j] = ix;		/* Unsorted. OK when MDB_TXN_ERROR. */
-				txn->mt_flags |= MDB_TXN_ERROR;
-				return MDB_PROBLEM;
+		dl = txn->mt_dirty_pend;
+		if (dl && dl[0].mid && (x = mdb_mid2l_search(dl, pg)) <= dl[0].mid &&
+			dl[x].mid == pg) {
+			for (j = dl[0].mid--; x < j; x++)
+				dl[x] = dl[x+1];
+		} else {
+			dl = txn->mt_u.dirty_list;
+			x = dl[0].mid--;
+			for (ix = dl[x]; ix.mptr != mp; ix = iy) {
+				if (x > 1) {
+					x--;
+					iy = dl[x];
+					dl[x] = ix;
+				} else {
+					mdb_cassert(mc, x > 1);
+					j = ++(dl[0].mid);
+					dl[j] = ix;		/* Unsorted. OK when MDB_TXN_ERROR. */
+					txn->mt_flags |= MDB_TXN_ERROR;
+					return MDB_PROBLEM;
+				}
 			}
 		}
 		txn->mt_dirty_room++;
 		if (!(env->me_flags & MDB_WRITEMAP))
 			mdb_dpage_free(env, mp);
 release:
-		/* Insert in me_pghead */
+		/* Insert in me_pghead. It may be a page used from the low end
+		 * of an indexed run, so rebuild the index when next needed.
+		 */
+		env->me_pgruns.pr_valid = 0;
 		mop = env->me_pghead;
 		j = mop[0] + ovpages;
 		for (i = mop[0]; i && mop[i] < pg; i--)
@@ -6871,6 +8044,82 @@ mdb_cursor_sibling(MDB_cursor *mc, int move_right)
 	return MDB_SUCCESS;
 }
 
+/** Ask the OS to read pages \b lo to \b hi of the map in the background.
+ *	Where that is not available, prefetch their headers into the CPU
+ *	cache, which helps only if they are resident.
+ */
+static void
+mdb_env_prefetch(MDB_env *env, pgno_t lo, pgno_t hi)
+{
+#if defined(MADV_WILLNEED) || defined(POSIX_MADV_WILLNEED)
+	size_t mask = env->me_os_psize - 1;
+	size_t off = ((size_t)lo * env->me_psize) & ~mask;
+	size_t end = (size_t)(hi + 1) * env->me_psize;
+# ifdef MADV_WILLNEED
+	madvise(env->me_map + off, end - off, MADV_WILLNEED);
+# else
+	posix_madvise(env->me_map + off, end - off, POSIX_MADV_WILLNEED);
+# endif
+#else
+	for (; lo <= hi; lo++)
+		MDB_PREFETCH(env->me_map + (size_t)lo * env->me_psize);
+#endif
+}
+
+/** Read ahead the siblings of the cursor's leaf page.
+ *	Called when a scan moved to a sibling page. The next #MDB_cursor.mc_ra
+ *	children of the parent branch page in the direction of the scan are
+ *	requested from the OS, so their reads overlap the scan of this page.
+ *	They are requested in batches once half of the last batch is used.
+ * @param[in] mc The cursor, positioned on the new leaf page.
+ * @param[in] move_right Non-zero if the scan moves right.
+ */
+static void
+mdb_cursor_prefetch(MDB_cursor *mc, int move_right)
+{
+	MDB_env *env = mc->mc_txn->mt_env;
+	MDB_page *pp;
+	int k, from, to, step = move_right ? 1 : -1, ra = mc->mc_ra;
+	pgno_t lo = 0, hi = 0;
+
+	if (mc->mc_snum < 2 || !IS_LEAF(mc->mc_pg[mc->mc_top]))
+		return;
+	pp = mc->mc_pg[mc->mc_top-1];
+	k = mc->mc_ki[mc->mc_top-1];
+	if (pp == mc->mc_ra_pg) {
+		if ((mc->mc_ra_ki - k) * step > ra / 2)
+			return;
+		from = mc->mc_ra_ki + step;
+		/* A dirty page may have lost keys since the last batch */
+		if (from >= (int)NUMKEYS(pp))
+			from = NUMKEYS(pp) - 1;
+	} else {
+		from = k + step;
+	}
+	to = k + step * ra;
+	if (to < 0)
+		to = 0;
+	if (to >= (int)NUMKEYS(pp))
+		to = NUMKEYS(pp) - 1;
+	mc->mc_ra_pg = pp;
+	mc->mc_ra_ki = to;
+	/* Request runs of consecutive pages at once */
+	for (; (to - from) * step >= 0; from += step) {
+		pgno_t pg = NODEPGNO(NODEPTR(pp, from));
+		if (hi && pg == hi + 1) {
+			hi = pg;
+		} else if (hi && pg + 1 == lo) {
+			lo = pg;
+		} else {
+			if (hi)
+				mdb_env_prefetch(env, lo, hi);
+			lo = hi = pg;
+		}
+	}
+	if (hi)
+		mdb_env_prefetch(env, lo, hi);
+}
+
 /** Move the cursor to the next data item. */
 static int
 mdb_cursor_next(MDB_cursor *mc, MDB_val *key, MDB_val *data, MDB_cursor_op op)
@@ -6927,6 +8176,8 @@ mdb_cursor_next(MDB_cursor *mc, MDB_val *key, MDB_val *data, MDB_cursor_op op)
 			mc->mc_flags |= C_EOF;
 			return rc;
 		}
+		if (mc->mc_ra)
+			mdb_cursor_prefetch(mc, 1);
 		mp = mc->mc_pg[mc->mc_top];
 		DPRINTF(("next page is %"Yu", key index %u", mp->mp_pgno, mc->mc_ki[mc->mc_top]));
 	} else
@@ -7013,6 +8264,8 @@ mdb_cursor_prev(MDB_cursor *mc, MDB_val *key, MDB_val *data, MDB_cursor_op op)
 		if ((rc = mdb_cursor_sibling(mc, 0)) != MDB_SUCCESS) {
 			return rc;
 		}
+		if (mc->mc_ra)
+			mdb_cursor_prefetch(mc, 0);
 		mp = mc->mc_pg[mc->mc_top];
 		mc->mc_ki[mc->mc_top] = NUMKEYS(mp) - 1;
 		DPRINTF(("prev page is %"Yu", key index %u", mp->mp_pgno, mc->mc_ki[mc->mc_top]));
@@ -7049,12 +8302,55 @@ mdb_cursor_prev(MDB_cursor *mc, MDB_val *key, MDB_val *data, MDB_cursor_op op)
 	return MDB_SUCCESS;
 }
 
+/** Re-seek a positioned cursor by climbing only as far as needed.
+ * Climb to the lowest branch page whose own separator keys show
+ * that it covers \b key, and search down from there. The cursor's
+ * position tells which bound of each page \b key already satisfies.
+ * @param[in] mc A cursor whose current leaf does not hold \b key.
+ * @param[in] key The key to search for.
+ * @param[in] dir 1 if \b key sorts after the current leaf, -1 if before.
+ * @return 0 on success, non-zero on failure.
+ */
+static int
+mdb_cursor_finger(MDB_cursor *mc, MDB_val *key, int dir)
+{
+	MDB_page	*mp;
+	MDB_node	*node;
+	MDB_val		nodekey;
+	unsigned int	nkeys;
+	int i, j;
+
+	for (i = mc->mc_top; --i > 0; ) {
+		mp = mc->mc_pg[i];
+		nkeys = NUMKEYS(mp);
+		if (nkeys < 2)
+			continue;
+		/* Going right, the page holds key if it sorts before the
+		 * last separator. Going left, if it sorts at or after the
+		 * first one, which is in node 1.
+		 */
+		node = NODEPTR(mp, dir > 0 ? nkeys-1 : 1);
+		nodekey.mv_size = NODEKSZ(node);
+		nodekey.mv_data = NODEKEY(node);
+		if (dir > 0 ? mc->mc_dbx->md_cmp(key, &nodekey) < 0
+			: mc->mc_dbx->md_cmp(key, &nodekey) >= 0)
+			break;
+	}
+	if (i <= 0)
+		return mdb_page_search(mc, key, 0);
+	for (j = i+1; j < mc->mc_snum; j++)
+		MDB_PAGE_UNREF(mc->mc_txn, mc->mc_pg[j]);
+	mc->mc_snum = i + 1;
+	mc->mc_top = i;
+	return mdb_page_search_root(mc, key, 0);
+}
+
 /** Set the cursor on a specific data item. */
 static int
 mdb_cursor_set(MDB_cursor *mc, MDB_val *key, MDB_val *data,
     MDB_cursor_op op, int *exactp)
 {
-	int		 rc;
+	int		 rc, dir;
 	MDB_page	*mp;
 	MDB_node	*leaf = NULL;
 	DKBUF;
@@ -7084,6 +8380,7 @@ mdb_cursor_set(MDB_cursor *mc, MDB_val *key, MDB_val *data,
 			MDB_GET_KEY2(leaf, nodekey);
 		}
 		rc = mc->mc_dbx->md_cmp(key, &nodekey);
+		dir = rc > 0 ? 1 : -1;
 		if (rc == 0) {
 			/* Probably happens rarely, but first node on the page
 			 * was the one we wanted.
@@ -7147,6 +8444,39 @@ mdb_cursor_set(MDB_cursor *mc, MDB_val *key, MDB_val *data,
 				mc->mc_ki[mc->mc_top] = nkeys;
 				return MDB_NOTFOUND;
 			}
+			/* Ascending lookups often land on the next page,
+			 * so try the right sibling before a full descent.
+			 * A key below the sibling's first key belongs at the
+			 * end of the page we just left, so search for it.
+			 */
+			if ((rc = mdb_cursor_sibling(mc, 1)) != MDB_SUCCESS)
+				return rc;
+			mp = mc->mc_pg[mc->mc_top];
+			nkeys = NUMKEYS(mp);
+			if (nkeys) {
+				if (mp->mp_flags & P_LEAF2) {
+					nodekey.mv_data = LEAF2KEY(mp, 0, nodekey.mv_size);
+				} else {
+					leaf = NODEPTR(mp, 0);
+					MDB_GET_KEY2(leaf, nodekey);
+				}
+				if (mc->mc_dbx->md_cmp(key, &nodekey) >= 0) {
+					if (mp->mp_flags & P_LEAF2) {
+						nodekey.mv_data = LEAF2KEY(mp,
+							 nkeys-1, nodekey.mv_size);
+					} else {
+						leaf = NODEPTR(mp, nkeys-1);
+						MDB_GET_KEY2(leaf, nodekey);
+					}
+					if (mc->mc_dbx->md_cmp(key, &nodekey) <= 0) {
+						rc = 0;
+						mc->mc_flags &= ~C_EOF;
+						goto set2;
+					}
+				} else {
+					dir = -1;
+				}
+			}
 		}
 		if (!mc->mc_top) {
 			/* There are no other pages */
@@ -7157,11 +8487,11 @@ mdb_cursor_set(MDB_cursor *mc, MDB_val *key, MDB_val *data,
 			} else
 				return MDB_NOTFOUND;
 		}
+		rc = mdb_cursor_finger(mc, key, dir);
 	} else {
 		mc->mc_pg[0] = 0;
+		rc = mdb_page_search(mc, key, 0);
 	}
-
-	rc = mdb_page_search(mc, key, 0);
 	if (rc != MDB_SUCCESS)
 		return rc;
 
@@ -7913,7 +9243,11 @@ current:
 					id2.mid = pg;
 					id2.mptr = np;
 					/* Note - this page is already counted in parent's dirty_room */
-					rc2 = mdb_mid2l_insert(mc->mc_txn->mt_u.dirty_list, &id2);
+					rc2 = mdb_dlist_add(mc->mc_txn, &id2, 0);
+					if (rc2 == ENOMEM) {
+						mdb_page_free(env, np, ovpages);
+						return ENOMEM;
+					}
 					mdb_cassert(mc, rc2 == 0);
 					/* Currently we make the page look as with put() in the
 					 * parent txn, in case the user peeks at MDB_RESERVEd
@@ -8539,6 +9873,8 @@ mdb_xcursor_init0(MDB_cursor *mc)
 	mx->mx_cursor.mc_top = 0;
 	MC_SET_OVPG(&mx->mx_cursor, NULL);
 	mx->mx_cursor.mc_flags = C_SUB | (mc->mc_flags & (C_ORIG_RDONLY|C_WRITEMAP));
+	mx->mx_cursor.mc_ra = 0;
+	mx->mx_cursor.mc_ra_pg = NULL;
 	mx->mx_dbx.md_name.mv_size = 0;
 	mx->mx_dbx.md_name.mv_data = NULL;
 	mx->mx_dbx.md_cmp = mc->mc_dbx->md_dcmp;
@@ -8641,6 +9977,8 @@ mdb_cursor_init(MDB_cursor *mc, MDB_txn *txn, MDB_dbi dbi, MDB_xcursor *mx)
 	mc->mc_ki[0] = 0;
 	MC_SET_OVPG(mc, NULL);
 	mc->mc_flags = txn->mt_flags & (C_ORIG_RDONLY|C_WRITEMAP);
+	mc->mc_ra = 0;
+	mc->mc_ra_pg = NULL;
 	if (txn->mt_dbs[dbi].md_flags & MDB_DUPSORT) {
 		mdb_tassert(txn, mx != NULL);
 		mc->mc_xcursor = mx;
@@ -8703,6 +10041,18 @@ mdb_cursor_renew(MDB_txn *txn, MDB_cursor *mc)
 	return MDB_SUCCESS;
 }
 
+int
+mdb_cursor_readahead(MDB_cursor *mc, unsigned int pages)
+{
+	if (!mc)
+		return EINVAL;
+#ifndef MDB_VL32	/* the map does not hold the whole file */
+	mc->mc_ra = pages;
+	mc->mc_ra_pg = NULL;
+#endif
+	return MDB_SUCCESS;
+}
+
 /* Return the count of duplicate data items for the current key */
 int
 mdb_cursor_count(MDB_cursor *mc, mdb_size_t *countp)
@@ -8742,13 +10092,244 @@ mdb_cursor_count(MDB_cursor *mc, mdb_size_t *countp)
 	return MDB_SUCCESS;
 }
 
-void
-mdb_cursor_close(MDB_cursor *mc)
+/** Position a cursor on the leaf slot where \b key belongs.
+ * The cursor stack is left pointing at the first entry greater than
+ * or equal to the key, which may be one past the last entry of the leaf.
+ * @param[in] mc The cursor for this operation.
+ * @param[in] key The key to locate, or NULL for the start (\b last == 0)
+ * or end (\b last != 0) of the database.
+ * @param[in] last Non-zero to position after the last entry when \b key is NULL.
+ * @return 0 on success, non-zero on failure.
+ */
+static int
+mdb_cursor_range_edge(MDB_cursor *mc, MDB_val *key, int last)
 {
-	if (mc) {
-		MDB_CURSOR_UNREF(mc, 0);
+	int rc;
+
+	if (key) {
+		if (key->mv_size == 0)
+			return MDB_BAD_VALSIZE;
+		rc = mdb_page_search(mc, key, 0);
+		if (rc == MDB_SUCCESS)
+			mdb_node_search(mc, key, NULL);
+	} else {
+		rc = mdb_page_search(mc, NULL, last ? MDB_PS_LAST : MDB_PS_FIRST);
+		if (rc == MDB_SUCCESS)
+			mc->mc_ki[mc->mc_top] = last ? NUMKEYS(mc->mc_pg[mc->mc_top]) : 0;
 	}
-	if (mc && !mc->mc_backup) {
+	return rc;
+}
+
+int
+mdb_estimate_range(MDB_txn *txn, MDB_dbi dbi, MDB_val *start, MDB_val *end,
+	mdb_size_t *countp, mdb_size_t *errorp)
+{
+	MDB_cursor	mc1, mc2;
+	MDB_xcursor	mx1, mx2;
+	MDB_page	*p1 = NULL, *p2 = NULL;
+	MDB_db		*db;
+	double		dist, fanout;
+	mdb_size_t	exact;
+	int		i, rc;
+
+	if (!countp || !TXN_DBI_EXIST(txn, dbi, DB_USRVALID))
+		return EINVAL;
+
+	if (txn->mt_flags & MDB_TXN_BLOCKED)
+		return MDB_BAD_TXN;
+
+	*countp = 0;
+	if (errorp)
+		*errorp = 0;
+
+	mdb_cursor_init(&mc1, txn, dbi, &mx1);
+	mdb_cursor_init(&mc2, txn, dbi, &mx2);
+	rc = mdb_cursor_range_edge(&mc1, start, 0);
+	if (rc == MDB_SUCCESS)
+		rc = mdb_cursor_range_edge(&mc2, end, 1);
+	if (rc != MDB_SUCCESS)
+		goto done;
+
+	/* Both paths descend the same balanced tree, so they have the
+	 * same depth. Walk them top-down: \b dist is the number of slots
+	 * between the two paths at the current level. Where the paths run
+	 * through different pages, the pages strictly between them are not
+	 * visited; their fan-out is taken from the tree-wide page counts.
+	 * Edge pages are poor samples since the rightmost pages of a tree
+	 * are often only partly filled.
+	 */
+	mdb_cassert(&mc1, mc1.mc_snum == mc2.mc_snum);
+	db = mc1.mc_db;
+	dist = 0;
+	exact = 0;
+	for (i = 0; i < mc1.mc_snum; i++) {
+		p1 = mc1.mc_pg[i];
+		p2 = mc2.mc_pg[i];
+		if (p1 == p2) {
+			dist = (double)mc2.mc_ki[i] - (double)mc1.mc_ki[i];
+			continue;
+		}
+		/* The paths split with the end before the start, the
+		 * range is empty however the pages below would count.
+		 */
+		if (dist <= 0)
+			break;
+		if (IS_BRANCH(p1) && db->md_branch_pages > 1) {
+			/* Every page but the root has one parent pointer */
+			fanout = (double)(db->md_branch_pages + db->md_leaf_pages - 1
+				- NUMKEYS(mc1.mc_pg[0])) / (db->md_branch_pages - 1);
+		} else if (IS_LEAF(p1) && db->md_leaf_pages &&
+			!(db->md_flags & MDB_DUPSORT)) {
+			fanout = (double)db->md_entries / db->md_leaf_pages;
+		} else {
+			fanout = (NUMKEYS(p1) + NUMKEYS(p2)) / 2.0;
+		}
+		exact = NUMKEYS(p1) - mc1.mc_ki[i] + mc2.mc_ki[i];
+		dist = (dist - 1) * fanout + exact;
+	}
+	if (dist > 0) {
+		*countp = (mdb_size_t)(dist + 0.5);
+		/* Only the two edge leaves were counted, the rest is extrapolated */
+		if (errorp && p1 != p2 && *countp > exact)
+			*errorp = *countp - exact;
+	}
+
+done:
+	MDB_CURSOR_UNREF(&mc1, 0);
+	MDB_CURSOR_UNREF(&mc2, 0);
+	return rc == MDB_NOTFOUND ? MDB_SUCCESS : rc;
+}
+
+/** Get the key of entry \b i of page \b mp, for branch and leaf pages */
+static void
+mdb_page_key(MDB_cursor *mc, MDB_page *mp, indx_t i, MDB_val *key)
+{
+	if (IS_LEAF2(mp)) {
+		key->mv_size = mc->mc_db->md_pad;
+		key->mv_data = LEAF2KEY(mp, i, key->mv_size);
+	} else {
+		MDB_node *node = NODEPTR(mp, i);
+		key->mv_size = NODEKSZ(node);
+		key->mv_data = NODEKEY(node);
+	}
+}
+
+int
+mdb_split_points(MDB_txn *txn, MDB_dbi dbi, MDB_val *keys, unsigned int *countp)
+{
+	MDB_cursor	mc;
+	MDB_xcursor	mx;
+	MDB_page	*mp;
+	MDB_val		*lows, *nlows, *tv;
+	pgno_t		*pgs, *npgs, *tp;
+	void		*buf = NULL;
+	unsigned int	n, npages, nnext, j, k, found;
+	size_t		total, item, base;
+	indx_t		i;
+	int		rc;
+
+	if (!countp || (*countp && !keys) || !TXN_DBI_EXIST(txn, dbi, DB_USRVALID))
+		return EINVAL;
+
+	if (txn->mt_flags & MDB_TXN_BLOCKED)
+		return MDB_BAD_TXN;
+
+	n = *countp;
+	*countp = 0;
+	if (!n)
+		return MDB_SUCCESS;
+
+	mdb_cursor_init(&mc, txn, dbi, &mx);
+	rc = mdb_page_search(&mc, NULL, MDB_PS_ROOTONLY);
+	if (rc != MDB_SUCCESS)
+		goto done;
+
+	/* Descend level by level, keeping the pages of the current level
+	 * and the lowest key of each page (taken from its parent; the
+	 * leftmost page has none). A level only gets expanded while it has
+	 * at most \b n entries, so the next level has at most \b n pages.
+	 */
+	buf = malloc(2 * n * (sizeof(MDB_val) + sizeof(pgno_t)));
+	if (!buf) {
+		rc = ENOMEM;
+		goto done;
+	}
+	lows = buf;
+	nlows = lows + n;
+	pgs = (pgno_t *)(nlows + n);
+	npgs = pgs + n;
+	pgs[0] = mc.mc_pg[0]->mp_pgno;
+	lows[0].mv_size = 0;
+	lows[0].mv_data = NULL;
+	npages = 1;
+	for (;;) {
+		total = 0;
+		for (j = 0; j < npages; j++) {
+			if ((rc = mdb_page_get(&mc, pgs[j], &mp, NULL)) != 0)
+				goto done;
+			total += NUMKEYS(mp);
+		}
+		if (IS_LEAF(mp) || total > n)
+			break;
+		nnext = 0;
+		for (j = 0; j < npages; j++) {
+			if ((rc = mdb_page_get(&mc, pgs[j], &mp, NULL)) != 0)
+				goto done;
+			for (i = 0; i < NUMKEYS(mp); i++) {
+				npgs[nnext] = NODEPGNO(NODEPTR(mp, i));
+				if (i)
+					mdb_page_key(&mc, mp, i, &nlows[nnext]);
+				else
+					nlows[nnext] = lows[j];
+				nnext++;
+			}
+		}
+		tp = pgs; pgs = npgs; npgs = tp;
+		tv = lows; lows = nlows; nlows = tv;
+		npages = nnext;
+	}
+
+	/* Pick up to \b n evenly spaced entries of this level. Entry 0 has
+	 * no lower bound, so it never becomes a split point.
+	 */
+	found = 0;
+	base = 0;
+	j = 0;
+	if ((rc = mdb_page_get(&mc, pgs[0], &mp, NULL)) != 0)
+		goto done;
+	for (k = 1; k <= n; k++) {
+		item = (size_t)((double)k * total / (n + 1));
+		if (!item)
+			continue;
+		while (item >= base + NUMKEYS(mp)) {
+			base += NUMKEYS(mp);
+			if ((rc = mdb_page_get(&mc, pgs[++j], &mp, NULL)) != 0)
+				goto done;
+		}
+		if (item == base)
+			keys[found] = lows[j];
+		else
+			mdb_page_key(&mc, mp, item - base, &keys[found]);
+		/* Small levels can map several picks to the same entry */
+		if (found && keys[found].mv_data == keys[found-1].mv_data)
+			continue;
+		found++;
+	}
+	*countp = found;
+
+done:
+	free(buf);
+	MDB_CURSOR_UNREF(&mc, 0);
+	return rc == MDB_NOTFOUND ? MDB_SUCCESS : rc;
+}
+
+void
+mdb_cursor_close(MDB_cursor *mc)
+{
+	if (mc) {
+		MDB_CURSOR_UNREF(mc, 0);
+	}
+	if (mc && !mc->mc_backup) {
 		/* Remove from txn, if tracked.
 		 * A read-only txn (!C_UNTRACK) may have been freed already,
 		 * so do not peek inside it.  Only write txns track cursors.
@@ -9255,6 +10836,8 @@ mdb_cursor_copy(const MDB_cursor *csrc, MDB_cursor *cdst)
 	cdst->mc_snum = csrc->mc_snum;
 	cdst->mc_top = csrc->mc_top;
 	cdst->mc_flags = csrc->mc_flags;
+	cdst->mc_ra = 0;
+	cdst->mc_ra_pg = NULL;
 	MC_SET_OVPG(cdst, MC_OVPG(csrc));
 
 	for (i=0; i<csrc->mc_snum; i++) {
@@ -10030,7 +11613,7 @@ mdb_page_split(MDB_cursor *mc, MDB_val *newkey, MDB_val *newdata, pgno_t newpgno
 
 done:
 	if (copy)					/* tmp page */
-		mdb_page_free(env, copy);
+		mdb_page_free(env, copy, 1);
 	if (rc)
 		mc->mc_txn->mt_flags |= MDB_TXN_ERROR;
 	return rc;
@@ -10066,6 +11649,45 @@ mdb_put(MDB_txn *txn, MDB_dbi dbi,
 #endif
 #define MDB_EOF		0x10	/**< #mdb_env_copyfd1() is done reading */
 
+#if !defined(_WIN32) && !defined(MDB_VL32)
+	/** Compacting copies of large environments to seekable files
+	 *	use several threads, see #mdb_env_copypar().
+	 */
+#define MDB_PCOPY	1
+#endif
+#ifndef MDB_CP_THREADS
+#define MDB_CP_THREADS	8	/**< Max threads of a parallel compacting copy */
+#endif
+#ifndef MDB_CP_PARMIN
+#define MDB_CP_PARMIN	(64*1024*1024)	/**< Min size of a parallel compacting copy */
+#endif
+
+	/** A subtree copied by one thread of a parallel compacting copy. */
+typedef struct mdb_ctask {
+	pgno_t ct_root;		/**< Root page in the environment */
+	pgno_t ct_newroot;	/**< Root page in the copy */
+	pgno_t ct_base;		/**< First page of its range in the copy */
+	pgno_t ct_count;	/**< Number of pages in the subtree */
+	int ct_flags;		/**< #F_DUPDATA if it is part of a sorted-duplicate sub-DB */
+} mdb_ctask;
+
+	/** State shared by the threads of a parallel compacting copy. */
+typedef struct mdb_pcopy {
+	MDB_txn *pc_txn;
+	HANDLE pc_fd;
+	mdb_size_t pc_off;		/**< File offset of the copy */
+	pthread_mutex_t pc_mutex;	/**< Protects #pc_next and the progress */
+	mdb_ctask *pc_tasks;	/**< Sorted by #ct_root */
+	unsigned pc_ntasks;
+	unsigned pc_next;		/**< Next task to take */
+	int pc_copying;			/**< Counting or copying the tasks */
+	MDB_copy_func *pc_func;
+	void *pc_ctx;
+	mdb_size_t pc_done;
+	mdb_size_t pc_total;
+	volatile int pc_error;
+} mdb_pcopy;
+
 	/** State needed for a double-buffering compacting copy. */
 typedef struct mdb_copy {
 	MDB_env *mc_env;
@@ -10080,6 +11702,14 @@ typedef struct mdb_copy {
 	HANDLE mc_fd;
 	int mc_toggle;			/**< Buffer number in provider */
 	int mc_new;				/**< (0-2 buffers to write) | (#MDB_EOF at end) */
+	MDB_copy_func *mc_func;	/**< Progress callback, called by the writer thread */
+	void *mc_ctx;
+	mdb_size_t mc_done;		/**< Bytes written so far */
+	mdb_size_t mc_total;	/**< Bytes the copy will have */
+	mdb_pcopy *mc_par;		/**< Parallel copy this thread takes part in, if any */
+	mdb_size_t mc_woff;		/**< File offset of the next write in a parallel copy */
+	mdb_ctask *mc_tasks;	/**< Subtrees copied by other threads, to skip */
+	unsigned mc_ntasks;
 	/** Error code.  Never cleared if set.  Both threads can set nonzero
 	 *	to fail the copy.  Not mutex-protected, LMDB expects atomic int.
 	 */
@@ -10136,6 +11766,7 @@ again:
 				rc = MDB_SUCCESS;
 				ptr += len;
 				wsize -= len;
+				my->mc_done += len;
 				continue;
 			} else {
 				rc = EIO;
@@ -10152,6 +11783,9 @@ again:
 			my->mc_olen[toggle] = 0;
 			goto again;
 		}
+		if (my->mc_func && !my->mc_error &&
+			(rc = my->mc_func(my->mc_ctx, my->mc_done, my->mc_total)))
+			my->mc_error = rc;
 		my->mc_wlen[toggle] = 0;
 		toggle ^= 1;
 		/* Return the empty buffer to provider */
@@ -10163,7 +11797,57 @@ again:
 #undef DO_WRITE
 }
 
+#ifdef MDB_PCOPY
+	/** Write a buffer of a parallel compacting copy at its place in the file.
+	 *
+	 * @param[in] my control structure of this thread.
+	 * @param[in] toggle the buffer to write.
+	 */
+static int ESECT
+mdb_env_cwrite(mdb_copy *my, int toggle)
+{
+	mdb_pcopy *pc = my->mc_par;
+	char *ptr = my->mc_wbuf[toggle];
+	size_t len = my->mc_wlen[toggle];
+	mdb_size_t total = len + my->mc_olen[toggle];
+	ssize_t w;
+	int rc = MDB_SUCCESS;
+
+	for (;;) {
+		while (len > 0) {
+			w = pwrite(pc->pc_fd, ptr, len, my->mc_woff);
+			if (w < 0) {
+				rc = ErrCode();
+				if (rc == EINTR)
+					continue;
+				return rc;
+			}
+			if (w == 0)
+				return EIO;
+			ptr += w;
+			len -= w;
+			my->mc_woff += w;
+		}
+		/* If there's an overflow page tail, write it too */
+		if (!my->mc_olen[toggle])
+			break;
+		ptr = my->mc_over[toggle];
+		len = my->mc_olen[toggle];
+		my->mc_olen[toggle] = 0;
+	}
+	my->mc_wlen[toggle] = 0;
+	if (pc->pc_func) {
+		pthread_mutex_lock(&pc->pc_mutex);
+		pc->pc_done += total;
+		rc = pc->pc_func(pc->pc_ctx, pc->pc_done, pc->pc_total);
+		pthread_mutex_unlock(&pc->pc_mutex);
+	}
+	return rc;
+}
+#endif
+
 	/** Give buffer and/or #MDB_EOF to writer thread, await unused buffer.
+	 * In a parallel copy, write the buffer instead.
 	 *
 	 * @param[in] my control structure.
 	 * @param[in] adjust (1 to hand off 1 buffer) | (MDB_EOF when ending).
@@ -10171,6 +11855,16 @@ again:
 static int ESECT
 mdb_env_cthr_toggle(mdb_copy *my, int adjust)
 {
+#ifdef MDB_PCOPY
+	if (my->mc_par) {
+		int rc = my->mc_par->pc_error;
+		if (!rc && (rc = mdb_env_cwrite(my, my->mc_toggle)) != 0)
+			my->mc_par->pc_error = rc;
+		my->mc_toggle ^= (adjust & 1);
+		my->mc_wlen[my->mc_toggle] = 0;
+		return rc;
+	}
+#endif
 	pthread_mutex_lock(&my->mc_mutex);
 	my->mc_new += adjust;
 	pthread_cond_signal(&my->mc_cond);
@@ -10184,6 +11878,31 @@ mdb_env_cthr_toggle(mdb_copy *my, int adjust)
 	return my->mc_error;
 }
 
+	/** Find a subtree copied by another thread of a parallel compacting copy.
+	 * @param[in] my control structure.
+	 * @param[in] pg root page of the subtree in the environment.
+	 * @param[out] newpg root page of the subtree in the copy.
+	 * @return 1 if the subtree was copied by another thread.
+	 */
+static int ESECT
+mdb_env_cdone(mdb_copy *my, pgno_t pg, pgno_t *newpg)
+{
+	unsigned lo = 0, hi = my->mc_ntasks;
+
+	while (lo < hi) {
+		unsigned mid = (lo + hi) >> 1;
+		if (my->mc_tasks[mid].ct_root < pg)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo < my->mc_ntasks && my->mc_tasks[lo].ct_root == pg) {
+		*newpg = my->mc_tasks[lo].ct_newroot;
+		return 1;
+	}
+	return 0;
+}
+
 	/** Depth-first tree traversal for compacting copy.
 	 * @param[in] my control structure.
 	 * @param[in,out] pg database root.
@@ -10195,14 +11914,21 @@ mdb_env_cwalk(mdb_copy *my, pgno_t *pg, int flags)
 	MDB_cursor mc = {0};
 	MDB_node *ni;
 	MDB_page *mo, *mp, *leaf;
-	char *buf, *ptr;
+	char *buf;
 	int rc, toggle;
-	unsigned int i;
+	unsigned int i, depth;
+	pgno_t pgno;
 
 	/* Empty DB, nothing to do */
 	if (*pg == P_INVALID)
 		return MDB_SUCCESS;
 
+	/* Copied by another thread */
+	if (my->mc_ntasks && mdb_env_cdone(my, *pg, &pgno)) {
+		*pg = pgno;
+		return MDB_SUCCESS;
+	}
+
 	mc.mc_snum = 1;
 	mc.mc_txn = my->mc_txn;
 	mc.mc_flags = my->mc_txn->mt_flags & (C_ORIG_RDONLY|C_WRITEMAP);
@@ -10210,24 +11936,31 @@ mdb_env_cwalk(mdb_copy *my, pgno_t *pg, int flags)
 	rc = mdb_page_get(&mc, *pg, &mc.mc_pg[0], NULL);
 	if (rc)
 		return rc;
-	rc = mdb_page_search_root(&mc, NULL, MDB_PS_FIRST);
-	if (rc)
-		return rc;
 
-	/* Make cursor pages writable */
-	buf = ptr = malloc(my->mc_env->me_psize * mc.mc_snum);
+	/* Find the depth of the tree */
+	for (depth = 1, mp = mc.mc_pg[0]; IS_BRANCH(mp); depth++) {
+		rc = mdb_page_get(&mc, NODEPGNO(NODEPTR(mp, 0)), &mp, NULL);
+		if (rc)
+			return rc;
+	}
+
+	/* Writable space for the branch pages on the stack, one per
+	 * level, and for a leaf page. Usually the leaf is not needed.
+	 */
+	buf = malloc(my->mc_env->me_psize * depth);
 	if (buf == NULL)
 		return ENOMEM;
+	leaf = (MDB_page *)(buf + my->mc_env->me_psize * (depth - 1));
 
-	for (i=0; i<mc.mc_top; i++) {
-		mdb_page_copy((MDB_page *)ptr, mc.mc_pg[i], my->mc_env->me_psize);
-		mc.mc_pg[i] = (MDB_page *)ptr;
-		ptr += my->mc_env->me_psize;
+	/* A branch page is pushed before its first child, which is
+	 * visited when the loop below advances mc_ki from -1 to 0.
+	 */
+	if (IS_BRANCH(mc.mc_pg[0])) {
+		mdb_page_copy((MDB_page *)buf, mc.mc_pg[0], my->mc_env->me_psize);
+		mc.mc_pg[0] = (MDB_page *)buf;
+		mc.mc_ki[0] = (indx_t)-1;
 	}
 
-	/* This is writable space for a leaf page. Usually not needed. */
-	leaf = (MDB_page *)ptr;
-
 	toggle = my->mc_toggle;
 	while (mc.mc_snum > 0) {
 		unsigned n;
@@ -10298,22 +12031,24 @@ mdb_env_cwalk(mdb_copy *my, pgno_t *pg, int flags)
 		} else {
 			mc.mc_ki[mc.mc_top]++;
 			if (mc.mc_ki[mc.mc_top] < n) {
-				pgno_t pg;
-again:
 				ni = NODEPTR(mp, mc.mc_ki[mc.mc_top]);
-				pg = NODEPGNO(ni);
-				rc = mdb_page_get(&mc, pg, &mp, NULL);
+				pgno = NODEPGNO(ni);
+				if (my->mc_ntasks && mdb_env_cdone(my, pgno, &pgno)) {
+					SETPGNO(ni, pgno);
+					continue;
+				}
+				rc = mdb_page_get(&mc, pgno, &mp, NULL);
 				if (rc)
 					goto done;
 				mc.mc_top++;
 				mc.mc_snum++;
-				mc.mc_ki[mc.mc_top] = 0;
 				if (IS_BRANCH(mp)) {
 					/* Whenever we advance to a sibling branch page,
 					 * we must proceed all the way down to its first leaf.
 					 */
+					mc.mc_pg[mc.mc_top] = (MDB_page *)(buf + my->mc_env->me_psize * mc.mc_top);
 					mdb_page_copy(mc.mc_pg[mc.mc_top], mp, my->mc_env->me_psize);
-					goto again;
+					mc.mc_ki[mc.mc_top] = (indx_t)-1;
 				} else
 					mc.mc_pg[mc.mc_top] = mp;
 				continue;
@@ -10341,13 +12076,322 @@ again:
 		}
 	}
 done:
+	my->mc_toggle = toggle;
 	free(buf);
 	return rc;
 }
 
+#ifdef MDB_PCOPY
+	/** Count the pages a compacting copy of a subtree will have.
+	 * @param[in] txn the read-only transaction of the copy.
+	 * @param[in] pg root page of the subtree.
+	 * @param[in] flags includes #F_DUPDATA if it is part of a sorted-duplicate sub-DB.
+	 * @param[in,out] count incremented by the number of pages.
+	 */
+static int ESECT
+mdb_env_ccount(MDB_txn *txn, pgno_t pg, int flags, pgno_t *count)
+{
+	MDB_cursor mc = {0};
+	MDB_page *mp, *omp;
+	MDB_node *ni;
+	MDB_db db;
+	unsigned int i, n;
+	int rc;
+
+	if (pg == P_INVALID)
+		return MDB_SUCCESS;
+	mc.mc_txn = txn;
+	mc.mc_flags = txn->mt_flags & (C_ORIG_RDONLY|C_WRITEMAP);
+	if ((rc = mdb_page_get(&mc, pg, &mp, NULL)) != 0)
+		return rc;
+	(*count)++;
+	n = NUMKEYS(mp);
+	if (IS_BRANCH(mp)) {
+		for (i=0; i<n; i++) {
+			rc = mdb_env_ccount(txn, NODEPGNO(NODEPTR(mp, i)), flags, count);
+			if (rc)
+				return rc;
+		}
+	} else if (!IS_LEAF2(mp) && !(flags & F_DUPDATA)) {
+		for (i=0; i<n; i++) {
+			ni = NODEPTR(mp, i);
+			if (ni->mn_flags & F_BIGDATA) {
+				memcpy(&pg, NODEDATA(ni), sizeof(pg));
+				if ((rc = mdb_page_get(&mc, pg, &omp, NULL)) != 0)
+					return rc;
+				*count += omp->mp_pages;
+			} else if (ni->mn_flags & F_SUBDATA) {
+				memcpy(&db, NODEDATA(ni), sizeof(db));
+				rc = mdb_env_ccount(txn, db.md_root, ni->mn_flags & F_DUPDATA, count);
+				if (rc)
+					return rc;
+			}
+		}
+	}
+	return MDB_SUCCESS;
+}
+
+static int
+mdb_ctask_cmp(const void *a, const void *b)
+{
+	pgno_t pa = ((const mdb_ctask *)a)->ct_root, pb = ((const mdb_ctask *)b)->ct_root;
+	return pa < pb ? -1 : pa > pb;
+}
+
+	/** Split the trees of a parallel compacting copy into subtrees for
+	 *	the threads. Subtrees are replaced by the subtrees below their
+	 *	root, level by level, until there are enough of them. Below a
+	 *	leaf page are the sub-DBs it holds.
+	 * @param[in] pc the parallel copy.
+	 * @param[in] root root page of the main DB.
+	 * @param[in] target how many subtrees to aim for.
+	 */
+static int ESECT
+mdb_env_ctasks(mdb_pcopy *pc, pgno_t root, unsigned int target)
+{
+	MDB_cursor mc = {0};
+	MDB_page *mp;
+	MDB_node *ni;
+	MDB_db db;
+	mdb_ctask *ct;
+	unsigned int i, j, k, n, round, avail = 64;
+	int rc, flags, expanded;
+
+	mc.mc_txn = pc->pc_txn;
+	mc.mc_flags = pc->pc_txn->mt_flags & (C_ORIG_RDONLY|C_WRITEMAP);
+	if ((pc->pc_tasks = malloc(avail * sizeof(mdb_ctask))) == NULL)
+		return ENOMEM;
+	pc->pc_tasks[0].ct_root = root;
+	pc->pc_tasks[0].ct_flags = 0;
+	pc->pc_ntasks = 1;
+
+	do {
+		expanded = 0;
+		round = pc->pc_ntasks;
+		for (i=0; i<round && pc->pc_ntasks < target; i++) {
+			flags = pc->pc_tasks[i].ct_flags;
+			if ((rc = mdb_page_get(&mc, pc->pc_tasks[i].ct_root, &mp, NULL)) != 0)
+				return rc;
+			if (IS_LEAF(mp) && (IS_LEAF2(mp) || (flags & F_DUPDATA)))
+				continue;
+			n = NUMKEYS(mp);
+			for (j=0, k=0; j<n; j++) {
+				pgno_t pg;
+				int pflags = flags;
+				if (IS_BRANCH(mp)) {
+					pg = NODEPGNO(NODEPTR(mp, j));
+				} else {
+					ni = NODEPTR(mp, j);
+					if (!(ni->mn_flags & F_SUBDATA))
+						continue;
+					memcpy(&db, NODEDATA(ni), sizeof(db));
+					if (db.md_root == P_INVALID)
+						continue;
+					pg = db.md_root;
+					pflags = ni->mn_flags & F_DUPDATA;
+				}
+				if (k++) {
+					if (pc->pc_ntasks == avail) {
+						avail *= 2;
+						if ((ct = realloc(pc->pc_tasks, avail * sizeof(mdb_ctask))) == NULL)
+							return ENOMEM;
+						pc->pc_tasks = ct;
+					}
+					ct = &pc->pc_tasks[pc->pc_ntasks++];
+				} else {
+					/* The first one takes the place of its parent */
+					ct = &pc->pc_tasks[i];
+				}
+				ct->ct_root = pg;
+				ct->ct_flags = pflags;
+				expanded = 1;
+			}
+		}
+	} while (expanded && pc->pc_ntasks < target);
+
+	for (i=0; i<pc->pc_ntasks; i++) {
+		pc->pc_tasks[i].ct_count = 0;
+		pc->pc_tasks[i].ct_newroot = P_INVALID;
+	}
+	qsort(pc->pc_tasks, pc->pc_ntasks, sizeof(mdb_ctask), mdb_ctask_cmp);
+	return MDB_SUCCESS;
+}
+
+	/** Thread of a parallel compacting copy. Takes subtrees and
+	 *	counts or copies them, depending on #pc_copying.
+	 */
+static THREAD_RET ESECT CALL_CONV
+mdb_env_cpthr(void *arg)
+{
+	mdb_pcopy *pc = arg;
+	MDB_env *env = pc->pc_txn->mt_env;
+	mdb_copy my = {0};
+	mdb_ctask *ct;
+	pgno_t pg;
+	int rc;
+
+#ifdef HAVE_MEMALIGN
+	my.mc_wbuf[0] = memalign(env->me_os_psize, MDB_WBUF*2);
+	if (my.mc_wbuf[0] == NULL) {
+		pc->pc_error = errno;
+		return (THREAD_RET)0;
+	}
+#else
+	{
+		void *p;
+		if ((rc = posix_memalign(&p, env->me_os_psize, MDB_WBUF*2)) != 0) {
+			pc->pc_error = rc;
+			return (THREAD_RET)0;
+		}
+		my.mc_wbuf[0] = p;
+	}
+#endif
+	my.mc_wbuf[1] = my.mc_wbuf[0] + MDB_WBUF;
+	my.mc_env = env;
+	my.mc_txn = pc->pc_txn;
+	my.mc_par = pc;
+
+	while (!pc->pc_error) {
+		pthread_mutex_lock(&pc->pc_mutex);
+		ct = pc->pc_next < pc->pc_ntasks ? &pc->pc_tasks[pc->pc_next++] : NULL;
+		pthread_mutex_unlock(&pc->pc_mutex);
+		if (!ct)
+			break;
+		if (!pc->pc_copying) {
+			rc = mdb_env_ccount(pc->pc_txn, ct->ct_root, ct->ct_flags, &ct->ct_count);
+		} else {
+			my.mc_next_pgno = ct->ct_base;
+			my.mc_woff = pc->pc_off + (mdb_size_t)ct->ct_base * env->me_psize;
+			pg = ct->ct_root;
+			rc = mdb_env_cwalk(&my, &pg, ct->ct_flags);
+			if (rc == MDB_SUCCESS && my.mc_wlen[my.mc_toggle])
+				rc = mdb_env_cthr_toggle(&my, 1);
+			if (rc == MDB_SUCCESS && my.mc_next_pgno != ct->ct_base + ct->ct_count)
+				rc = MDB_INCOMPATIBLE;
+			ct->ct_newroot = pg;
+		}
+		if (rc)
+			pc->pc_error = rc;
+	}
+	free(my.mc_wbuf[0]);
+	return (THREAD_RET)0;
+}
+
+	/** Run the threads of a parallel compacting copy over all subtrees. */
+static int ESECT
+mdb_env_cpar(mdb_pcopy *pc, int nthreads)
+{
+	pthread_t thr[MDB_CP_THREADS];
+	int i, n, rc;
+
+	pc->pc_next = 0;
+	for (n=0; n<nthreads; n++) {
+		if ((rc = THREAD_CREATE(thr[n], mdb_env_cpthr, pc)) != 0) {
+			pc->pc_error = rc;
+			break;
+		}
+	}
+	for (i=0; i<n; i++)
+		THREAD_FINISH(thr[i]);
+	return pc->pc_error;
+}
+
+	/** How many threads a compacting copy should use, 0 for the
+	 *	single writer thread. Parallel copies use positional writes,
+	 *	so they need a seekable file.
+	 * @param[in] fd the file to copy to.
+	 * @param[in] total the size of the copy.
+	 * @param[out] off the current offset in the file.
+	 */
+static int ESECT
+mdb_env_cthreads(HANDLE fd, mdb_size_t total, mdb_size_t *off)
+{
+	off_t pos;
+	long n;
+
+	if (total < MDB_CP_PARMIN)
+		return 0;
+	if ((pos = lseek(fd, 0, SEEK_CUR)) < 0)
+		return 0;
+	*off = pos;
+	n = sysconf(_SC_NPROCESSORS_ONLN);
+	if (n > MDB_CP_THREADS)
+		n = MDB_CP_THREADS;
+	return n > 1 ? (int)n : 0;
+}
+
+	/** Copy environment with compaction, using several threads.
+	 *
+	 * The trees are split into subtrees (#mdb_env_ctasks()). The
+	 * threads count the pages of each subtree, which reserves a range
+	 * of page numbers in the copy for it, and then copy the subtrees
+	 * into their ranges at once. Each thread writes its own buffers
+	 * to their place in the file. Finally this thread copies the
+	 * pages above the subtrees, ending with the root of the main DB.
+	 * @param[in] my control structure, with the meta pages in the
+	 * first buffer.
+	 * @param[in] off the offset of the copy in the file.
+	 * @param[in] nthreads the number of threads.
+	 * @param[in,out] root root page of the main DB.
+	 */
+static int ESECT
+mdb_env_copypar(mdb_copy *my, mdb_size_t off, int nthreads, pgno_t *root)
+{
+	mdb_pcopy pc = {0};
+	pgno_t base;
+	unsigned int i;
+	int rc;
+
+	pc.pc_txn = my->mc_txn;
+	pc.pc_fd = my->mc_fd;
+	pc.pc_off = off;
+	pc.pc_func = my->mc_func;
+	pc.pc_ctx = my->mc_ctx;
+	pc.pc_total = my->mc_total;
+	if ((rc = pthread_mutex_init(&pc.pc_mutex, NULL)) != 0)
+		return rc;
+	if ((rc = mdb_env_ctasks(&pc, *root, nthreads * 8)) != 0)
+		goto done;
+
+	if ((rc = mdb_env_cpar(&pc, nthreads)) != 0)
+		goto done;
+	base = NUM_METAS;
+	for (i=0; i<pc.pc_ntasks; i++) {
+		pc.pc_tasks[i].ct_base = base;
+		base += pc.pc_tasks[i].ct_count;
+	}
+
+	/* The meta pages, then the subtrees */
+	my->mc_par = &pc;
+	my->mc_woff = off;
+	if ((rc = mdb_env_cthr_toggle(my, 1)) != 0)
+		goto done;
+	pc.pc_copying = 1;
+	if ((rc = mdb_env_cpar(&pc, nthreads)) != 0)
+		goto done;
+
+	/* The pages above the subtrees */
+	my->mc_tasks = pc.pc_tasks;
+	my->mc_ntasks = pc.pc_ntasks;
+	my->mc_next_pgno = base;
+	my->mc_woff = off + (mdb_size_t)base * my->mc_env->me_psize;
+	rc = mdb_env_cwalk(my, root, 0);
+	if (rc == MDB_SUCCESS && my->mc_wlen[my->mc_toggle])
+		rc = mdb_env_cthr_toggle(my, 1);
+
+done:
+	my->mc_par = NULL;
+	my->mc_tasks = NULL;
+	my->mc_ntasks = 0;
+	free(pc.pc_tasks);
+	pthread_mutex_destroy(&pc.pc_mutex);
+	return rc;
+}
+#endif
+
 	/** Copy environment with compaction. */
 static int ESECT
-mdb_env_copyfd1(MDB_env *env, HANDLE fd)
+mdb_env_copyfd1(MDB_env *env, HANDLE fd, MDB_copy_func *func, void *ctx)
 {
 	MDB_meta *mm;
 	MDB_page *mp;
@@ -10355,7 +12399,7 @@ mdb_env_copyfd1(MDB_env *env, HANDLE fd)
 	MDB_txn *txn = NULL;
 	pthread_t thr;
 	pgno_t root, new_root;
-	int rc = MDB_SUCCESS;
+	int rc = MDB_SUCCESS, eof = 1 | MDB_EOF;
 
 #ifdef _WIN32
 	if (!(my.mc_mutex = CreateMutex(NULL, FALSE, NULL)) ||
@@ -10394,6 +12438,8 @@ mdb_env_copyfd1(MDB_env *env, HANDLE fd)
 	my.mc_next_pgno = NUM_METAS;
 	my.mc_env = env;
 	my.mc_fd = fd;
+	my.mc_func = func;
+	my.mc_ctx = ctx;
 	rc = THREAD_CREATE(thr, mdb_env_copythr, &my);
 	if (rc)
 		goto done;
@@ -10447,9 +12493,27 @@ mdb_env_copyfd1(MDB_env *env, HANDLE fd)
 	if (root != P_INVALID || mm->mm_dbs[MAIN_DBI].md_flags) {
 		mm->mm_txnid = 1;		/* use metapage 1 */
 	}
+	my.mc_total = (mm->mm_last_pg + 1) * env->me_psize;
 
 	my.mc_wlen[0] = env->me_psize * NUM_METAS;
 	my.mc_txn = txn;
+#ifdef MDB_PCOPY
+	{
+		mdb_size_t off;
+		int nthreads = mdb_env_cthreads(fd, my.mc_total, &off);
+		if (nthreads) {
+			/* The writer thread only has to finish */
+			eof = MDB_EOF;
+			rc = mdb_env_copypar(&my, off, nthreads, &root);
+			if (rc == MDB_SUCCESS && root != new_root)
+				rc = MDB_INCOMPATIBLE;	/* page leak or corrupt DB */
+			/* Leave the file offset after the copy, like sequential writes */
+			if (rc == MDB_SUCCESS && lseek(fd, off + my.mc_total, SEEK_SET) < 0)
+				rc = ErrCode();
+			goto finish;
+		}
+	}
+#endif
 	rc = mdb_env_cwalk(&my, &root, 0);
 	if (rc == MDB_SUCCESS && root != new_root) {
 		rc = MDB_INCOMPATIBLE;	/* page leak or corrupt DB */
@@ -10458,7 +12522,7 @@ mdb_env_copyfd1(MDB_env *env, HANDLE fd)
 finish:
 	if (rc)
 		my.mc_error = rc;
-	mdb_env_cthr_toggle(&my, 1 | MDB_EOF);
+	mdb_env_cthr_toggle(&my, eof);
 	rc = THREAD_FINISH(thr);
 	mdb_txn_abort(txn);
 
@@ -10478,12 +12542,12 @@ done2:
 
 	/** Copy environment as-is. */
 static int ESECT
-mdb_env_copyfd0(MDB_env *env, HANDLE fd)
+mdb_env_copyfd0(MDB_env *env, HANDLE fd, MDB_copy_func *func, void *ctx)
 {
 	MDB_txn *txn = NULL;
 	mdb_mutexref_t wmutex = NULL;
 	int rc;
-	mdb_size_t wsize, w3;
+	mdb_size_t wsize, w3, chunk;
 	char *ptr;
 #ifdef _WIN32
 	DWORD len, w2;
@@ -10550,10 +12614,14 @@ mdb_env_copyfd0(MDB_env *env, HANDLE fd)
 		if (w3 > fsize)
 			w3 = fsize;
 	}
+	/* Write in smaller chunks when someone follows the progress */
+	chunk = func ? MDB_WBUF : MAX_WRITE;
+	if (func && (rc = func(ctx, wsize, w3)))
+		goto leave;
 	wsize = w3 - wsize;
 	while (wsize > 0) {
-		if (wsize > MAX_WRITE)
-			w2 = MAX_WRITE;
+		if (wsize > chunk)
+			w2 = chunk;
 		else
 			w2 = wsize;
 		DO_WRITE(rc, fd, ptr, w2, len);
@@ -10564,6 +12632,8 @@ mdb_env_copyfd0(MDB_env *env, HANDLE fd)
 			rc = MDB_SUCCESS;
 			ptr += len;
 			wsize -= len;
+			if (func && (rc = func(ctx, w3 - wsize, w3)))
+				break;
 			continue;
 		} else {
 			rc = EIO;
@@ -10577,12 +12647,19 @@ leave:
 }
 
 int ESECT
-mdb_env_copyfd2(MDB_env *env, HANDLE fd, unsigned int flags)
+mdb_env_copyfd3(MDB_env *env, HANDLE fd, unsigned int flags,
+	MDB_copy_func *func, void *ctx)
 {
 	if (flags & MDB_CP_COMPACT)
-		return mdb_env_copyfd1(env, fd);
+		return mdb_env_copyfd1(env, fd, func, ctx);
 	else
-		return mdb_env_copyfd0(env, fd);
+		return mdb_env_copyfd0(env, fd, func, ctx);
+}
+
+int ESECT
+mdb_env_copyfd2(MDB_env *env, HANDLE fd, unsigned int flags)
+{
+	return mdb_env_copyfd3(env, fd, flags, NULL, NULL);
 }
 
 int ESECT
@@ -10617,6 +12694,218 @@ mdb_env_copy(MDB_env *env, const char *path)
 	return mdb_env_copy2(env, path, 0);
 }
 
+int ESECT
+mdb_env_compact_copy(MDB_env *env, const char *path, mdb_size_t *txnid)
+{
+	txnid_t before, after;
+	int rc;
+
+	if (!env || !path || !txnid || !env->me_map)
+		return EINVAL;
+	before = env->me_txns ? env->me_txns->mti_txnid : mdb_env_pick_meta(env)->mm_txnid;
+	rc = mdb_env_copy2(env, path, MDB_CP_COMPACT);
+	after = env->me_txns ? env->me_txns->mti_txnid : mdb_env_pick_meta(env)->mm_txnid;
+	*txnid = (rc == MDB_SUCCESS && before == after) ? before : 0;
+	return rc;
+}
+
+#if !defined(_WIN32) && !defined(MDB_VL32)
+/** Set up the name of the data file of an environment at \b path */
+static int ESECT
+mdb_fname_data(const char *path, unsigned envflags, MDB_name *fname)
+{
+	int rc = mdb_fname_init(path, envflags, fname);
+	if (rc == MDB_SUCCESS && fname->mn_alloced)
+		mdb_name_cpy(fname->mn_val + fname->mn_len,
+			mdb_suffixes[0][F_ISSET(envflags, MDB_NOSUBDIR)]);
+	return rc;
+}
+
+/** Check for active read transactions of this process */
+static int ESECT
+mdb_env_readers_busy(MDB_env *env)
+{
+	MDB_txninfo *ti = env->me_txns;
+	unsigned int i;
+
+	for (i = 0; i < ti->mti_numreaders; i++) {
+		if (ti->mti_readers[i].mr_pid == env->me_pid &&
+			ti->mti_readers[i].mr_txnid != (txnid_t)-1)
+			return 1;
+	}
+	return 0;
+}
+#endif
+
+int ESECT
+mdb_env_compact_swap(MDB_env *env, const char *path, mdb_size_t txnid)
+{
+#if defined(_WIN32) || defined(MDB_VL32)
+	(void) env; (void) path; (void) txnid;
+#ifdef _WIN32
+	return ERROR_NOT_SUPPORTED;
+#else
+	return ENOTSUP;
+#endif
+#else
+	MDB_txninfo *ti;
+	MDB_name tname, dname;
+	MDB_meta *mm[NUM_METAS];
+	struct flock lock_info;
+	struct stat st;
+	HANDLE fd = INVALID_HANDLE_VALUE, mfd = INVALID_HANDLE_VALUE;
+	size_t len;
+	char *buf = NULL;
+	void *old;
+	txnid_t cur;
+	unsigned int i;
+	int rc, excl;
+
+	if (!env || !path || !env->me_map)
+		return EINVAL;
+	ti = env->me_txns;
+	if ((env->me_flags & MDB_RDONLY) || !ti)
+		return EINVAL;
+	if (env->me_txn)
+		return EBUSY;
+	if ((rc = mdb_fname_data(path, env->me_flags | MDB_NOLOCK, &tname)))
+		return rc;
+	if ((rc = mdb_fname_data(env->me_path, env->me_flags, &dname))) {
+		mdb_fname_destroy(tname);
+		return rc;
+	}
+	if (LOCK_MUTEX(rc, env, env->me_wmutex))
+		goto leave;
+
+	/* Every process with the environment open holds a shared lock
+	 * on the lockfile, upgrading ours only succeeds if we are alone.
+	 */
+	memset((void *)&lock_info, 0, sizeof(lock_info));
+	lock_info.l_type = F_WRLCK;
+	lock_info.l_whence = SEEK_SET;
+	lock_info.l_start = 0;
+	lock_info.l_len = 1;
+	while ((rc = fcntl(env->me_lfd, F_SETLK, &lock_info)) &&
+			(rc = ErrCode()) == EINTR) ;
+	if (rc) {
+		if (rc == EAGAIN || rc == EACCES)
+			rc = EBUSY;
+		goto unlock;
+	}
+	if (mdb_env_readers_busy(env)) {
+		rc = EBUSY;
+		goto share;
+	}
+
+	cur = ti->mti_txnid;
+	if (txnid != cur) {
+		/* Writes committed since the copy was made, make
+		 * it again while the write lock holds them off.
+		 */
+		if (unlink(tname.mn_val) && (rc = ErrCode()) != ENOENT)
+			goto share;
+		if ((rc = mdb_env_copy2(env, path, MDB_CP_COMPACT)))
+			goto share;
+	}
+
+	/* Hold off new readers of this process until the copy is mapped.
+	 * Those taking a reader slot wait for me_rmutex, and those reusing
+	 * one see me_swapping once they show a txnid and wait for it too.
+	 */
+	if (LOCK_MUTEX(rc, env, env->me_rmutex))
+		goto share;
+	env->me_swapping = 1;
+	__sync_synchronize();
+	if (mdb_env_readers_busy(env)) {
+		rc = EBUSY;
+		goto readers;
+	}
+
+	/* Continue the transaction IDs of the environment in the copy */
+	if ((rc = mdb_fopen(env, &tname, MDB_O_RDWR, 0, &fd)))
+		goto readers;
+	len = NUM_METAS * env->me_psize;
+	if (!(buf = malloc(len))) {
+		rc = ENOMEM;
+		goto readers;
+	}
+	if (pread(fd, buf, len, 0) != (ssize_t)len) {
+		rc = ErrCode();
+		if (!rc)
+			rc = MDB_INVALID;
+		goto readers;
+	}
+	for (i = 0; i < NUM_METAS; i++)
+		mm[i] = (MDB_meta *)METADATA((MDB_page *)(buf + i * env->me_psize));
+	i = mm[1]->mm_txnid > mm[0]->mm_txnid;
+	*mm[!i] = *mm[i];
+	mm[cur & 1]->mm_txnid = cur;
+	mm[!(cur & 1)]->mm_txnid = cur ? cur - 1 : 0;
+	if (pwrite(fd, buf, len, 0) != (ssize_t)len) {
+		rc = ErrCode();
+		if (!rc)
+			rc = EIO;
+		goto readers;
+	}
+	if (!fstat(env->me_fd, &st))
+		(void) fchmod(fd, st.st_mode & 07777);
+	if (!(env->me_flags & MDB_NOSYNC) && MDB_FDATASYNC(fd)) {
+		rc = ErrCode();
+		goto readers;
+	}
+	(void) close(fd);
+	fd = INVALID_HANDLE_VALUE;
+
+	if (rename(tname.mn_val, dname.mn_val)) {
+		rc = ErrCode();
+		goto readers;
+	}
+
+	/* The old file is gone, the environment can't go on if this fails */
+	if ((rc = mdb_fopen(env, &dname, MDB_O_RDWR, 0, &fd)) ||
+		(rc = mdb_fopen(env, &dname, MDB_O_META, 0, &mfd)))
+		goto fail;
+	old = (env->me_flags & MDB_FIXEDMAP) ? env->me_map : NULL;
+	munmap(env->me_map, env->me_maplen);
+	env->me_map = NULL;
+	(void) close(env->me_fd);
+	(void) close(env->me_mfd);
+	env->me_fd = fd;
+	env->me_mfd = mfd;
+	fd = mfd = INVALID_HANDLE_VALUE;
+	if ((rc = mdb_env_map(env, old)))
+		goto fail;
+	ti->mti_txnid = cur;
+	/* The freeDB of the copy is empty */
+	env->me_pglast = 0;
+	goto readers;
+
+fail:
+	env->me_flags |= MDB_FATAL_ERROR;
+readers:
+	env->me_swapping = 0;
+	UNLOCK_MUTEX(env->me_rmutex);
+share:
+	excl = 1;
+	{
+		int rc2 = mdb_env_share_locks(env, &excl);
+		if (!rc)
+			rc = rc2;
+	}
+unlock:
+	UNLOCK_MUTEX(env->me_wmutex);
+leave:
+	free(buf);
+	if (fd != INVALID_HANDLE_VALUE)
+		(void) close(fd);
+	if (mfd != INVALID_HANDLE_VALUE)
+		(void) close(mfd);
+	mdb_fname_destroy(tname);
+	mdb_fname_destroy(dname);
+	return rc;
+#endif
+}
+
 int ESECT
 mdb_env_set_flags(MDB_env *env, unsigned int flag, int onoff)
 {
@@ -10733,6 +13022,11 @@ mdb_env_info(MDB_env *env, MDB_envinfo *arg)
 	arg->me_mapsize = env->me_mapsize;
 	arg->me_maxreaders = env->me_maxreaders;
 	arg->me_numreaders = env->me_txns ? env->me_txns->mti_numreaders : 0;
+	arg->me_alloc_time = env->me_alloc_time;
+	arg->me_arena_size = env->me_arena_size;
+	arg->me_arena_hits = env->me_arena_hits;
+	arg->me_arena_misses = env->me_arena_misses;
+	arg->me_arena_frees = env->me_arena_frees;
 	return MDB_SUCCESS;
 }
 
@@ -10759,6 +13053,114 @@ mdb_default_cmp(MDB_txn *txn, MDB_dbi dbi)
 		 : ((f & MDB_REVERSEDUP) ? mdb_cmp_memnr : mdb_cmp_memn));
 }
 
+/** Hash a DB name for #MDB_env.me_dbhash (FNV-1a). */
+static unsigned int
+mdb_dbi_hashname(const char *name, size_t len)
+{
+	unsigned int h = 2166136261U;
+
+	while (len--)
+		h = (h ^ (unsigned char)*name++) * 16777619U;
+	return h;
+}
+
+/** Look up an open DB by name.
+ * @return the DBI, or 0 if no open DB has that name.
+ */
+static MDB_dbi
+mdb_dbi_find(MDB_env *env, const char *name, size_t len)
+{
+	unsigned int mask = env->me_dbhmask, i;
+	MDB_dbi dbi;
+
+	for (i = mdb_dbi_hashname(name, len) & mask; (dbi = env->me_dbhash[i]) != 0;
+		i = (i + 1) & mask) {
+		if (env->me_dbxs[dbi].md_name.mv_size == len &&
+			!memcmp(env->me_dbxs[dbi].md_name.mv_data, name, len))
+			return dbi;
+	}
+	return 0;
+}
+
+/** Add a DB, whose name is already set, to the name index. */
+static void
+mdb_dbi_hash(MDB_env *env, MDB_dbi dbi)
+{
+	MDB_val *name = &env->me_dbxs[dbi].md_name;
+	unsigned int mask = env->me_dbhmask, i;
+
+	for (i = mdb_dbi_hashname(name->mv_data, name->mv_size) & mask;
+		env->me_dbhash[i]; i = (i + 1) & mask) ;
+	env->me_dbhash[i] = dbi;
+	while (env->me_dbfree < env->me_maxdbs &&
+		env->me_dbxs[env->me_dbfree].md_name.mv_size)
+		env->me_dbfree++;
+}
+
+/** Remove a DB, whose name is still set, from the name index.
+ * Later entries of its probe sequence are moved back to fill the gap.
+ */
+static void
+mdb_dbi_unhash(MDB_env *env, MDB_dbi dbi)
+{
+	MDB_val *name = &env->me_dbxs[dbi].md_name;
+	unsigned int mask = env->me_dbhmask, i, j, h;
+
+	for (i = mdb_dbi_hashname(name->mv_data, name->mv_size) & mask;
+		env->me_dbhash[i] != dbi; i = (i + 1) & mask)
+		if (!env->me_dbhash[i])
+			goto done;
+	for (j = i;;) {
+		env->me_dbhash[i] = 0;
+		for (;;) {
+			j = (j + 1) & mask;
+			if (!env->me_dbhash[j])
+				goto done;
+			name = &env->me_dbxs[env->me_dbhash[j]].md_name;
+			h = mdb_dbi_hashname(name->mv_data, name->mv_size) & mask;
+			/* Move it unless its home slot lies cyclically in (i, j] */
+			if (i <= j ? (h <= i || h > j) : (h <= i && h > j))
+				break;
+		}
+		env->me_dbhash[i] = env->me_dbhash[j];
+		i = j;
+	}
+done:
+	if (dbi < env->me_dbfree)
+		env->me_dbfree = dbi;
+}
+
+/** Set up a DB in \b txn on its first use there.
+ * Txns start with only the core DBs set up, so beginning and ending
+ * them does not depend on how many DBs are open. A named DB's record
+ * is copied from the parent txn, or else from the env and marked
+ * #DB_STALE, then listed in #MDB_txn.mt_dbtouch.
+ * @return 1, for use in #TXN_DBI_EXIST().
+ */
+static int
+mdb_dbi_touch(MDB_txn *txn, MDB_dbi dbi)
+{
+	MDB_txn *parent = txn->mt_parent;
+	MDB_env *env = txn->mt_env;
+
+	if (parent) {
+		if (!(parent->mt_dbflags[dbi] & DB_TOUCHED))
+			mdb_dbi_touch(parent, dbi);
+		txn->mt_dbs[dbi] = parent->mt_dbs[dbi];
+		txn->mt_dbflags[dbi] = parent->mt_dbflags[dbi] & ~DB_NEW;
+	} else {
+		uint16_t x = env->me_dbflags[dbi];
+		txn->mt_dbs[dbi].md_flags = x & PERSISTENT_FLAGS;
+		txn->mt_dbflags[dbi] = (x & MDB_VALID) ?
+			DB_TOUCHED|DB_VALID|DB_USRVALID|DB_STALE : DB_TOUCHED;
+		/* Write txns keep their own copy, to catch handles reopened meanwhile */
+		if (txn->mt_dbiseqs != env->me_dbiseqs)
+			txn->mt_dbiseqs[dbi] = env->me_dbiseqs[dbi];
+	}
+	txn->mt_dbtouch[txn->mt_numtouch++] = dbi;
+	return 1;
+}
+
 int mdb_dbi_open(MDB_txn *txn, const char *name, unsigned int flags, MDB_dbi *dbi)
 {
 	MDB_val key, data;
@@ -10796,16 +13198,16 @@ int mdb_dbi_open(MDB_txn *txn, const char *name, unsigned int flags, MDB_dbi *db
 
 	/* Is the DB already open? */
 	len = strlen(name);
-	for (i=CORE_DBS; i<txn->mt_numdbs; i++) {
+	i = mdb_dbi_find(txn->mt_env, name, len);
+	if (i && i < txn->mt_numdbs) {
+		*dbi = i;
+		return MDB_SUCCESS;
+	}
+	/* Find the first free slot */
+	for (i = txn->mt_env->me_dbfree; i < txn->mt_numdbs; i++) {
 		if (!txn->mt_dbxs[i].md_name.mv_size) {
-			/* Remember this free slot */
-			if (!unused) unused = i;
-			continue;
-		}
-		if (len == txn->mt_dbxs[i].md_name.mv_size &&
-			!strncmp(name, txn->mt_dbxs[i].md_name.mv_data, len)) {
-			*dbi = i;
-			return MDB_SUCCESS;
+			unused = i;
+			break;
 		}
 	}
 
@@ -10860,7 +13262,10 @@ int mdb_dbi_open(MDB_txn *txn, const char *name, unsigned int flags, MDB_dbi *db
 		txn->mt_dbxs[slot].md_name.mv_data = namedup;
 		txn->mt_dbxs[slot].md_name.mv_size = len;
 		txn->mt_dbxs[slot].md_rel = NULL;
-		txn->mt_dbflags[slot] = dbflag;
+		mdb_dbi_hash(txn->mt_env, slot);
+		if (!(txn->mt_dbflags[slot] & DB_TOUCHED))
+			txn->mt_dbtouch[txn->mt_numtouch++] = slot;
+		txn->mt_dbflags[slot] = dbflag|DB_TOUCHED;
 		/* txn-> and env-> are the same in read txns, use
 		 * tmp variable to avoid undefined assignment
 		 */
@@ -10904,6 +13309,7 @@ void mdb_dbi_close(MDB_env *env, MDB_dbi dbi)
 	ptr = env->me_dbxs[dbi].md_name.mv_data;
 	/* If there was no name, this was already closed */
 	if (ptr) {
+		mdb_dbi_unhash(env, dbi);
 		env->me_dbxs[dbi].md_name.mv_data = NULL;
 		env->me_dbxs[dbi].md_name.mv_size = 0;
 		env->me_dbflags[dbi] = 0;
@@ -11056,7 +13462,7 @@ int mdb_drop(MDB_txn *txn, MDB_dbi dbi, int del)
 	if (del && dbi >= CORE_DBS) {
 		rc = mdb_del0(txn, MAIN_DBI, &mc->mc_dbx->md_name, NULL, F_SUBDATA);
 		if (!rc) {
-			txn->mt_dbflags[dbi] = DB_STALE;
+			txn->mt_dbflags[dbi] = DB_TOUCHED|DB_STALE;
 			mdb_dbi_close(txn->mt_env, dbi);
 		} else {
 			txn->mt_flags |= MDB_TXN_ERROR;
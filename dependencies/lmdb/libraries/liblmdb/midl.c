@@ -202,17 +202,68 @@ void mdb_midl_xmerge( MDB_IDL idl, MDB_IDL merge )
 {
 	MDB_ID old_id, merge_id, i = merge[0], j = idl[0], k = i+j, total = k;
 	idl[0] = (MDB_ID)-1;		/* delimiter for idl scan below */
-	old_id = idl[j];
+	/* Branch-free: the lists are usually interleaved at random,
+	 * so the branch would be mispredicted half the time.
+	 */
 	while (i) {
-		merge_id = merge[i--];
-		for (; old_id < merge_id; old_id = idl[--j])
-			idl[k--] = old_id;
-		idl[k--] = merge_id;
+		MDB_ID t;
+		old_id = idl[j];
+		merge_id = merge[i];
+		t = old_id < merge_id;
+		idl[k--] = t ? old_id : merge_id;
+		j -= t;
+		i -= t ^ 1;
 	}
 	idl[0] = total;
 }
 
-/* Quicksort + Insertion sort for small arrays */
+/* LSD radix sort for large arrays */
+
+#define RADIX_MIN	512	/**< smallest IDL worth the radix sort */
+#define RADIX_BITS	8
+#define RADIX_SIZE	(1 << RADIX_BITS)
+#define RADIX_PASSES	((int)(sizeof(MDB_ID)*CHAR_BIT / RADIX_BITS))
+
+/** Sort ids[1..n] in descending order using scratch space tmp[1..n].
+ *	All digit counts are taken in one pass, and passes where every
+ *	ID has the same digit are skipped. For page numbers that leaves
+ *	only the low 2-4 bytes to sort.
+ */
+static void
+mdb_midl_radix( MDB_IDL ids, MDB_IDL tmp, unsigned n )
+{
+	unsigned cnt[RADIX_PASSES][RADIX_SIZE];
+	MDB_IDL src = ids, dst = tmp, swap;
+	unsigned i, d, pos;
+	int p, shift;
+
+	memset(cnt, 0, sizeof(cnt));
+	for (i = 1; i <= n; i++) {
+		MDB_ID id = ids[i];
+		for (p = 0; p < RADIX_PASSES; p++, id >>= RADIX_BITS)
+			cnt[p][id & (RADIX_SIZE-1)]++;
+	}
+	for (p = 0, shift = 0; p < RADIX_PASSES; p++, shift += RADIX_BITS) {
+		unsigned *c = cnt[p];
+		if (c[(src[1] >> shift) & (RADIX_SIZE-1)] == n)
+			continue;
+		/* Highest digit goes first */
+		for (pos = 1, d = RADIX_SIZE; d--; ) {
+			unsigned m = c[d];
+			c[d] = pos;
+			pos += m;
+		}
+		for (i = 1; i <= n; i++) {
+			MDB_ID id = src[i];
+			dst[c[(id >> shift) & (RADIX_SIZE-1)]++] = id;
+		}
+		swap = src; src = dst; dst = swap;
+	}
+	if (src != ids)
+		memcpy(ids+1, src+1, n * sizeof(MDB_ID));
+}
+
+/* Quicksort + Insertion sort for small arrays, or when out of memory */
 
 #define SMALL	8
 #define	MIDL_SWAP(a,b)	{ itmp=(a); (a)=(b); (b)=itmp; }
@@ -226,6 +277,14 @@ mdb_midl_sort( MDB_IDL ids )
 	MDB_ID a, itmp;
 
 	ir = (int)ids[0];
+	if (ir >= RADIX_MIN) {
+		MDB_IDL tmp = malloc((ir + 1) * sizeof(MDB_ID));
+		if (tmp) {	/* else fall back to quicksort */
+			mdb_midl_radix(ids, tmp, ir);
+			free(tmp);
+			return;
+		}
+	}
 	l = 1;
 	jstack = 0;
 	for(;;) {
@@ -329,7 +388,7 @@ int mdb_mid2l_insert( MDB_ID2L ids, MDB_ID2 *id )
 		return -1;
 	}
 
-	if ( ids[0].mid >= MDB_IDL_UM_MAX ) {
+	if ( ids[0].mid >= MDB_ID2L_ALLOCLEN(ids) ) {
 		/* too big */
 		return -2;
 
@@ -347,7 +406,7 @@ int mdb_mid2l_insert( MDB_ID2L ids, MDB_ID2 *id )
 int mdb_mid2l_append( MDB_ID2L ids, MDB_ID2 *id )
 {
 	/* Too big? */
-	if (ids[0].mid >= MDB_IDL_UM_MAX) {
+	if (ids[0].mid >= MDB_ID2L_ALLOCLEN(ids)) {
 		return -2;
 	}
 	ids[0].mid++;
@@ -355,6 +414,38 @@ int mdb_mid2l_append( MDB_ID2L ids, MDB_ID2 *id )
 	return 0;
 }
 
+MDB_ID2L mdb_mid2l_alloc(unsigned num)
+{
+	MDB_ID2L ids = malloc((num+2) * sizeof(MDB_ID2));
+	if (ids) {
+		ids->mid = num;
+		ids++;
+		ids->mid = 0;
+	}
+	return ids;
+}
+
+void mdb_mid2l_free(MDB_ID2L ids)
+{
+	if (ids)
+		free(ids-1);
+}
+
+int mdb_mid2l_need( MDB_ID2L *idp, unsigned num )
+{
+	MDB_ID2L ids = *idp;
+	num += (unsigned)ids[0].mid;
+	if (num > ids[-1].mid) {
+		num = (num + num/4 + (256 + 2)) & -256;
+		if (!(ids = realloc(ids-1, num * sizeof(MDB_ID2))))
+			return ENOMEM;
+		ids->mid = num - 2;
+		ids++;
+		*idp = ids;
+	}
+	return 0;
+}
+
 #ifdef MDB_VL32
 unsigned mdb_mid3l_search( MDB_ID3L ids, MDB_ID id )
 {
@@ -0,0 +1,141 @@
+/* midlbench.c - ID list sort and merge benchmark */
+/*
+ * Copyright 2011-2020 Howard Chu, Symas Corp.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted only as authorized by the OpenLDAP
+ * Public License.
+ *
+ * A copy of this license is available in the file LICENSE in the
+ * top-level directory of the distribution or, alternatively, at
+ * <http://www.OpenLDAP.org/license.html>.
+ */
+
+/* Times mdb_midl_sort() and mdb_midl_xmerge() against plain reference
+ * versions on lists of page numbers like those a large commit frees,
+ * and checks that they produce the same lists.
+ * Usage: midlbench [max list size] [rounds]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "midl.h"
+
+static unsigned long long seed = 1;
+
+static MDB_ID rnd(MDB_ID max)
+{
+	seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+	return (MDB_ID)(seed >> 33) % max;
+}
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int cmp_desc(const void *a, const void *b)
+{
+	MDB_ID x = *(const MDB_ID *)a, y = *(const MDB_ID *)b;
+	return x < y ? 1 : x > y ? -1 : 0;
+}
+
+/* The merge as it was before it went branch-free */
+static void ref_xmerge(MDB_IDL idl, MDB_IDL merge)
+{
+	MDB_ID old_id, merge_id, i = merge[0], j = idl[0], k = i+j, total = k;
+	idl[0] = (MDB_ID)-1;
+	old_id = idl[j];
+	while (i) {
+		merge_id = merge[i--];
+		for (; old_id < merge_id; old_id = idl[--j])
+			idl[k--] = old_id;
+		idl[k--] = merge_id;
+	}
+	idl[0] = total;
+}
+
+/* Fill ids with n distinct page numbers below 4n, in random order */
+static void fill(MDB_IDL ids, unsigned n)
+{
+	unsigned i;
+	ids[0] = n;
+	for (i = 1; i <= n; i++)
+		ids[i] = (MDB_ID)i * 4 - rnd(4);
+	for (i = n; i > 1; i--) {
+		unsigned j = 1 + rnd(i);
+		MDB_ID t = ids[i]; ids[i] = ids[j]; ids[j] = t;
+	}
+}
+
+static void check(const char *what, MDB_IDL a, MDB_IDL b)
+{
+	if (a[0] != b[0] || memcmp(a+1, b+1, a[0] * sizeof(MDB_ID))) {
+		fprintf(stderr, "%s: result differs from reference\n", what);
+		exit(1);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned max = argc > 1 ? atoi(argv[1]) : 1000000;
+	int r, rounds = argc > 2 ? atoi(argv[2]) : 5;
+	unsigned n;
+	MDB_IDL a = malloc((2*max + 2) * sizeof(MDB_ID));
+	MDB_IDL b = malloc((2*max + 2) * sizeof(MDB_ID));
+	MDB_IDL m = malloc((max + 1) * sizeof(MDB_ID));
+	MDB_IDL src = malloc((max + 1) * sizeof(MDB_ID));
+
+	if (!a || !b || !m || !src) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+	printf("%10s %12s %12s %12s %12s\n", "ids", "sort ns/id", "qsort ns/id",
+		"merge ns/id", "ref ns/id");
+	for (n = 64; n <= max; n *= 4) {
+		double ts = 0, tq = 0, tm = 0, tr = 0, t;
+		for (r = 0; r < rounds; r++) {
+			fill(src, n);
+			memcpy(a, src, (n+1) * sizeof(MDB_ID));
+			memcpy(b, src, (n+1) * sizeof(MDB_ID));
+			t = now();
+			mdb_midl_sort(a);
+			ts += now() - t;
+			t = now();
+			qsort(b+1, n, sizeof(MDB_ID), cmp_desc);
+			tq += now() - t;
+			check("mdb_midl_sort", a, b);
+
+			/* Split 2n page numbers at random between two
+			 * sorted lists, and merge them again
+			 */
+			{
+				MDB_ID id;
+				a[0] = m[0] = 0;
+				for (id = 2*n; id; id--) {
+					if (rnd(2) && m[0] < n)
+						m[++m[0]] = id;
+					else
+						a[++a[0]] = id;
+				}
+				memcpy(b, a, (a[0]+1) * sizeof(MDB_ID));
+			}
+			t = now();
+			mdb_midl_xmerge(a, m);
+			tm += now() - t;
+			t = now();
+			ref_xmerge(b, m);
+			tr += now() - t;
+			check("mdb_midl_xmerge", a, b);
+		}
+		printf("%10u %12.2f %12.2f %12.2f %12.2f\n", n,
+			ts * 1e9 / rounds / n, tq * 1e9 / rounds / n,
+			tm * 1e9 / rounds / (2*n), tr * 1e9 / rounds / (2*n));
+	}
+	free(a); free(b); free(m); free(src);
+	return 0;
+}
@@ -39,6 +39,16 @@ declare module "node-lmdb" {
 		lastTxnId: number;
 		maxReaders: number;
 		numReaders: number;
+		/** Milliseconds write transactions of this environment spent searching for free pages */
+		allocTime: number;
+		/** Bytes of freed dirty page memory kept for reuse by later write transactions */
+		arenaSize: number;
+		/** Dirty page allocations served from that memory */
+		arenaHits: number;
+		/** Dirty page allocations that had to call malloc */
+		arenaMisses: number;
+		/** Freed dirty page chunks given back to the system */
+		arenaFrees: number;
 	}
 
 
@@ -106,6 +116,18 @@ declare module "node-lmdb" {
 	interface EnvOptions {
 		path?: string;
 		mapSize?: number;
+		/** page size of a newly created environment, a power of two from the OS page size up to 32768 (default is the OS page size) */
+		pageSize?: number;
+		/** grow the memory map automatically up to this size instead of failing with MDB_MAP_FULL */
+		maxMapSize?: number;
+		/** bytes added on each growth of the memory map (default is 0, grow geometrically) */
+		mapGrowthStep?: number;
+		/** the memory map grows to this multiple of its size when mapGrowthStep is not given (default is 2) */
+		mapGrowthFactor?: number;
+		/** bytes of changed pages a write transaction keeps in memory before writing some out early (default is 131071 pages) */
+		maxDirtySize?: number;
+		/** bytes of freed dirty page memory kept for reuse by later write transactions (default is 64MB) */
+		maxArenaSize?: number;
 		maxDbs?: number;
 		maxReaders?: number;
 		noSubdir?: boolean;
@@ -118,10 +140,43 @@ declare module "node-lmdb" {
 		noSync?: boolean;
 		mapAsync?: boolean;
 		unsafeNoLock?: boolean;
+		/** maximum number of closed read-only cursors kept for reuse (default is 32) */
+		cursorPoolSize?: number;
+		/** maximum number of released read-only transactions kept for reuse, each keeps a reader slot (default is 8) */
+		readTxnPoolSize?: number;
+		/** whether read-only transactions on the same snapshot share one reader slot (default is true) */
+		shareReaderSlots?: boolean;
+		/** maximum age in milliseconds of the snapshot shared by env.get* and env.getRange, 0 for no limit (default is 1000) */
+		sharedSnapshotMaxAgeMs?: number;
+		/** read-only transactions holding a snapshot for longer than this are over budget (default is 0, no limit) */
+		maxReadTxnAgeMs?: number;
+		/** read-only transactions more than this many commits behind are over budget (default is 0, no limit) */
+		maxReadTxnLagTxns?: number;
+		/** renew read-only transactions over budget to the latest snapshot; their cursors re-seek to their current key */
+		renewStaleReadTxns?: boolean;
+		/** called once per snapshot for every read-only transaction that went over budget */
+		onReadTxnBudgetExceeded?: (details: ReadTxnBudgetDetails) => void;
+	}
+
+	interface ReadTxnBudgetDetails {
+		txn: Txn;
+		/** stack trace of where the transaction was started */
+		stack: string;
+		ageMs: number;
+		lagTxns: number;
+		/** whether the transaction was renewed (see renewStaleReadTxns) */
+		renewed: boolean;
 	}
 
 	interface TxnOptions {
-		readOnly: boolean;
+		readOnly?: boolean;
+		/** read exactly the snapshot exported by txn.exportSnapshot(), possibly in another thread */
+		snapshot?: SnapshotToken;
+	}
+
+	interface SnapshotToken {
+		snapshotId: number;
+		txnId: number;
 	}
 
 	enum ErrorCodes {
@@ -194,6 +249,29 @@ declare module "node-lmdb" {
 		 */
 		beginTxn(options?: TxnOptions): Txn;
 
+		/**
+		 * Start a read-only transaction, reusing a released handle of this
+		 * environment when possible. Give it back with txn.release().
+		 */
+		acquireReadTxn(): Txn;
+
+		/**
+		 * Read a value without an explicit transaction. All env.get* and
+		 * env.getRange calls share one snapshot per Env, renewed when a newer
+		 * transaction was committed, and reset once the event loop runs.
+		 */
+		getString(dbi: Dbi, key: Key, options?: KeyType): string | null;
+		getBinary(dbi: Dbi, key: Key, options?: KeyType): Buffer | null;
+		getNumber(dbi: Dbi, key: Key, options?: KeyType): number | null;
+		getBoolean(dbi: Dbi, key: Key, options?: KeyType): boolean | null;
+
+		/**
+		 * Read the entries of [start, end) from the shared snapshot.
+		 * @param start first key, or null for the first key of the database
+		 * @param end end of the range (exclusive), or null for past the last key
+		 */
+		getRange(dbi: Dbi, start: Key | null, end: Key | null, options?: KeyType & { limit?: number }): { key: Key; value: Buffer }[];
+
 		/**
 		 * Detatch from the memory-mapped object retrieved with getStringUnsafe()
 		 * or getBinaryUnsafe(). This must be called after reading the object and
@@ -260,20 +338,78 @@ declare module "node-lmdb" {
 			callback?: (err: Error, results: BatchResult[]) => void
 		): void;
 
+		/**
+		 * Scan a whole database on native threads, one read-only transaction
+		 * per partition, all on the same snapshot. Entries are passed to
+		 * `worker` on the main thread in chunks; the callback gets the id of
+		 * the scanned snapshot once every partition is done.
+		 * @param {object} options
+		 * @param options.partitions number of partitions and threads (default is the number of CPUs)
+		 * @param options.chunkSize entries per worker call (default is 1000)
+		 */
+		parallelScan(
+			dbi: Dbi,
+			options: KeyType & {
+				worker: (entries: { key: Key; value: Buffer }[], partition: number) => void;
+				partitions?: number;
+				chunkSize?: number;
+			},
+			callback: (err: Error | null, txnId: number) => void
+		): void;
+
 		copy(
 			path: string,
 			compact?: boolean,
 			callback?: (err: Error) => void
 		): void;
 
+		/**
+		 * Compact the data file in place. The compacted copy is made in the background and
+		 * swapped in when no other process, no other Env of this process and no transaction
+		 * of this Env uses the environment. Throws while a backup, parallelScan or compact of
+		 * this Env is in progress, and the Env can't be closed until the callback is called.
+		 * Not supported on Windows.
+		 */
+		compact(callback: (err: Error | null) => void): void;
+
+		/**
+		 * Write a hot backup to a file descriptor or a writable stream, optionally throttled.
+		 * Neither the file descriptor nor the stream is closed afterwards.
+		 */
+		backup(
+			options: BackupOptions,
+			callback: (err: Error | null) => void
+		): void;
+
 		sync(): void;
 
 		/**
-		 * Close the environment
+		 * Close the environment. Throws while a backup, parallelScan or compact of this Env
+		 * is in progress.
 		 */
 		close(): void;
 	}
 
+	interface BackupProgress {
+		bytes: number;
+		totalBytes: number;
+		pages: number;
+		totalPages: number;
+	}
+
+	interface BackupOptions {
+		fd?: number;
+		stream?: NodeJS.WritableStream;
+		compact?: boolean;
+		maxBytesPerSec?: number;
+		onProgress?: (progress: BackupProgress) => void;
+	}
+
+	interface RangeEstimate {
+		estimate: number;
+		errorBound: number;
+	}
+
 	type DropOptions = { txn?: Txn; justFreePages: boolean };
 
 	/**
@@ -283,6 +419,27 @@ declare module "node-lmdb" {
 		close(): void;
 		drop(options?: DropOptions): void;
 		stat(tx: Txn): Stat;
+
+		/**
+		 * Estimate the number of keys in [start, end) in O(tree depth), without
+		 * scanning the range. Keys on the two boundary leaf pages are counted
+		 * exactly, pages in between are extrapolated from the tree's fan-out.
+		 * For dupSort databases each key is counted once.
+		 * @param start first key of the range, or null for the first key
+		 * @param end end of the range (exclusive), or null for past the last key
+		 */
+		estimateRange(txn: Txn, start: Key | null, end: Key | null, options?: KeyType & { errorBound?: false }): number;
+		/**
+		 * With errorBound, also return how many of the estimated keys were
+		 * extrapolated rather than counted (0 means the estimate is exact).
+		 */
+		estimateRange(txn: Txn, start: Key | null, end: Key | null, options: KeyType & { errorBound: true }): RangeEstimate;
+
+		/**
+		 * Find up to partitions - 1 keys (ascending) that split the database
+		 * into parts of similar size, reading only branch pages near the root.
+		 */
+		splitPoints(txn: Txn, partitions: number, options?: KeyType): Key[];
 	};
 
 	/**
@@ -336,13 +493,35 @@ declare module "node-lmdb" {
 		 * Renew a read-only transaction after it has been reset.
 		 */
 		renew(): void;
+
+		/**
+		 * End a read-only transaction and give its handle back to the pool of
+		 * the environment for env.acquireReadTxn().
+		 */
+		release(): void;
+
+		/**
+		 * Export the snapshot of a read-only transaction, so that other threads
+		 * can read the same version with env.beginTxn({ snapshot }). The token is
+		 * valid until this transaction ends or is reset, even when other
+		 * transactions still share its snapshot.
+		 */
+		exportSnapshot(): SnapshotToken;
 	};
 
 	interface DelOptions {
 		noDupData: boolean;
 	}
+	interface MultipleOptions {
+		arrayType?: "Uint32Array" | "Int32Array" | "Float64Array" | "BigUint64Array" | "Buffer";
+	}
+	type MultipleArray = Uint32Array | Int32Array | Float64Array | BigUint64Array | Buffer;
+	type CursorOptions = KeyType & {
+		/** leaf pages to read ahead when goToNext/goToPrev move to another page (default is 0, off) */
+		readAhead?: number;
+	};
 	class Cursor<T extends Key = string> {
-		constructor(txn: Txn, dbi: Dbi, keyType?: KeyType);
+		constructor(txn: Txn, dbi: Dbi, options?: CursorOptions);
 
 		goToFirst(options?: KeyType): T | null;
 		goToLast(options?: KeyType): T | null;
@@ -350,6 +529,15 @@ declare module "node-lmdb" {
 		goToPrev(options?: KeyType): T | null;
 		goToKey(key: T, options?: KeyType): T | null;
 		goToRange(key: T, options?: KeyType): T | null;
+		/**
+		 * Look up many keys in one call. Sorted (ascending) keys are resolved
+		 * mostly on the current leaf page or its sibling, without descending
+		 * from the root. Returns the value of each key, or null if not found.
+		 */
+		seekMany(keys: T[], options?: KeyType & { valueType?: "binary" }): (Buffer | null)[];
+		seekMany(keys: T[], options: KeyType & { valueType: "string" }): (string | null)[];
+		seekMany(keys: T[], options: KeyType & { valueType: "number" }): (number | null)[];
+		seekMany(keys: T[], options: KeyType & { valueType: "boolean" }): (boolean | null)[];
 
 		goToFirstDup(options?: KeyType): T | null;
 		goToLastDup(options?: KeyType): T | null;
@@ -368,11 +556,25 @@ declare module "node-lmdb" {
 		getCurrentStringUnsafe(fn?: CursorCallback<string>): string | null;
 		getCurrentBinaryUnsafe(fn?: CursorCallback<Buffer>): Buffer | null;
 
+		/**
+		 * Read all data items of the current key of a dupFixed database at once,
+		 * a page at a time. Leaves the cursor on the last data item.
+		 */
+		getMultiple(options?: MultipleOptions): MultipleArray | null;
+		getCurrentMultiple(options?: MultipleOptions): MultipleArray | null;
+		goToNextMultiple(options?: MultipleOptions): MultipleArray | null;
+
 		del(options?: DelOptions): void;
 		put(key: Key, value: Value, options?: PutOptions): void;
 
 		close(): void;
 
+		/**
+		 * Rebind the cursor to another read-only transaction on the same
+		 * database, reusing its handle. Also works after close().
+		 */
+		renew(txn: Txn): void;
+
 		count(): number;
 		exists(key: Value, data?: Value): boolean;
 	}
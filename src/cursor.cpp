@@ -31,19 +31,45 @@ CursorWrap::CursorWrap(MDB_cursor *cursor) {
     this->cursor = cursor;
     this->keyType = NodeLmdbKeyType::StringKey;
     this->freeKey = nullptr;
+    this->readAhead = 0;
 }
 
 CursorWrap::~CursorWrap() {
     if (this->cursor) {
+        this->closeCursor();
         this->dw->Unref();
         this->tw->Unref();
-        mdb_cursor_close(this->cursor);
     }
     if (this->freeKey) {
         this->freeKey(this->key);
     }
 }
 
+int CursorWrap::openCursor(TxnWrap *tw, DbiWrap *dw, MDB_cursor **cursor) {
+    if ((tw->flags & MDB_RDONLY) && dw->ew) {
+        *cursor = dw->ew->takePooledCursor(tw->txn, dw->dbi);
+        if (*cursor) {
+            return 0;
+        }
+    }
+    return mdb_cursor_open(tw->txn, dw->dbi, cursor);
+}
+
+void CursorWrap::closeCursor() {
+    auto &cursors = this->tw->cursors;
+    auto it = std::find(cursors.begin(), cursors.end(), this);
+    if (it != cursors.end()) {
+        cursors.erase(it);
+    }
+    if ((this->tw->flags & MDB_RDONLY) && this->dw->ew) {
+        this->dw->ew->releaseCursor(this->cursor);
+    }
+    else {
+        mdb_cursor_close(this->cursor);
+    }
+    this->cursor = nullptr;
+}
+
 NAN_METHOD(CursorWrap::ctor) {
     Nan::HandleScope scope;
 
@@ -70,18 +96,30 @@ NAN_METHOD(CursorWrap::ctor) {
 
     // Open the cursor
     MDB_cursor *cursor;
-    int rc = mdb_cursor_open(tw->txn, dw->dbi, &cursor);
+    int rc = openCursor(tw, dw, &cursor);
     if (rc != 0) {
         return throwLmdbError(rc);
     }
 
+    // Read ahead sibling pages during scans
+    unsigned int readAhead = 0;
+    if (info[2]->IsObject()) {
+        Local<Value> readAheadOption = Local<Object>::Cast(info[2])->Get(Nan::GetCurrentContext(), Nan::New<String>("readAhead").ToLocalChecked()).ToLocalChecked();
+        if (readAheadOption->IsUint32()) {
+            readAhead = readAheadOption->Uint32Value(Nan::GetCurrentContext()).FromJust();
+            mdb_cursor_readahead(cursor, readAhead);
+        }
+    }
+
     // Create wrapper
     CursorWrap* cw = new CursorWrap(cursor);
+    cw->readAhead = readAhead;
     cw->dw = dw;
     cw->dw->Ref();
     cw->tw = tw;
     cw->tw->Ref();
     cw->keyType = keyType;
+    cw->tw->cursors.push_back(cw);
     cw->Wrap(info.This());
 
     return info.GetReturnValue().Set(info.This());
@@ -91,10 +129,73 @@ NAN_METHOD(CursorWrap::close) {
     Nan::HandleScope scope;
 
     CursorWrap *cw = Nan::ObjectWrap::Unwrap<CursorWrap>(info.This());
-    mdb_cursor_close(cw->cursor);
+    if (!cw->cursor) {
+        return Nan::ThrowError("The cursor is already closed.");
+    }
+    cw->closeCursor();
     cw->dw->Unref();
     cw->tw->Unref();
-    cw->cursor = nullptr;
+}
+
+NAN_METHOD(CursorWrap::renew) {
+    Nan::HandleScope scope;
+
+    if (info.Length() != 1 || !info[0]->IsObject()) {
+        return Nan::ThrowError("cursor.renew should be called with a single argument which is a read-only txn.");
+    }
+
+    CursorWrap *cw = Nan::ObjectWrap::Unwrap<CursorWrap>(info.This());
+    TxnWrap *tw = Nan::ObjectWrap::Unwrap<TxnWrap>(Local<Object>::Cast(info[0]));
+
+    if (!tw->txn) {
+        return Nan::ThrowError("The transaction is already closed.");
+    }
+    if (!(tw->flags & MDB_RDONLY)) {
+        return Nan::ThrowError("Only cursors of read-only transactions can be renewed.");
+    }
+
+    // The current key may point into the previous transaction's snapshot
+    if (cw->freeKey) {
+        cw->freeKey(cw->key);
+        cw->freeKey = nullptr;
+    }
+    cw->key.mv_size = 0;
+    cw->key.mv_data = nullptr;
+
+    int rc;
+    if (cw->cursor && (cw->tw->flags & MDB_RDONLY)) {
+        rc = mdb_cursor_renew(tw->txn, cw->cursor);
+        if (rc != 0) {
+            return throwLmdbError(rc);
+        }
+        auto &cursors = cw->tw->cursors;
+        cursors.erase(std::find(cursors.begin(), cursors.end(), cw));
+        cw->tw->Unref();
+    }
+    else {
+        // Closed, or bound to a write transaction: get a fresh handle
+        MDB_cursor *cursor;
+        rc = openCursor(tw, cw->dw, &cursor);
+        if (rc != 0) {
+            return throwLmdbError(rc);
+        }
+        if (cw->cursor) {
+            cw->closeCursor();
+            cw->tw->Unref();
+        }
+        else {
+            cw->dw->Ref();
+        }
+        cw->cursor = cursor;
+    }
+    // Renewing resets the read-ahead setting
+    if (cw->readAhead) {
+        mdb_cursor_readahead(cw->cursor, cw->readAhead);
+    }
+
+    cw->tw = tw;
+    cw->tw->Ref();
+    cw->tw->cursors.push_back(cw);
 }
 
 NAN_METHOD(CursorWrap::del) {
@@ -438,6 +539,343 @@ MAKE_GET_FUNC(goToNextNoDup, MDB_NEXT_NODUP);
 
 MAKE_GET_FUNC(goToPrevNoDup, MDB_PREV_NODUP);
 
+NAN_METHOD(CursorWrap::seekMany) {
+    Nan::HandleScope scope;
+
+    CursorWrap *cw = Nan::ObjectWrap::Unwrap<CursorWrap>(info.This());
+    if (!info[0]->IsArray()) {
+        return Nan::ThrowError("cursor.seekMany should be called with an array of keys.");
+    }
+
+    Local<Value> (*convertFunc)(MDB_val &data) = valToBinary;
+    if (info[1]->IsObject()) {
+        Local<Value> valueType = Local<Object>::Cast(info[1])->Get(Nan::GetCurrentContext(), Nan::New<String>("valueType").ToLocalChecked()).ToLocalChecked();
+        if (!valueType->IsUndefined()) {
+            Nan::Utf8String name(valueType);
+            if (*name != nullptr && !strcmp(*name, "string")) {
+                convertFunc = valToString;
+            }
+            else if (*name != nullptr && !strcmp(*name, "number")) {
+                convertFunc = valToNumber;
+            }
+            else if (*name != nullptr && !strcmp(*name, "boolean")) {
+                convertFunc = valToBoolean;
+            }
+            else if (*name == nullptr || strcmp(*name, "binary")) {
+                return Nan::ThrowError("Invalid valueType. Should be binary, string, number or boolean.");
+            }
+        }
+    }
+
+    // The cursor is moved by every lookup, so the current key no longer needs to be kept
+    if (cw->freeKey) {
+        cw->freeKey(cw->key);
+        cw->freeKey = nullptr;
+    }
+    cw->key.mv_size = 0;
+    cw->key.mv_data = nullptr;
+
+    Local<Context> context = Nan::GetCurrentContext();
+    Local<Array> keys = Local<Array>::Cast(info[0]);
+    uint32_t length = keys->Length();
+    Local<Array> results = Nan::New<Array>(length);
+
+    for (uint32_t i = 0; i < length; i++) {
+        Local<Value> keyHandle = keys->Get(context, i).ToLocalChecked();
+
+        bool keyIsValid;
+        auto keyType = inferAndValidateKeyType(keyHandle, info[1], cw->keyType, keyIsValid);
+        if (!keyIsValid) {
+            // inferAndValidateKeyType already threw an error
+            return;
+        }
+        MDB_val key, data;
+        auto freeKey = argToKey(keyHandle, key, keyType, keyIsValid);
+        if (!keyIsValid) {
+            // argToKey already threw an error
+            return;
+        }
+
+        // For ascending keys, mdb_cursor_get resolves most lookups on the current leaf page or its right sibling
+        MDB_val lookupKey = key;
+        int rc = mdb_cursor_get(cw->cursor, &lookupKey, &data, MDB_SET_KEY);
+        if (freeKey) {
+            freeKey(key);
+        }
+
+        if (rc == MDB_NOTFOUND) {
+            results->Set(context, i, Nan::Null());
+            continue;
+        }
+        else if (rc != 0) {
+            return throwLmdbError(rc);
+        }
+
+        // Leave the cursor's own key on the last match, pointing inside LMDB
+        cw->key = lookupKey;
+        cw->data = data;
+        results->Set(context, i, convertFunc(data));
+    }
+
+    info.GetReturnValue().Set(results);
+}
+
+int CursorWrap::cursorGet(MDB_val *data, MDB_cursor_op op) {
+    // Same bookkeeping as getCommon: once the key points inside LMDB, the user supplied key can be freed
+    MDB_val tempKey = this->key;
+    int rc = mdb_cursor_get(this->cursor, &(this->key), data, op);
+    if (tempKey.mv_data != this->key.mv_data && this->freeKey) {
+        this->freeKey(tempKey);
+        this->freeKey = nullptr;
+    }
+    return rc;
+}
+
+enum class MultipleArrayType {
+    Default,
+    Buffer,
+    Uint32,
+    Int32,
+    Float64,
+    BigUint64
+};
+
+static bool multipleArrayTypeFromOptions(const Local<Value> &options, MultipleArrayType &arrayType) {
+    arrayType = MultipleArrayType::Default;
+    if (!options->IsObject()) {
+        return true;
+    }
+
+    Local<Value> value = Local<Object>::Cast(options)->Get(Nan::GetCurrentContext(), Nan::New<String>("arrayType").ToLocalChecked()).ToLocalChecked();
+    if (value->IsUndefined()) {
+        return true;
+    }
+
+    Nan::Utf8String name(value);
+    if (*name == nullptr) {
+        Nan::ThrowError("Invalid arrayType. Should be Uint32Array, Int32Array, Float64Array, BigUint64Array or Buffer.");
+        return false;
+    }
+
+    if (!strcmp(*name, "Buffer")) {
+        arrayType = MultipleArrayType::Buffer;
+        return true;
+    }
+    else if (!strcmp(*name, "Uint32Array")) {
+        arrayType = MultipleArrayType::Uint32;
+        return true;
+    }
+    else if (!strcmp(*name, "Int32Array")) {
+        arrayType = MultipleArrayType::Int32;
+        return true;
+    }
+    else if (!strcmp(*name, "Float64Array")) {
+        arrayType = MultipleArrayType::Float64;
+        return true;
+    }
+    #if NODE_VERSION_AT_LEAST(12,0,0)
+    else if (!strcmp(*name, "BigUint64Array")) {
+        arrayType = MultipleArrayType::BigUint64;
+        return true;
+    }
+    #endif
+
+    Nan::ThrowError("Invalid arrayType. Should be Uint32Array, Int32Array, Float64Array, BigUint64Array or Buffer.");
+    return false;
+}
+
+// Wraps a node::Buffer holding fixed size data items into a typed array of the requested type
+static Local<Value> multipleToHandle(Local<Object> buffer, size_t itemSize, MultipleArrayType arrayType, int dbiFlags) {
+    if (arrayType == MultipleArrayType::Default) {
+        if (itemSize == 4) {
+            arrayType = MultipleArrayType::Uint32;
+        }
+        else if (itemSize == 8) {
+            #if NODE_VERSION_AT_LEAST(12,0,0)
+            arrayType = (dbiFlags & MDB_INTEGERDUP) ? MultipleArrayType::BigUint64 : MultipleArrayType::Float64;
+            #else
+            arrayType = MultipleArrayType::Float64;
+            #endif
+        }
+        else {
+            arrayType = MultipleArrayType::Buffer;
+        }
+    }
+
+    size_t itemSizeOfType = 0;
+    switch (arrayType) {
+    case MultipleArrayType::Uint32:
+    case MultipleArrayType::Int32:
+        itemSizeOfType = 4;
+        break;
+    case MultipleArrayType::Float64:
+    case MultipleArrayType::BigUint64:
+        itemSizeOfType = 8;
+        break;
+    default:
+        return buffer;
+    }
+    if (itemSize != itemSizeOfType) {
+        Nan::ThrowError("The arrayType doesn't match the size of the data items.");
+        return Nan::Undefined();
+    }
+
+    auto view = buffer.As<Uint8Array>();
+    Local<ArrayBuffer> arrayBuffer = view->Buffer();
+    size_t offset = view->ByteOffset();
+    size_t length = view->ByteLength() / itemSize;
+    switch (arrayType) {
+    case MultipleArrayType::Uint32:
+        return Uint32Array::New(arrayBuffer, offset, length);
+    case MultipleArrayType::Int32:
+        return Int32Array::New(arrayBuffer, offset, length);
+    case MultipleArrayType::Float64:
+        return Float64Array::New(arrayBuffer, offset, length);
+    #if NODE_VERSION_AT_LEAST(12,0,0)
+    case MultipleArrayType::BigUint64:
+        return BigUint64Array::New(arrayBuffer, offset, length);
+    #endif
+    default:
+        return buffer;
+    }
+}
+
+// Copies a chunk of fixed size data items returned by MDB_GET_MULTIPLE / MDB_NEXT_MULTIPLE
+static Local<Value> multipleChunkToHandle(MDB_val &data, size_t itemSize, MultipleArrayType arrayType, int dbiFlags) {
+    Local<Object> buffer = Nan::CopyBuffer((char*)data.mv_data, data.mv_size).ToLocalChecked();
+    return multipleToHandle(buffer, itemSize, arrayType, dbiFlags);
+}
+
+NAN_METHOD(CursorWrap::getMultiple) {
+    Nan::HandleScope scope;
+
+    CursorWrap *cw = Nan::ObjectWrap::Unwrap<CursorWrap>(info.This());
+    if (!(cw->dw->flags & MDB_DUPFIXED)) {
+        return Nan::ThrowError("Dbi is not MDB_DUPFIXED");
+    }
+    MultipleArrayType arrayType;
+    if (!multipleArrayTypeFromOptions(info[0], arrayType)) {
+        return;
+    }
+
+    MDB_val data;
+    int rc = cw->cursorGet(&data, MDB_GET_CURRENT);
+    if (rc == MDB_NOTFOUND) {
+        return info.GetReturnValue().Set(Nan::Null());
+    }
+    else if (rc != 0) {
+        return throwLmdbError(rc);
+    }
+
+    mdb_size_t count;
+    rc = mdb_cursor_count(cw->cursor, &count);
+    if (rc != 0) {
+        return throwLmdbError(rc);
+    }
+
+    size_t itemSize = data.mv_size;
+    size_t total = count * itemSize;
+    Local<Object> buffer = Nan::NewBuffer(total).ToLocalChecked();
+    char *target = node::Buffer::Data(buffer);
+
+    if (count == 1) {
+        memcpy(target, data.mv_data, itemSize);
+    }
+    else {
+        // Rewind to the first page of data items, then copy one page per call
+        size_t offset = 0;
+        rc = cw->cursorGet(&data, MDB_FIRST_DUP);
+        MDB_cursor_op op = MDB_GET_MULTIPLE;
+        while (rc == 0 && (rc = cw->cursorGet(&data, op)) == 0) {
+            if (offset + data.mv_size > total) {
+                return Nan::ThrowError("The data items changed while they were read.");
+            }
+            memcpy(target + offset, data.mv_data, data.mv_size);
+            offset += data.mv_size;
+            op = MDB_NEXT_MULTIPLE;
+        }
+        if (rc != MDB_NOTFOUND) {
+            return throwLmdbError(rc);
+        }
+        if (offset != total) {
+            return Nan::ThrowError("The data items changed while they were read.");
+        }
+    }
+
+    info.GetReturnValue().Set(multipleToHandle(buffer, itemSize, arrayType, cw->dw->flags));
+}
+
+NAN_METHOD(CursorWrap::getCurrentMultiple) {
+    Nan::HandleScope scope;
+
+    CursorWrap *cw = Nan::ObjectWrap::Unwrap<CursorWrap>(info.This());
+    if (!(cw->dw->flags & MDB_DUPFIXED)) {
+        return Nan::ThrowError("Dbi is not MDB_DUPFIXED");
+    }
+    MultipleArrayType arrayType;
+    if (!multipleArrayTypeFromOptions(info[0], arrayType)) {
+        return;
+    }
+
+    MDB_val data;
+    int rc = cw->cursorGet(&data, MDB_GET_CURRENT);
+    if (rc == MDB_NOTFOUND) {
+        return info.GetReturnValue().Set(Nan::Null());
+    }
+    else if (rc != 0) {
+        return throwLmdbError(rc);
+    }
+
+    // A key with a single data item has no sub-database, so MDB_GET_MULTIPLE would leave data unset
+    mdb_size_t count;
+    rc = mdb_cursor_count(cw->cursor, &count);
+    if (rc == 0 && count > 1) {
+        size_t itemSize = data.mv_size;
+        rc = cw->cursorGet(&data, MDB_GET_MULTIPLE);
+        if (rc == 0) {
+            return info.GetReturnValue().Set(multipleChunkToHandle(data, itemSize, arrayType, cw->dw->flags));
+        }
+    }
+    if (rc != 0) {
+        return throwLmdbError(rc);
+    }
+
+    info.GetReturnValue().Set(multipleChunkToHandle(data, data.mv_size, arrayType, cw->dw->flags));
+}
+
+NAN_METHOD(CursorWrap::goToNextMultiple) {
+    Nan::HandleScope scope;
+
+    CursorWrap *cw = Nan::ObjectWrap::Unwrap<CursorWrap>(info.This());
+    if (!(cw->dw->flags & MDB_DUPFIXED)) {
+        return Nan::ThrowError("Dbi is not MDB_DUPFIXED");
+    }
+    MultipleArrayType arrayType;
+    if (!multipleArrayTypeFromOptions(info[0], arrayType)) {
+        return;
+    }
+
+    MDB_val data;
+    int rc = cw->cursorGet(&data, MDB_GET_CURRENT);
+    if (rc == MDB_NOTFOUND) {
+        return info.GetReturnValue().Set(Nan::Null());
+    }
+    else if (rc != 0) {
+        return throwLmdbError(rc);
+    }
+
+    size_t itemSize = data.mv_size;
+    rc = cw->cursorGet(&data, MDB_NEXT_MULTIPLE);
+    if (rc == MDB_NOTFOUND) {
+        return info.GetReturnValue().Set(Nan::Null());
+    }
+    else if (rc != 0) {
+        return throwLmdbError(rc);
+    }
+
+    info.GetReturnValue().Set(multipleChunkToHandle(data, itemSize, arrayType, cw->dw->flags));
+}
+
 static void fillDataFromArg1(CursorWrap* cw, Nan::NAN_METHOD_ARGS_TYPE info, MDB_val &data) {
     if (info[1]->IsString()) {
         CustomExternalStringResource::writeTo(Local<String>::Cast(info[1]), &data);
@@ -525,6 +963,7 @@ void CursorWrap::setupExports(Local<Object> exports) {
     cursorTpl->InstanceTemplate()->SetInternalFieldCount(1);
     // CursorWrap: Add functions to the prototype
     cursorTpl->PrototypeTemplate()->Set(Nan::New<String>("close").ToLocalChecked(), Nan::New<FunctionTemplate>(CursorWrap::close));
+    cursorTpl->PrototypeTemplate()->Set(Nan::New<String>("renew").ToLocalChecked(), Nan::New<FunctionTemplate>(CursorWrap::renew));
     cursorTpl->PrototypeTemplate()->Set(Nan::New<String>("getCurrentString").ToLocalChecked(), Nan::New<FunctionTemplate>(CursorWrap::getCurrentString));
     cursorTpl->PrototypeTemplate()->Set(Nan::New<String>("getCurrentStringUnsafe").ToLocalChecked(), Nan::New<FunctionTemplate>(CursorWrap::getCurrentStringUnsafe));
     cursorTpl->PrototypeTemplate()->Set(Nan::New<String>("getCurrentBinary").ToLocalChecked(), Nan::New<FunctionTemplate>(CursorWrap::getCurrentBinary));
@@ -545,6 +984,10 @@ void CursorWrap::setupExports(Local<Object> exports) {
     cursorTpl->PrototypeTemplate()->Set(Nan::New<String>("goToPrevNoDup").ToLocalChecked(), Nan::New<FunctionTemplate>(CursorWrap::goToPrevNoDup));
     cursorTpl->PrototypeTemplate()->Set(Nan::New<String>("goToDup").ToLocalChecked(), Nan::New<FunctionTemplate>(CursorWrap::goToDup));
     cursorTpl->PrototypeTemplate()->Set(Nan::New<String>("goToDupRange").ToLocalChecked(), Nan::New<FunctionTemplate>(CursorWrap::goToDupRange));
+    cursorTpl->PrototypeTemplate()->Set(Nan::New<String>("seekMany").ToLocalChecked(), Nan::New<FunctionTemplate>(CursorWrap::seekMany));
+    cursorTpl->PrototypeTemplate()->Set(Nan::New<String>("getMultiple").ToLocalChecked(), Nan::New<FunctionTemplate>(CursorWrap::getMultiple));
+    cursorTpl->PrototypeTemplate()->Set(Nan::New<String>("getCurrentMultiple").ToLocalChecked(), Nan::New<FunctionTemplate>(CursorWrap::getCurrentMultiple));
+    cursorTpl->PrototypeTemplate()->Set(Nan::New<String>("goToNextMultiple").ToLocalChecked(), Nan::New<FunctionTemplate>(CursorWrap::goToNextMultiple));
     cursorTpl->PrototypeTemplate()->Set(Nan::New<String>("del").ToLocalChecked(), Nan::New<FunctionTemplate>(CursorWrap::del));
     cursorTpl->PrototypeTemplate()->Set(Nan::New<String>("put").ToLocalChecked(), Nan::New<FunctionTemplate>(CursorWrap::put));
     cursorTpl->PrototypeTemplate()->Set(Nan::New<String>("count").ToLocalChecked(), Nan::New<FunctionTemplate>(CursorWrap::count));
@@ -69,6 +69,9 @@ NAN_METHOD(DbiWrap::ctor) {
     NodeLmdbKeyType keyType = NodeLmdbKeyType::StringKey;
     bool needsTransaction = true;
     bool isOpen = false;
+    std::string cacheName;
+    dbi_entry_t cached;
+    bool isCached = false;
 
     EnvWrap *ew = Nan::ObjectWrap::Unwrap<EnvWrap>(Local<Object>::Cast(info[0]));
     
@@ -76,6 +79,10 @@ NAN_METHOD(DbiWrap::ctor) {
         Local<Object> options = Local<Object>::Cast(info[1]);
         nameIsNull = options->Get(Nan::GetCurrentContext(), Nan::New<String>("name").ToLocalChecked()).ToLocalChecked()->IsNull();
         name = Local<String>::Cast(options->Get(Nan::GetCurrentContext(), Nan::New<String>("name").ToLocalChecked()).ToLocalChecked());
+        if (!nameIsNull) {
+            cacheName = *Nan::Utf8String(name);
+        }
+        isCached = ew->findDbi(cacheName, &cached);
 
         // Get flags from options
 
@@ -91,7 +98,7 @@ NAN_METHOD(DbiWrap::ctor) {
         // TODO: wrap mdb_set_compare
         // TODO: wrap mdb_set_dupsort
 
-        keyType = keyTypeFromOptions(options);
+        keyType = keyTypeFromOptions(options, isCached ? cached.keyType : NodeLmdbKeyType::StringKey);
         if (keyType == NodeLmdbKeyType::InvalidKey) {
             // NOTE: Error has already been thrown inside keyTypeFromOptions
             return;
@@ -122,7 +129,21 @@ NAN_METHOD(DbiWrap::ctor) {
         return Nan::ThrowError("Invalid parameters.");
     }
 
-    if (needsTransaction) {
+    // An opened database doesn't need a transaction, since mdb_dbi_open would give its existing handle anyway.
+    // Its flags apply when no other ones (besides the key type) are given, otherwise they must be the same.
+    if (isCached && needsTransaction) {
+        int requested = flags & ~MDB_CREATE;
+        if (!(requested & ~MDB_INTEGERKEY)) {
+            requested |= cached.flags & ~MDB_INTEGERKEY;
+        }
+        if (requested != cached.flags) {
+            return throwLmdbError(MDB_INCOMPATIBLE);
+        }
+        dbi = cached.dbi;
+        flags = cached.flags;
+        isOpen = true;
+    }
+    else if (needsTransaction) {
         // Open transaction
         rc = mdb_txn_begin(ew->env, nullptr, txnFlags, &txn);
         if (rc != 0) {
@@ -131,31 +152,41 @@ NAN_METHOD(DbiWrap::ctor) {
         }
     }
 
-    // Open database
-    // NOTE: nullptr in place of the name means using the unnamed database.
-    #if NODE_VERSION_AT_LEAST(12,0,0)
-    rc = mdb_dbi_open(txn, nameIsNull ? nullptr : *String::Utf8Value(Isolate::GetCurrent(), name), flags, &dbi);
-    #else
-    rc = mdb_dbi_open(txn, nameIsNull ? nullptr : *String::Utf8Value(name), flags, &dbi);
-    #endif
-    if (rc != 0) {
-        if (needsTransaction) {
-            mdb_txn_abort(txn);
-        }
-        return throwLmdbError(rc);
-    }
-    else {
-        isOpen = true;
-    }
-
-    if (needsTransaction) {
-        // Commit transaction
-        rc = mdb_txn_commit(txn);
+    if (!isOpen) {
+        // Open database
+        // NOTE: nullptr in place of the name means using the unnamed database.
+        rc = mdb_dbi_open(txn, nameIsNull ? nullptr : cacheName.c_str(), flags, &dbi);
         if (rc != 0) {
+            if (needsTransaction) {
+                mdb_txn_abort(txn);
+            }
             return throwLmdbError(rc);
         }
+        else {
+            isOpen = true;
+        }
+
+        if (needsTransaction) {
+            // Commit transaction
+            rc = mdb_txn_commit(txn);
+            if (rc != 0) {
+                return throwLmdbError(rc);
+            }
+
+            // The handle of a user supplied transaction is only valid once that commits, so it isn't shared
+            dbi_entry_t entry;
+            entry.dbi = dbi;
+            entry.flags = flags & ~MDB_CREATE;
+            entry.keyType = keyType;
+            ew->cacheDbi(cacheName, entry);
+        }
     }
 
+    // The shared snapshot of env.get* only knows the handles that were open when it started
+    ew->resetSharedReadTxn();
+    // The same goes for the shared read transaction, so new read transactions must not join it anymore
+    ew->currentReadTxn = nullptr;
+
     // Create wrapper
     DbiWrap* dw = new DbiWrap(ew->env, dbi);
     if (isOpen) {
@@ -175,6 +206,8 @@ NAN_METHOD(DbiWrap::close) {
 
     DbiWrap *dw = Nan::ObjectWrap::Unwrap<DbiWrap>(info.This());
     if (dw->isOpen) {
+        dw->ew->cleanupCursorPool(dw->dbi);
+        dw->ew->uncacheDbi(dw->dbi);
         mdb_dbi_close(dw->env, dw->dbi);
         dw->isOpen = false;
         dw->ew->Unref();
@@ -246,6 +279,8 @@ NAN_METHOD(DbiWrap::drop) {
     
     // Only close database if del == 1
     if (del == 1) {
+        dw->ew->cleanupCursorPool(dw->dbi);
+        dw->ew->uncacheDbi(dw->dbi);
         dw->isOpen = false;
         dw->ew->Unref();
         dw->ew = nullptr;
@@ -277,3 +312,111 @@ NAN_METHOD(DbiWrap::stat) {
 
     info.GetReturnValue().Set(obj);
 }
+
+NAN_METHOD(DbiWrap::estimateRange) {
+    Nan::HandleScope scope;
+
+    DbiWrap *dw = Nan::ObjectWrap::Unwrap<DbiWrap>(info.This());
+
+    if (info.Length() < 3 || info.Length() > 4) {
+        return Nan::ThrowError("dbi.estimateRange should be called with a txn, a start key, an end key and optional options.");
+    }
+    if (!dw->isOpen) {
+        return Nan::ThrowError("The Dbi is not open.");
+    }
+
+    TxnWrap *tw = Nan::ObjectWrap::Unwrap<TxnWrap>(Local<Object>::Cast(info[0]));
+    if (!tw->txn) {
+        return Nan::ThrowError("The transaction is already closed.");
+    }
+
+    // A null or undefined boundary means the range is open on that side
+    MDB_val keys[2];
+    argtokey_callback_t freeKeys[2] = { nullptr, nullptr };
+    bool hasKey[2] = { false, false };
+    for (int i = 0; i < 2; i++) {
+        Local<Value> keyHandle = info[i + 1];
+        if (keyHandle->IsNull() || keyHandle->IsUndefined()) {
+            continue;
+        }
+
+        bool keyIsValid;
+        auto keyType = inferAndValidateKeyType(keyHandle, info[3], dw->keyType, keyIsValid);
+        if (keyIsValid) {
+            freeKeys[i] = argToKey(keyHandle, keys[i], keyType, keyIsValid);
+        }
+        if (!keyIsValid) {
+            // inferAndValidateKeyType or argToKey already threw an error
+            if (i == 1 && freeKeys[0]) {
+                freeKeys[0](keys[0]);
+            }
+            return;
+        }
+        hasKey[i] = true;
+    }
+
+    mdb_size_t count, error;
+    int rc = mdb_estimate_range(tw->txn, dw->dbi, hasKey[0] ? &keys[0] : nullptr, hasKey[1] ? &keys[1] : nullptr, &count, &error);
+
+    for (int i = 0; i < 2; i++) {
+        if (freeKeys[i]) {
+            freeKeys[i](keys[i]);
+        }
+    }
+
+    if (rc != 0) {
+        return throwLmdbError(rc);
+    }
+
+    int withError = 0;
+    if (info[3]->IsObject()) {
+        setFlagFromValue(&withError, 1, "errorBound", false, Local<Object>::Cast(info[3]));
+    }
+    if (!withError) {
+        return info.GetReturnValue().Set(Nan::New<Number>(count));
+    }
+
+    Local<Context> context = Nan::GetCurrentContext();
+    Local<Object> obj = Nan::New<Object>();
+    obj->Set(context, Nan::New<String>("estimate").ToLocalChecked(), Nan::New<Number>(count));
+    obj->Set(context, Nan::New<String>("errorBound").ToLocalChecked(), Nan::New<Number>(error));
+    info.GetReturnValue().Set(obj);
+}
+
+NAN_METHOD(DbiWrap::splitPoints) {
+    Nan::HandleScope scope;
+
+    DbiWrap *dw = Nan::ObjectWrap::Unwrap<DbiWrap>(info.This());
+
+    if (info.Length() < 2 || !info[1]->IsUint32()) {
+        return Nan::ThrowError("dbi.splitPoints should be called with a txn and the number of partitions.");
+    }
+    if (!dw->isOpen) {
+        return Nan::ThrowError("The Dbi is not open.");
+    }
+
+    TxnWrap *tw = Nan::ObjectWrap::Unwrap<TxnWrap>(Local<Object>::Cast(info[0]));
+    if (!tw->txn) {
+        return Nan::ThrowError("The transaction is already closed.");
+    }
+
+    uint32_t partitions = info[1]->Uint32Value(Nan::GetCurrentContext()).FromJust();
+    unsigned int count = partitions > 1 ? partitions - 1 : 0;
+    std::vector<MDB_val> keys(count);
+    int rc = mdb_split_points(tw->txn, dw->dbi, keys.data(), &count);
+    if (rc != 0) {
+        return throwLmdbError(rc);
+    }
+
+    auto keyType = keyTypeFromOptions(info[2], dw->keyType);
+    if (keyType == NodeLmdbKeyType::InvalidKey) {
+        // keyTypeFromOptions already threw an error
+        return;
+    }
+    Local<Context> context = Nan::GetCurrentContext();
+    Local<Array> result = Nan::New<Array>(count);
+    for (unsigned int i = 0; i < count; i++) {
+        result->Set(context, i, keyToHandle(keys[i], keyType));
+    }
+    info.GetReturnValue().Set(result);
+}
@@ -22,6 +22,13 @@
 // THE SOFTWARE.
 
 #include "node-lmdb.h"
+#include <atomic>
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <unistd.h>
+#endif
 
 using namespace v8;
 using namespace node;
@@ -32,7 +39,10 @@ thread_local Nan::Persistent<Function> *EnvWrap::dbiCtor;
 // Nan::Persistent<Function> EnvWrap::txnCtor;
 // Nan::Persistent<Function> EnvWrap::dbiCtor;
 uv_mutex_t *EnvWrap::envsLock = EnvWrap::initMutex();
-std::vector<env_path_t> EnvWrap::envs;
+std::unordered_map<std::string, env_path_t> EnvWrap::envs;
+uv_mutex_t *EnvWrap::snapshotsLock = EnvWrap::initMutex();
+std::unordered_map<uint64_t, exported_snapshot_t> EnvWrap::exportedSnapshots;
+uint64_t EnvWrap::lastSnapshotId = 0;
 
 uv_mutex_t *EnvWrap::initMutex()
 {
@@ -44,7 +54,26 @@ uv_mutex_t *EnvWrap::initMutex()
 EnvWrap::EnvWrap()
 {
     this->env = nullptr;
+    this->envPath = nullptr;
     this->currentWriteTxn = nullptr;
+    this->readTxns = nullptr;
+    this->maxPooledCursors = 32;
+    this->maxPooledReadTxns = 8;
+    this->shareReaderSlots = true;
+    this->currentReadTxn = nullptr;
+    this->exportedSnapshotCount = 0;
+    this->activeWorkers = 0;
+    this->sharedReadTxn = nullptr;
+    this->sharedReadTxnActive = false;
+    this->sharedReadTxnStart = 0;
+    this->sharedSnapshotMaxAgeMs = 1000;
+    this->sharedReadTxnTimer = nullptr;
+    this->maxReadTxnAgeMs = 0;
+    this->maxReadTxnLagTxns = 0;
+    this->renewStaleReadTxns = false;
+    this->readTxnBudgetCallback = nullptr;
+    this->readTxnBudgetResource = nullptr;
+    this->readTxnBudgetTimer = nullptr;
 }
 
 EnvWrap::~EnvWrap()
@@ -53,8 +82,570 @@ EnvWrap::~EnvWrap()
     if (this->env)
     {
         this->cleanupStrayTxns();
-        mdb_env_close(env);
+        this->cleanupSharedReadTxn();
+        this->cleanupReadTxnBudget();
+        this->cleanupCursorPool();
+        this->cleanupReadTxnPool();
+        this->releaseEnvPath();
+    }
+}
+
+void EnvWrap::releaseEnvPath()
+{
+    uv_mutex_lock(envsLock);
+    if (!this->envPath)
+    {
+        // Never opened
+        mdb_env_close(this->env);
+    }
+    else if (--this->envPath->count <= 0)
+    {
+        // last thread using it, we can really close it now
+        std::string path = this->envPath->path;
+        envs.erase(path);
+        mdb_env_close(this->env);
+    }
+    uv_mutex_unlock(envsLock);
+    this->envPath = nullptr;
+    this->env = nullptr;
+}
+
+bool EnvWrap::findDbi(const std::string &name, dbi_entry_t *entry)
+{
+    bool found = false;
+    uv_mutex_lock(envsLock);
+    if (this->envPath)
+    {
+        auto dbi = this->envPath->dbis.find(name);
+        if (dbi != this->envPath->dbis.end())
+        {
+            *entry = dbi->second;
+            found = true;
+        }
+    }
+    uv_mutex_unlock(envsLock);
+    return found;
+}
+
+void EnvWrap::cacheDbi(const std::string &name, const dbi_entry_t &entry)
+{
+    uv_mutex_lock(envsLock);
+    if (this->envPath)
+    {
+        this->envPath->dbis[name] = entry;
+    }
+    uv_mutex_unlock(envsLock);
+}
+
+void EnvWrap::uncacheDbi(MDB_dbi dbi)
+{
+    uv_mutex_lock(envsLock);
+    if (this->envPath)
+    {
+        std::unordered_map<std::string, dbi_entry_t> &dbis = this->envPath->dbis;
+        for (auto entry = dbis.begin(); entry != dbis.end();)
+        {
+            entry = entry->second.dbi == dbi ? dbis.erase(entry) : std::next(entry);
+        }
+    }
+    uv_mutex_unlock(envsLock);
+}
+
+// Resolves symlinks, '.' and '..' so that all spellings of a path find the same environment.
+// The last component may not exist yet (noSubdir), then only its directory is resolved.
+static std::string normalizeEnvPath(const char *path)
+{
+    uv_fs_t req;
+    std::string normalized;
+    if (uv_fs_realpath(Nan::GetCurrentEventLoop(), &req, path, nullptr) == 0)
+    {
+        normalized = (const char *)req.ptr;
+        uv_fs_req_cleanup(&req);
+        return normalized;
+    }
+    uv_fs_req_cleanup(&req);
+
+    std::string full(path);
+    size_t separator = full.find_last_of("/\\");
+    std::string dir = separator == std::string::npos ? "." : (separator ? full.substr(0, separator) : "/");
+    std::string name = separator == std::string::npos ? full : full.substr(separator + 1);
+    if (uv_fs_realpath(Nan::GetCurrentEventLoop(), &req, dir.c_str(), nullptr) == 0)
+    {
+        normalized = std::string((const char *)req.ptr) + "/" + name;
+    }
+    else
+    {
+        normalized = full;
+    }
+    uv_fs_req_cleanup(&req);
+    return normalized;
+}
+
+void EnvWrap::cleanupCursorPool()
+{
+    for (MDB_cursor *cursor : this->cursorPool)
+    {
+        mdb_cursor_close(cursor);
+    }
+    this->cursorPool.clear();
+}
+
+void EnvWrap::cleanupCursorPool(MDB_dbi dbi)
+{
+    for (size_t i = this->cursorPool.size(); i-- > 0;)
+    {
+        if (mdb_cursor_dbi(this->cursorPool[i]) == dbi)
+        {
+            mdb_cursor_close(this->cursorPool[i]);
+            this->cursorPool[i] = this->cursorPool.back();
+            this->cursorPool.pop_back();
+        }
+    }
+}
+
+MDB_cursor *EnvWrap::takePooledCursor(MDB_txn *txn, MDB_dbi dbi)
+{
+    // Most recently released cursors are the most likely to be in cache
+    for (size_t i = this->cursorPool.size(); i-- > 0;)
+    {
+        MDB_cursor *cursor = this->cursorPool[i];
+        if (mdb_cursor_dbi(cursor) != dbi)
+        {
+            continue;
+        }
+        this->cursorPool[i] = this->cursorPool.back();
+        this->cursorPool.pop_back();
+        if (mdb_cursor_renew(txn, cursor) != 0)
+        {
+            mdb_cursor_close(cursor);
+            return nullptr;
+        }
+        return cursor;
+    }
+    return nullptr;
+}
+
+void EnvWrap::releaseCursor(MDB_cursor *cursor)
+{
+    if (this->env && this->cursorPool.size() < this->maxPooledCursors)
+    {
+        this->cursorPool.push_back(cursor);
+    }
+    else
+    {
+        mdb_cursor_close(cursor);
+    }
+}
+
+void EnvWrap::cleanupReadTxnPool()
+{
+    for (MDB_txn *txn : this->readTxnPool)
+    {
+        mdb_txn_abort(txn);
+    }
+    this->readTxnPool.clear();
+}
+
+int EnvWrap::takePooledReadTxn(MDB_txn **txn)
+{
+    while (this->readTxnPool.size())
+    {
+        *txn = this->readTxnPool.back();
+        this->readTxnPool.pop_back();
+        int rc = mdb_txn_renew(*txn);
+        if (rc == 0)
+        {
+            return 0;
+        }
+        mdb_txn_abort(*txn);
+    }
+    return mdb_txn_begin(this->env, nullptr, MDB_RDONLY, txn);
+}
+
+void EnvWrap::releaseReadTxn(MDB_txn *txn)
+{
+    if (this->env && this->readTxnPool.size() < this->maxPooledReadTxns)
+    {
+        mdb_txn_reset(txn);
+        this->readTxnPool.push_back(txn);
+    }
+    else
+    {
+        mdb_txn_abort(txn);
+    }
+}
+
+bool EnvWrap::joinCurrentReadTxn(MDB_txn **txn)
+{
+    if (!this->shareReaderSlots || !this->currentReadTxn)
+    {
+        return false;
+    }
+    // Nothing was committed since currentReadTxn started, so its snapshot is the one a new transaction would get
+    MDB_envinfo info;
+    mdb_env_info(this->env, &info);
+    if (info.me_last_txnid != mdb_txn_id(this->currentReadTxn))
+    {
+        this->currentReadTxn = nullptr;
+        return false;
+    }
+    this->readTxnRefs[this->currentReadTxn]++;
+    *txn = this->currentReadTxn;
+    return true;
+}
+
+void EnvWrap::makeCurrentReadTxn(MDB_txn *txn)
+{
+    if (this->shareReaderSlots)
+    {
+        this->readTxnRefs[txn] = 1;
+        this->currentReadTxn = txn;
+    }
+}
+
+int EnvWrap::beginReadTxn(MDB_txn **txn, bool pooled)
+{
+    if (this->joinCurrentReadTxn(txn))
+    {
+        return 0;
+    }
+    int rc = pooled ? this->takePooledReadTxn(txn) : mdb_txn_begin(this->env, nullptr, MDB_RDONLY, txn);
+    if (rc == 0)
+    {
+        this->makeCurrentReadTxn(*txn);
+    }
+    return rc;
+}
+
+void EnvWrap::endReadTxn(TxnWrap *tw, bool release)
+{
+    MDB_txn *txn = tw->txn;
+    auto refs = this->readTxnRefs.find(txn);
+    if (refs != this->readTxnRefs.end())
+    {
+        if (--refs->second)
+        {
+            this->unexportSnapshots(txn, tw);
+            return;
+        }
+        this->readTxnRefs.erase(refs);
+        if (this->currentReadTxn == txn)
+        {
+            this->currentReadTxn = nullptr;
+        }
+    }
+
+    this->unexportSnapshots(txn, nullptr);
+    if (release)
+    {
+        this->releaseReadTxn(txn);
+    }
+    else
+    {
+        mdb_txn_abort(txn);
+    }
+}
+
+int EnvWrap::resetReadTxn(TxnWrap *tw)
+{
+    MDB_txn **txn = &tw->txn;
+    auto refs = this->readTxnRefs.find(*txn);
+    if (refs != this->readTxnRefs.end() && refs->second > 1)
+    {
+        // Others still read the snapshot, so continue with an own reset transaction
+        MDB_txn *own;
+        if (this->readTxnPool.size())
+        {
+            own = this->readTxnPool.back();
+            this->readTxnPool.pop_back();
+        }
+        else
+        {
+            int rc = mdb_txn_begin(this->env, nullptr, MDB_RDONLY, &own);
+            if (rc != 0)
+            {
+                return rc;
+            }
+            mdb_txn_reset(own);
+        }
+        this->unexportSnapshots(*txn, tw);
+        refs->second--;
+        *txn = own;
+        return 0;
+    }
+
+    if (refs != this->readTxnRefs.end())
+    {
+        this->readTxnRefs.erase(refs);
+        if (this->currentReadTxn == *txn)
+        {
+            this->currentReadTxn = nullptr;
+        }
+    }
+    this->unexportSnapshots(*txn, nullptr);
+    mdb_txn_reset(*txn);
+    return 0;
+}
+
+void EnvWrap::unexportSnapshots(MDB_txn *txn, TxnWrap *exporter)
+{
+    if (!this->exportedSnapshotCount)
+    {
+        return;
+    }
+    // Other threads may be attaching to the snapshot right now, so it must be gone before the transaction ends
+    uv_mutex_lock(snapshotsLock);
+    for (auto snapshot = exportedSnapshots.begin(); snapshot != exportedSnapshots.end();)
+    {
+        if (snapshot->second.txn == txn && (!exporter || snapshot->second.exporter == exporter))
+        {
+            snapshot = exportedSnapshots.erase(snapshot);
+            this->exportedSnapshotCount--;
+        }
+        else
+        {
+            ++snapshot;
+        }
+    }
+    uv_mutex_unlock(snapshotsLock);
+}
+
+int EnvWrap::renewReadTxn(MDB_txn **txn)
+{
+    if (this->readTxnRefs.count(*txn))
+    {
+        // Still holds a snapshot, like mdb_txn_renew on a transaction that wasn't reset
+        return EINVAL;
+    }
+    MDB_txn *reset = *txn;
+    if (this->joinCurrentReadTxn(txn))
+    {
+        this->releaseReadTxn(reset);
+        return 0;
+    }
+    int rc = mdb_txn_renew(*txn);
+    if (rc == 0)
+    {
+        this->makeCurrentReadTxn(*txn);
+    }
+    return rc;
+}
+
+void EnvWrap::addReadTxn(TxnWrap *tw)
+{
+    tw->prevReadTxn = nullptr;
+    tw->nextReadTxn = this->readTxns;
+    if (this->readTxns)
+    {
+        this->readTxns->prevReadTxn = tw;
+    }
+    this->readTxns = tw;
+}
+
+void EnvWrap::removeReadTxn(TxnWrap *tw)
+{
+    if (tw->prevReadTxn)
+    {
+        tw->prevReadTxn->nextReadTxn = tw->nextReadTxn;
+    }
+    else if (this->readTxns == tw)
+    {
+        this->readTxns = tw->nextReadTxn;
+    }
+    if (tw->nextReadTxn)
+    {
+        tw->nextReadTxn->prevReadTxn = tw->prevReadTxn;
+    }
+    tw->prevReadTxn = nullptr;
+    tw->nextReadTxn = nullptr;
+}
+
+int EnvWrap::getSharedReadTxn(MDB_txn **txn)
+{
+    int rc;
+    if (this->sharedReadTxnActive)
+    {
+        MDB_envinfo envinfo;
+        rc = mdb_env_info(this->env, &envinfo);
+        if (rc != 0)
+        {
+            return rc;
+        }
+        bool stale = envinfo.me_last_txnid != mdb_txn_id(this->sharedReadTxn) ||
+                     (this->sharedSnapshotMaxAgeMs && uv_hrtime() - this->sharedReadTxnStart > (uint64_t)this->sharedSnapshotMaxAgeMs * 1000000);
+        if (!stale)
+        {
+            *txn = this->sharedReadTxn;
+            return 0;
+        }
+        this->resetSharedReadTxn();
+    }
+
+    if (this->sharedReadTxn)
+    {
+        rc = mdb_txn_renew(this->sharedReadTxn);
+        if (rc != 0)
+        {
+            mdb_txn_abort(this->sharedReadTxn);
+            this->sharedReadTxn = nullptr;
+            return rc;
+        }
+    }
+    else
+    {
+        MDB_txn *newTxn;
+        rc = this->takePooledReadTxn(&newTxn);
+        if (rc != 0)
+        {
+            return rc;
+        }
+        this->sharedReadTxn = newTxn;
+    }
+    this->sharedReadTxnActive = true;
+    this->sharedReadTxnStart = uv_hrtime();
+
+    if (!this->sharedReadTxnTimer)
+    {
+        this->sharedReadTxnTimer = new uv_timer_t;
+        uv_timer_init(Nan::GetCurrentEventLoop(), this->sharedReadTxnTimer);
+        this->sharedReadTxnTimer->data = this;
+        // The timer must not keep the process alive
+        uv_unref((uv_handle_t *)this->sharedReadTxnTimer);
+    }
+    uv_timer_start(this->sharedReadTxnTimer, onSharedReadTxnIdle, 0, 0);
+
+    *txn = this->sharedReadTxn;
+    return 0;
+}
+
+void EnvWrap::onSharedReadTxnIdle(uv_timer_t *timer)
+{
+    static_cast<EnvWrap *>(timer->data)->resetSharedReadTxn();
+}
+
+void EnvWrap::resetSharedReadTxn()
+{
+    if (this->sharedReadTxnActive)
+    {
+        mdb_txn_reset(this->sharedReadTxn);
+        this->sharedReadTxnActive = false;
+    }
+}
+
+void EnvWrap::cleanupSharedReadTxn()
+{
+    if (this->sharedReadTxn)
+    {
+        mdb_txn_abort(this->sharedReadTxn);
+        this->sharedReadTxn = nullptr;
+        this->sharedReadTxnActive = false;
+    }
+    if (this->sharedReadTxnTimer)
+    {
+        uv_timer_stop(this->sharedReadTxnTimer);
+        uv_close((uv_handle_t *)this->sharedReadTxnTimer, [](uv_handle_t *handle) {
+            delete (uv_timer_t *)handle;
+        });
+        this->sharedReadTxnTimer = nullptr;
+    }
+}
+
+void EnvWrap::onReadTxnBudgetTimer(uv_timer_t *timer)
+{
+    static_cast<EnvWrap *>(timer->data)->checkReadTxnBudget();
+}
+
+void EnvWrap::checkReadTxnBudget()
+{
+    if (!this->env)
+    {
+        return;
+    }
+
+    // The timer only fires between JS calls, so no transaction is in use and renewing is safe here
+    MDB_envinfo envinfo;
+    if (mdb_env_info(this->env, &envinfo) != 0)
+    {
+        return;
+    }
+    uint64_t now = uv_hrtime();
+
+    if (this->sharedReadTxnActive && this->maxReadTxnAgeMs && now - this->sharedReadTxnStart > (uint64_t)this->maxReadTxnAgeMs * 1000000)
+    {
+        this->resetSharedReadTxn();
+    }
+
+    Nan::HandleScope scope;
+    Local<Context> context = Nan::GetCurrentContext();
+    // Handles keep the transactions alive while callbacks run
+    std::vector<Local<Object>> overBudget;
+    for (TxnWrap *tw = this->readTxns; tw; tw = tw->nextReadTxn)
+    {
+        if (!tw->snapshotTime || tw->overBudgetReported)
+        {
+            continue;
+        }
+        uint64_t ageMs = (now - tw->snapshotTime) / 1000000;
+        mdb_size_t lag = envinfo.me_last_txnid - mdb_txn_id(tw->txn);
+        if ((this->maxReadTxnAgeMs && ageMs > this->maxReadTxnAgeMs) || (this->maxReadTxnLagTxns && lag > this->maxReadTxnLagTxns))
+        {
+            overBudget.push_back(tw->handle());
+        }
+    }
+
+    // Callbacks may end transactions, so they are only called once the list is no longer walked
+    for (Local<Object> txnHandle : overBudget)
+    {
+        TxnWrap *tw = Nan::ObjectWrap::Unwrap<TxnWrap>(txnHandle);
+        if (!tw->txn || !tw->snapshotTime)
+        {
+            // Ended or reset by an earlier callback
+            continue;
+        }
+        uint64_t ageMs = (now - tw->snapshotTime) / 1000000;
+        mdb_size_t lag = envinfo.me_last_txnid - mdb_txn_id(tw->txn);
+        tw->overBudgetReported = true;
+        bool renewed = this->renewStaleReadTxns && tw->renewSnapshot() == 0;
+
+        if (this->readTxnBudgetCallback)
+        {
+            Local<Object> details = Nan::New<Object>();
+            details->Set(context, Nan::New<String>("txn").ToLocalChecked(), txnHandle);
+            Local<Value> stack = Nan::Undefined();
+            if (!tw->startStack.IsEmpty())
+            {
+                stack = Nan::New(tw->startStack)->Get(context, Nan::New<String>("stack").ToLocalChecked()).ToLocalChecked();
+            }
+            details->Set(context, Nan::New<String>("stack").ToLocalChecked(), stack);
+            details->Set(context, Nan::New<String>("ageMs").ToLocalChecked(), Nan::New<Number>((double)ageMs));
+            details->Set(context, Nan::New<String>("lagTxns").ToLocalChecked(), Nan::New<Number>((double)lag));
+            details->Set(context, Nan::New<String>("renewed").ToLocalChecked(), Nan::New<Boolean>(renewed));
+
+            Local<Value> argv[] = {details};
+            this->readTxnBudgetCallback->Call(1, argv, this->readTxnBudgetResource);
+            if (!this->env)
+            {
+                // The callback closed the environment
+                return;
+            }
+        }
+    }
+}
+
+void EnvWrap::cleanupReadTxnBudget()
+{
+    if (this->readTxnBudgetTimer)
+    {
+        uv_timer_stop(this->readTxnBudgetTimer);
+        uv_close((uv_handle_t *)this->readTxnBudgetTimer, [](uv_handle_t *handle) {
+            delete (uv_timer_t *)handle;
+        });
+        this->readTxnBudgetTimer = nullptr;
     }
+    delete this->readTxnBudgetCallback;
+    this->readTxnBudgetCallback = nullptr;
+    delete this->readTxnBudgetResource;
+    this->readTxnBudgetResource = nullptr;
 }
 
 void EnvWrap::cleanupStrayTxns()
@@ -65,10 +656,10 @@ void EnvWrap::cleanupStrayTxns()
         this->currentWriteTxn->txn = nullptr;
         this->currentWriteTxn->removeFromEnvWrap();
     }
-    while (this->readTxns.size())
+    while (this->readTxns)
     {
-        TxnWrap *tw = *this->readTxns.begin();
-        mdb_txn_abort(tw->txn);
+        TxnWrap *tw = this->readTxns;
+        this->endReadTxn(tw, false);
         tw->removeFromEnvWrap();
         tw->txn = nullptr;
     }
@@ -168,13 +759,397 @@ public:
         v8::Local<v8::Value> argv[] = {
             Nan::Null()};
 
-        callback->Call(1, argv, async_resource);
+        callback->Call(1, argv, async_resource);
+    }
+
+private:
+    MDB_env *env;
+    char *path;
+    int flags;
+};
+
+// Number of times env.compact() makes the copy in the background again when writes committed meanwhile,
+// before it makes it while holding the write lock
+static const int maxCompactCopies = 3;
+// Number of times env.compact() tries to swap in an up to date copy while transactions of this process are active,
+// and the milliseconds it waits in between (the shared snapshot of env.get* stays active until the event loop moves on)
+static const int maxCompactSwapAttempts = 5;
+static const unsigned int compactSwapRetryMs = 10;
+
+class CompactWorker : public Nan::AsyncWorker
+{
+public:
+    CompactWorker(EnvWrap *ew, const std::string &path, const std::string &dataPath, Nan::Callback *callback)
+        : Nan::AsyncWorker(callback, "node-lmdb:Compact"), ew(ew), env(ew->env), path(path), dataPath(dataPath), txnid(0)
+    {
+        ew->activeWorkers++;
+    }
+
+    void Execute()
+    {
+        int rc;
+        MDB_envinfo info;
+        for (int copies = 1;; copies++)
+        {
+            // The copy can't overwrite a file, remove what an earlier copy or an interrupted compaction left behind
+            remove(dataPath.c_str());
+            rc = mdb_env_compact_copy(env, path.c_str(), &txnid);
+            if (rc != 0)
+            {
+                return SetErrorMessage(mdb_strerror(rc));
+            }
+            // Writes committed while copying, copy again rather than holding the write lock for it
+            mdb_env_info(env, &info);
+            if (txnid == info.me_last_txnid || copies == maxCompactCopies)
+            {
+                break;
+            }
+        }
+
+        // Another Env opened meanwhile shares the MDB_env, so mdb_env_compact_swap covers its transactions too
+        uv_mutex_lock(EnvWrap::envsLock);
+        bool shared = ew->envPath && ew->envPath->count > 1;
+        uv_mutex_unlock(EnvWrap::envsLock);
+        if (shared)
+        {
+            return SetErrorMessage("Only call env.compact() when no other Env of this process uses the environment.");
+        }
+
+        // Read transactions that begin during the swap wait for it, but active ones make it fail
+        for (int attempt = 1;; attempt++)
+        {
+            rc = mdb_env_compact_swap(env, path.c_str(), txnid);
+            if (rc != EBUSY || attempt == maxCompactSwapAttempts)
+            {
+                break;
+            }
+            // Only try again when the copy is still up to date, instead of copying under the write lock once more
+            mdb_env_info(env, &info);
+            if (txnid != info.me_last_txnid)
+            {
+                break;
+            }
+            uv_sleep(compactSwapRetryMs);
+        }
+        if (rc == EBUSY)
+        {
+            SetErrorMessage("The environment is in use by another process or by a transaction of this process, try env.compact() again later.");
+        }
+        else if (rc != 0)
+        {
+            SetErrorMessage(mdb_strerror(rc));
+        }
+    }
+
+    void HandleOKCallback()
+    {
+        Nan::HandleScope scope;
+
+        cleanup();
+        v8::Local<v8::Value> argv[] = {
+            Nan::Null()};
+
+        callback->Call(1, argv, async_resource);
+    }
+
+    void HandleErrorCallback()
+    {
+        cleanup();
+        Nan::AsyncWorker::HandleErrorCallback();
+    }
+
+private:
+    void cleanup()
+    {
+        // Done with the environment, so the callback can close it
+        ew->activeWorkers--;
+        remove(dataPath.c_str());
+        if (path != dataPath)
+        {
+            remove(path.c_str());
+        }
+    }
+
+    EnvWrap *ew;
+    MDB_env *env;
+    std::string path;
+    std::string dataPath;
+    mdb_size_t txnid;
+};
+
+// Size of the chunks env.backup() writes to a stream, and how many of them may wait in the stream
+static const size_t backupChunkSize = 1024 * 1024;
+static const unsigned maxBackupChunksInFlight = 4;
+// Progress is reported at most once per this many bytes (and when the backup is complete)
+static const mdb_size_t backupProgressInterval = 1024 * 1024;
+
+// Header of a message of BackupWorker to the main thread, followed by the data of a chunk for the stream
+struct backup_message_t
+{
+    bool isProgress;
+    mdb_size_t done;
+    mdb_size_t total;
+};
+
+class BackupWorker : public Nan::AsyncProgressQueueWorker<char>
+{
+public:
+    BackupWorker(EnvWrap *ew, int fd, bool toStream, int flags, double maxBytesPerSec, Nan::Callback *callback, Nan::Callback *progress)
+        : Nan::AsyncProgressQueueWorker<char>(callback, "node-lmdb:Backup"),
+          ew(ew),
+          env(ew->env),
+          fd(fd),
+          readFd(-1),
+          toStream(toStream),
+          flags(flags),
+          maxBytesPerSec(maxBytesPerSec),
+          progress(progress),
+          executionProgress(nullptr),
+          start(0),
+          lastProgress(0),
+          failed(false)
+    {
+        ew->activeWorkers++;
+        uv_sem_init(&slots, maxBackupChunksInFlight);
+        MDB_stat stat;
+        mdb_env_stat(env, &stat);
+        pageSize = stat.ms_psize;
+    }
+
+    ~BackupWorker()
+    {
+        uv_sem_destroy(&slots);
+        delete progress;
+    }
+
+    void Execute(const ExecutionProgress &executionProgress)
+    {
+        this->executionProgress = &executionProgress;
+
+        int writeFd = fd;
+        uv_thread_t reader;
+        if (toStream)
+        {
+            // The copy is written to a pipe, and another thread forwards it to the stream in chunks
+            int fds[2];
+#ifdef _WIN32
+            if (_pipe(fds, (unsigned int)backupChunkSize, _O_BINARY) != 0)
+#else
+            if (pipe(fds) != 0)
+#endif
+            {
+                return SetErrorMessage(strerror(errno));
+            }
+            readFd = fds[0];
+            writeFd = fds[1];
+            if (uv_thread_create(&reader, readThread, this) != 0)
+            {
+                closeFd(readFd);
+                closeFd(writeFd);
+                return SetErrorMessage("Could not start the thread writing to the stream.");
+            }
+        }
+
+        start = uv_hrtime();
+        int rc = mdb_env_copyfd3(env, uv_get_osfhandle(writeFd), flags, onCopyProgress, this);
+        if (toStream)
+        {
+            closeFd(writeFd);
+            uv_thread_join(&reader);
+            closeFd(readFd);
+        }
+        if (rc != 0)
+        {
+            SetErrorMessage(mdb_strerror(rc));
+        }
+    }
+
+    void HandleProgressCallback(const char *data, size_t size)
+    {
+        Nan::HandleScope scope;
+        Local<Context> context = Nan::GetCurrentContext();
+
+        backup_message_t message;
+        memcpy(&message, data, sizeof(message));
+        if (message.isProgress)
+        {
+            Local<Object> obj = Nan::New<Object>();
+            obj->Set(context, Nan::New<String>("bytes").ToLocalChecked(), Nan::New<Number>((double)message.done));
+            obj->Set(context, Nan::New<String>("totalBytes").ToLocalChecked(), Nan::New<Number>((double)message.total));
+            obj->Set(context, Nan::New<String>("pages").ToLocalChecked(), Nan::New<Number>((double)(message.done / pageSize)));
+            obj->Set(context, Nan::New<String>("totalPages").ToLocalChecked(), Nan::New<Number>((double)(message.total / pageSize)));
+
+            v8::Local<v8::Value> argv[] = {
+                obj};
+            progress->Call(1, argv, async_resource);
+            return;
+        }
+
+        Local<Object> stream = GetFromPersistent("stream").As<Object>();
+        Local<Value> write = stream->Get(context, Nan::New<String>("write").ToLocalChecked()).ToLocalChecked();
+        if (failed || !write->IsFunction())
+        {
+            return chunkWritten("The stream of env.backup() can't be written to.");
+        }
+
+        // The slot of the chunk is given back when the stream calls back, so at most
+        // maxBackupChunksInFlight chunks wait in the stream
+        Nan::TryCatch tryCatch;
+        Local<Value> argv[] = {
+            Nan::CopyBuffer(data + sizeof(message), size - sizeof(message)).ToLocalChecked(),
+            Nan::New<Function>(onChunkWritten, Nan::New<External>(this)).ToLocalChecked()};
+        Nan::Call(write.As<Function>(), stream, 2, argv);
+        if (tryCatch.HasCaught())
+        {
+            chunkWritten(*Nan::Utf8String(tryCatch.Exception()));
+        }
+    }
+
+    void HandleOKCallback()
+    {
+        if (!streamError.empty())
+        {
+            // The copy went through, but the stream failed on its last chunks
+            return HandleErrorCallback();
+        }
+
+        // Done with the environment, so the callback can close it
+        ew->activeWorkers--;
+        Nan::HandleScope scope;
+        v8::Local<v8::Value> argv[] = {
+            Nan::Null()};
+
+        callback->Call(1, argv, async_resource);
+    }
+
+    void HandleErrorCallback()
+    {
+        ew->activeWorkers--;
+        Nan::HandleScope scope;
+        v8::Local<v8::Value> argv[] = {
+            Nan::Error(streamError.empty() ? ErrorMessage() : streamError.c_str())};
+
+        callback->Call(1, argv, async_resource);
+    }
+
+private:
+    static int onCopyProgress(void *ctx, mdb_size_t done, mdb_size_t total)
+    {
+        BackupWorker *worker = static_cast<BackupWorker *>(ctx);
+        if (worker->failed)
+        {
+            return ECANCELED;
+        }
+        if (worker->maxBytesPerSec > 0)
+        {
+            // Sleep until the average rate since the start is back at the limit
+            uint64_t due = (uint64_t)(done / worker->maxBytesPerSec * 1e3);
+            uint64_t elapsed = (uv_hrtime() - worker->start) / 1000000;
+            if (due > elapsed)
+            {
+                uv_sleep((unsigned int)(due - elapsed));
+            }
+        }
+        if (worker->progress && (done - worker->lastProgress >= backupProgressInterval || done == total))
+        {
+            worker->lastProgress = done;
+            backup_message_t message = {true, done, total};
+            worker->executionProgress->Send((const char *)&message, sizeof(message));
+        }
+        return 0;
+    }
+
+    static void readThread(void *arg)
+    {
+        BackupWorker *worker = static_cast<BackupWorker *>(arg);
+        std::vector<char> chunk(sizeof(backup_message_t) + backupChunkSize);
+        backup_message_t message = {false, 0, 0};
+        memcpy(chunk.data(), &message, sizeof(message));
+        for (;;)
+        {
+            uv_sem_wait(&worker->slots);
+#ifdef _WIN32
+            int count = _read(worker->readFd, chunk.data() + sizeof(message), (unsigned int)backupChunkSize);
+#else
+            ssize_t count = read(worker->readFd, chunk.data() + sizeof(message), backupChunkSize);
+            if (count < 0 && errno == EINTR)
+            {
+                uv_sem_post(&worker->slots);
+                continue;
+            }
+#endif
+            if (count <= 0)
+            {
+                uv_sem_post(&worker->slots);
+                break;
+            }
+            if (worker->failed)
+            {
+                // Keep draining the pipe until the copy notices
+                uv_sem_post(&worker->slots);
+                continue;
+            }
+            worker->executionProgress->Send(chunk.data(), sizeof(message) + count);
+        }
+        // The stream calls back into this worker, wait until it did for every chunk
+        for (unsigned i = 0; i < maxBackupChunksInFlight; i++)
+        {
+            uv_sem_wait(&worker->slots);
+        }
+    }
+
+    static NAN_METHOD(onChunkWritten)
+    {
+        BackupWorker *worker = static_cast<BackupWorker *>(info.Data().As<External>()->Value());
+        if (info.Length() > 0 && !info[0]->IsNullOrUndefined())
+        {
+            Local<Value> message = info[0];
+            if (info[0]->IsObject())
+            {
+                message = Nan::Get(info[0].As<Object>(), Nan::New<String>("message").ToLocalChecked()).ToLocalChecked();
+            }
+            return worker->chunkWritten(*Nan::Utf8String(message));
+        }
+        worker->chunkWritten(nullptr);
+    }
+
+    void chunkWritten(const char *error)
+    {
+        if (error && !failed)
+        {
+            streamError = error;
+            failed = true;
+        }
+        uv_sem_post(&slots);
+    }
+
+    static void closeFd(int fd)
+    {
+#ifdef _WIN32
+        _close(fd);
+#else
+        close(fd);
+#endif
     }
 
-private:
+    EnvWrap *ew;
     MDB_env *env;
-    char *path;
+    int fd;
+    int readFd;
+    bool toStream;
     int flags;
+    double maxBytesPerSec;
+    Nan::Callback *progress;
+    const ExecutionProgress *executionProgress;
+    uint64_t start;
+    mdb_size_t lastProgress;
+    unsigned int pageSize;
+    // Chunks that may still be handed to the stream
+    uv_sem_t slots;
+    // Set when writing to the stream failed, which fails the copy too
+    std::atomic<bool> failed;
+    // Only accessed on the main thread
+    std::string streamError;
 };
 
 struct condition_t
@@ -378,6 +1353,247 @@ private:
     Nan::Callback *progress;
 };
 
+// Header of a chunk of scanned entries: partition index and number of entries,
+// followed by the entries, each as key size, key, data size and data
+struct scan_chunk_header_t
+{
+    uint32_t partition;
+    uint32_t count;
+};
+
+// Chunks of a partition that may wait for the main thread before its scanning thread blocks
+static const unsigned maxScanChunksInFlightPerPartition = 2;
+
+class ParallelScanWorker : public Nan::AsyncProgressQueueWorker<char>
+{
+public:
+    ParallelScanWorker(EnvWrap *ew, MDB_dbi dbi, std::vector<MDB_txn *> &txns, std::vector<std::vector<char>> &splits, uint32_t chunkSize, NodeLmdbKeyType keyType, Nan::Callback *callback, Nan::Callback *worker)
+        : Nan::AsyncProgressQueueWorker<char>(callback, "node-lmdb:ParallelScan"),
+          ew(ew),
+          dbi(dbi),
+          txns(txns),
+          splits(splits),
+          chunkSize(chunkSize),
+          keyType(keyType),
+          txnId(mdb_txn_id(txns[0])),
+          worker(worker),
+          executionProgress(nullptr)
+    {
+        ew->activeWorkers++;
+        uv_sem_init(&slots, maxScanChunksInFlightPerPartition * txns.size());
+    }
+
+    ~ParallelScanWorker()
+    {
+        uv_sem_destroy(&slots);
+        // Transactions are ended by the scanning threads, unless the worker never ran
+        for (MDB_txn *txn : txns)
+        {
+            if (txn)
+            {
+                mdb_txn_abort(txn);
+            }
+        }
+        delete worker;
+    }
+
+    void Execute(const ExecutionProgress &executionProgress)
+    {
+        this->executionProgress = &executionProgress;
+
+        size_t count = txns.size();
+        std::vector<partition_t> partitions(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            partitions[i].worker = this;
+            partitions[i].index = i;
+            partitions[i].rc = 0;
+            partitions[i].started = uv_thread_create(&partitions[i].thread, scanThread, &partitions[i]) == 0;
+            if (!partitions[i].started)
+            {
+                // Could not start a thread, scan this partition here instead
+                scanThread(&partitions[i]);
+            }
+        }
+        for (size_t i = 0; i < count; i++)
+        {
+            if (partitions[i].started)
+            {
+                uv_thread_join(&partitions[i].thread);
+            }
+        }
+        for (size_t i = 0; i < count; i++)
+        {
+            if (partitions[i].rc != 0)
+            {
+                return SetErrorMessage(mdb_strerror(partitions[i].rc));
+            }
+        }
+    }
+
+    void HandleProgressCallback(const char *data, size_t size)
+    {
+        Nan::HandleScope scope;
+        Local<Context> context = Nan::GetCurrentContext();
+
+        // The chunk stays in the progress queue until this returns, so its slot can already be given back
+        uv_sem_post(&slots);
+
+        scan_chunk_header_t header;
+        memcpy(&header, data, sizeof(header));
+        const char *position = data + sizeof(header);
+
+        Local<Array> entries = Nan::New<Array>(header.count);
+        for (uint32_t i = 0; i < header.count; i++)
+        {
+            MDB_val key, value;
+            position = readVal(position, key);
+            position = readVal(position, value);
+
+            Local<Object> entry = Nan::New<Object>();
+            entry->Set(context, Nan::New<String>("key").ToLocalChecked(), keyToHandle(key, keyType));
+            entry->Set(context, Nan::New<String>("value").ToLocalChecked(), valToBinary(value));
+            entries->Set(context, i, entry);
+        }
+
+        v8::Local<v8::Value> argv[] = {
+            entries,
+            Nan::New<Number>(header.partition)};
+
+        worker->Call(2, argv, async_resource);
+    }
+
+    void HandleOKCallback()
+    {
+        // The partitions ended their transactions, so the callback can close the environment
+        ew->activeWorkers--;
+        Nan::HandleScope scope;
+        v8::Local<v8::Value> argv[] = {
+            Nan::Null(),
+            Nan::New<Number>(txnId)};
+
+        callback->Call(2, argv, async_resource);
+    }
+
+    void HandleErrorCallback()
+    {
+        ew->activeWorkers--;
+        Nan::AsyncWorker::HandleErrorCallback();
+    }
+
+private:
+    struct partition_t
+    {
+        ParallelScanWorker *worker;
+        size_t index;
+        int rc;
+        bool started;
+        uv_thread_t thread;
+    };
+
+    static void scanThread(void *arg)
+    {
+        partition_t *partition = static_cast<partition_t *>(arg);
+        partition->rc = partition->worker->scanPartition(partition->index);
+    }
+
+    static const char *readVal(const char *position, MDB_val &val)
+    {
+        uint32_t size;
+        memcpy(&size, position, sizeof(size));
+        val.mv_size = size;
+        val.mv_data = (void *)(position + sizeof(size));
+        return position + sizeof(size) + size;
+    }
+
+    static void appendVal(std::vector<char> &chunk, MDB_val &val)
+    {
+        uint32_t size = val.mv_size;
+        const char *sizeBytes = reinterpret_cast<const char *>(&size);
+        chunk.insert(chunk.end(), sizeBytes, sizeBytes + sizeof(size));
+        chunk.insert(chunk.end(), (char *)val.mv_data, (char *)val.mv_data + val.mv_size);
+    }
+
+    void sendChunk(size_t index, std::vector<char> &chunk, uint32_t count)
+    {
+        scan_chunk_header_t header;
+        header.partition = index;
+        header.count = count;
+        memcpy(chunk.data(), &header, sizeof(header));
+        // Wait while the main thread is behind, instead of queueing up the whole database in memory
+        uv_sem_wait(&slots);
+        executionProgress->Send(chunk.data(), chunk.size());
+        chunk.resize(sizeof(header));
+    }
+
+    // Scans [splits[index - 1], splits[index]) in the partition's own transaction, then ends the transaction
+    int scanPartition(size_t index)
+    {
+        MDB_txn *txn = txns[index];
+        MDB_cursor *cursor;
+        int rc = mdb_cursor_open(txn, dbi, &cursor);
+        if (rc == 0)
+        {
+            MDB_val key, data, end;
+            bool hasEnd = index < splits.size();
+            if (hasEnd)
+            {
+                end.mv_size = splits[index].size();
+                end.mv_data = splits[index].data();
+            }
+            if (index > 0)
+            {
+                key.mv_size = splits[index - 1].size();
+                key.mv_data = splits[index - 1].data();
+                rc = mdb_cursor_get(cursor, &key, &data, MDB_SET_RANGE);
+            }
+            else
+            {
+                rc = mdb_cursor_get(cursor, &key, &data, MDB_FIRST);
+            }
+
+            std::vector<char> chunk(sizeof(scan_chunk_header_t));
+            uint32_t count = 0;
+            while (rc == 0)
+            {
+                if (hasEnd && mdb_cmp(txn, dbi, &key, &end) >= 0)
+                {
+                    break;
+                }
+                appendVal(chunk, key);
+                appendVal(chunk, data);
+                if (++count == chunkSize)
+                {
+                    sendChunk(index, chunk, count);
+                    count = 0;
+                }
+                rc = mdb_cursor_get(cursor, &key, &data, MDB_NEXT);
+            }
+            if (count)
+            {
+                sendChunk(index, chunk, count);
+            }
+            mdb_cursor_close(cursor);
+        }
+
+        mdb_txn_abort(txn);
+        txns[index] = nullptr;
+        return rc == MDB_NOTFOUND ? 0 : rc;
+    }
+
+    EnvWrap *ew;
+    MDB_dbi dbi;
+    std::vector<MDB_txn *> txns;
+    std::vector<std::vector<char>> splits;
+    uint32_t chunkSize;
+    NodeLmdbKeyType keyType;
+    mdb_size_t txnId;
+    Nan::Callback *worker;
+    const ExecutionProgress *executionProgress;
+    // Chunks that may still be sent to the main thread, given back by HandleProgressCallback
+    uv_sem_t slots;
+};
+
 NAN_METHOD(EnvWrap::open)
 {
     Nan::HandleScope scope;
@@ -396,18 +1612,73 @@ NAN_METHOD(EnvWrap::open)
     Local<Object> options = Local<Object>::Cast(info[0]);
     Local<String> path = Local<String>::Cast(options->Get(Nan::GetCurrentContext(), Nan::New<String>("path").ToLocalChecked()).ToLocalChecked());
     Nan::Utf8String charPath(path);
+
+    // Parse the cursorPoolSize option (applies to this Env object only, so also when the environment is shared)
+    Local<Value> cursorPoolSizeOption = options->Get(Nan::GetCurrentContext(), Nan::New<String>("cursorPoolSize").ToLocalChecked()).ToLocalChecked();
+    if (cursorPoolSizeOption->IsUint32())
+    {
+        ew->maxPooledCursors = cursorPoolSizeOption->Uint32Value(Nan::GetCurrentContext()).FromJust();
+    }
+    Local<Value> readTxnPoolSizeOption = options->Get(Nan::GetCurrentContext(), Nan::New<String>("readTxnPoolSize").ToLocalChecked()).ToLocalChecked();
+    if (readTxnPoolSizeOption->IsUint32())
+    {
+        ew->maxPooledReadTxns = readTxnPoolSizeOption->Uint32Value(Nan::GetCurrentContext()).FromJust();
+    }
+    int shareReaderSlots = 0;
+    setFlagFromValue(&shareReaderSlots, 1, "shareReaderSlots", true, options);
+    ew->shareReaderSlots = shareReaderSlots;
+    Local<Value> sharedSnapshotMaxAgeOption = options->Get(Nan::GetCurrentContext(), Nan::New<String>("sharedSnapshotMaxAgeMs").ToLocalChecked()).ToLocalChecked();
+    if (sharedSnapshotMaxAgeOption->IsUint32())
+    {
+        ew->sharedSnapshotMaxAgeMs = sharedSnapshotMaxAgeOption->Uint32Value(Nan::GetCurrentContext()).FromJust();
+    }
+
+    // Parse the read transaction budget options
+    Local<Value> maxReadTxnAgeOption = options->Get(Nan::GetCurrentContext(), Nan::New<String>("maxReadTxnAgeMs").ToLocalChecked()).ToLocalChecked();
+    if (maxReadTxnAgeOption->IsUint32())
+    {
+        ew->maxReadTxnAgeMs = maxReadTxnAgeOption->Uint32Value(Nan::GetCurrentContext()).FromJust();
+    }
+    Local<Value> maxReadTxnLagOption = options->Get(Nan::GetCurrentContext(), Nan::New<String>("maxReadTxnLagTxns").ToLocalChecked()).ToLocalChecked();
+    if (maxReadTxnLagOption->IsUint32())
+    {
+        ew->maxReadTxnLagTxns = maxReadTxnLagOption->Uint32Value(Nan::GetCurrentContext()).FromJust();
+    }
+    int renewStaleReadTxns = 0;
+    setFlagFromValue(&renewStaleReadTxns, 1, "renewStaleReadTxns", false, options);
+    ew->renewStaleReadTxns = renewStaleReadTxns;
+    Local<Value> budgetCallbackOption = options->Get(Nan::GetCurrentContext(), Nan::New<String>("onReadTxnBudgetExceeded").ToLocalChecked()).ToLocalChecked();
+    if (budgetCallbackOption->IsFunction())
+    {
+        delete ew->readTxnBudgetCallback;
+        delete ew->readTxnBudgetResource;
+        ew->readTxnBudgetCallback = new Nan::Callback(Local<Function>::Cast(budgetCallbackOption));
+        ew->readTxnBudgetResource = new Nan::AsyncResource("node-lmdb:ReadTxnBudget");
+    }
+    if ((ew->maxReadTxnAgeMs || ew->maxReadTxnLagTxns) && !ew->readTxnBudgetTimer)
+    {
+        // Check often enough to notice an age limit within half of it, and at least every second for the lag limit
+        uint64_t interval = ew->maxReadTxnAgeMs ? std::max<uint64_t>(ew->maxReadTxnAgeMs / 2, 1) : 1000;
+        interval = std::min<uint64_t>(interval, 1000);
+        ew->readTxnBudgetTimer = new uv_timer_t;
+        uv_timer_init(Nan::GetCurrentEventLoop(), ew->readTxnBudgetTimer);
+        ew->readTxnBudgetTimer->data = ew;
+        // The timer must not keep the process alive
+        uv_unref((uv_handle_t *)ew->readTxnBudgetTimer);
+        uv_timer_start(ew->readTxnBudgetTimer, onReadTxnBudgetTimer, interval, interval);
+    }
+
+    std::string normalizedPath = normalizeEnvPath(*charPath);
     uv_mutex_lock(envsLock);
-    for (env_path_t envPath : envs)
+    auto existing = envs.find(normalizedPath);
+    if (existing != envs.end())
     {
-        char *existingPath = envPath.path;
-        if (!strcmp(existingPath, *charPath))
-        {
-            envPath.count++;
-            mdb_env_close(ew->env);
-            ew->env = envPath.env;
-            uv_mutex_unlock(envsLock);
-            return;
-        }
+        existing->second.count++;
+        mdb_env_close(ew->env);
+        ew->env = existing->second.env;
+        ew->envPath = &existing->second;
+        uv_mutex_unlock(envsLock);
+        return;
     }
 
     // Parse the maxDbs option
@@ -431,11 +1702,73 @@ NAN_METHOD(EnvWrap::open)
         }
     }
 
+    // Parse the pageSize option, which only applies to newly created files
+    Local<Value> pageSizeOption = options->Get(Nan::GetCurrentContext(), Nan::New<String>("pageSize").ToLocalChecked()).ToLocalChecked();
+    if (pageSizeOption->IsUint32())
+    {
+        rc = mdb_env_set_pagesize(ew->env, pageSizeOption->Uint32Value(Nan::GetCurrentContext()).FromJust());
+        if (rc != 0)
+        {
+            uv_mutex_unlock(envsLock);
+            return throwLmdbError(rc);
+        }
+    }
+
+    // Parse the automatic map growth options
+    Local<Value> maxMapSizeOption = options->Get(Nan::GetCurrentContext(), Nan::New<String>("maxMapSize").ToLocalChecked()).ToLocalChecked();
+    if (maxMapSizeOption->IsNumber())
+    {
+        mdb_size_t maxMapSize = maxMapSizeOption->IntegerValue(Nan::GetCurrentContext()).FromJust();
+        mdb_size_t growthStep = 0;
+        double growthFactor = 2;
+        Local<Value> growthStepOption = options->Get(Nan::GetCurrentContext(), Nan::New<String>("mapGrowthStep").ToLocalChecked()).ToLocalChecked();
+        if (growthStepOption->IsNumber())
+        {
+            growthStep = growthStepOption->IntegerValue(Nan::GetCurrentContext()).FromJust();
+        }
+        Local<Value> growthFactorOption = options->Get(Nan::GetCurrentContext(), Nan::New<String>("mapGrowthFactor").ToLocalChecked()).ToLocalChecked();
+        if (growthFactorOption->IsNumber())
+        {
+            growthFactor = Nan::To<double>(growthFactorOption).FromJust();
+        }
+        rc = mdb_env_set_mapgrowth(ew->env, maxMapSize, growthStep, (unsigned)(growthFactor * 100));
+        if (rc != 0)
+        {
+            uv_mutex_unlock(envsLock);
+            return throwLmdbError(rc);
+        }
+    }
+
+    // Parse the maxDirtySize option
+    Local<Value> maxDirtySizeOption = options->Get(Nan::GetCurrentContext(), Nan::New<String>("maxDirtySize").ToLocalChecked()).ToLocalChecked();
+    if (maxDirtySizeOption->IsNumber())
+    {
+        rc = mdb_env_set_dirtysize(ew->env, maxDirtySizeOption->IntegerValue(Nan::GetCurrentContext()).FromJust());
+        if (rc != 0)
+        {
+            uv_mutex_unlock(envsLock);
+            return throwLmdbError(rc);
+        }
+    }
+
+    // Parse the maxArenaSize option
+    Local<Value> maxArenaSizeOption = options->Get(Nan::GetCurrentContext(), Nan::New<String>("maxArenaSize").ToLocalChecked()).ToLocalChecked();
+    if (maxArenaSizeOption->IsNumber())
+    {
+        rc = mdb_env_set_arenasize(ew->env, maxArenaSizeOption->IntegerValue(Nan::GetCurrentContext()).FromJust());
+        if (rc != 0)
+        {
+            uv_mutex_unlock(envsLock);
+            return throwLmdbError(rc);
+        }
+    }
+
     // Parse the maxReaders option
     // NOTE: mdb.c defines DEFAULT_READERS as 126
     rc = applyUint32Setting<unsigned>(&mdb_env_set_maxreaders, ew->env, options, 126, "maxReaders");
     if (rc != 0)
     {
+        uv_mutex_unlock(envsLock);
         return throwLmdbError(rc);
     }
 
@@ -474,11 +1807,11 @@ NAN_METHOD(EnvWrap::open)
         ew->env = nullptr;
         return throwLmdbError(rc);
     }
-    env_path_t envPath;
-    envPath.path = strdup(*charPath);
+    env_path_t &envPath = envs[normalizedPath];
+    envPath.path = normalizedPath;
     envPath.env = ew->env;
     envPath.count = 1;
-    envs.push_back(envPath);
+    ew->envPath = &envPath;
     uv_mutex_unlock(envsLock);
 }
 
@@ -501,11 +1834,14 @@ NAN_METHOD(EnvWrap::resize)
     }
 
     // Since this function may only be called if no transactions are active in this process, check this condition.
-    if (ew->currentWriteTxn || ew->readTxns.size())
+    if (ew->currentWriteTxn || ew->readTxns)
     {
         return Nan::ThrowError("Only call env.resize() when there are no active transactions. Please close all transactions before calling env.resize().");
     }
 
+    // The shared snapshot of env.get* is not an active transaction from the user's point of view
+    ew->resetSharedReadTxn();
+
     mdb_size_t mapSizeSizeT = info[0]->IntegerValue(Nan::GetCurrentContext()).FromJust();
     int rc = mdb_env_set_mapsize(ew->env, mapSizeSizeT);
     if (rc != 0)
@@ -517,6 +1853,11 @@ NAN_METHOD(EnvWrap::resize)
 NAN_METHOD(EnvWrap::close)
 {
     EnvWrap *ew = Nan::ObjectWrap::Unwrap<EnvWrap>(info.This());
+    if (ew->activeWorkers)
+    {
+        // The workers still use the environment and their transactions, and compact may be swapping in the copy
+        return Nan::ThrowError("The environment can't be closed before env.backup(), env.parallelScan() or env.compact() calls back.");
+    }
     ew->Unref();
 
     if (!ew->env)
@@ -524,26 +1865,11 @@ NAN_METHOD(EnvWrap::close)
         return Nan::ThrowError("The environment is already closed.");
     }
     ew->cleanupStrayTxns();
-
-    uv_mutex_lock(envsLock);
-    for (auto envPath = envs.begin(); envPath != envs.end();)
-    {
-        if (envPath->env == ew->env)
-        {
-            envPath->count--;
-            if (envPath->count <= 0)
-            {
-                // last thread using it, we can really close it now
-                envs.erase(envPath);
-                mdb_env_close(ew->env);
-            }
-            break;
-        }
-        ++envPath;
-    }
-    uv_mutex_unlock(envsLock);
-
-    ew->env = nullptr;
+    ew->cleanupSharedReadTxn();
+    ew->cleanupReadTxnBudget();
+    ew->cleanupCursorPool();
+    ew->cleanupReadTxnPool();
+    ew->releaseEnvPath();
 }
 
 NAN_METHOD(EnvWrap::stat)
@@ -605,6 +1931,11 @@ NAN_METHOD(EnvWrap::info)
     obj->Set(context, Nan::New<String>("lastTxnId").ToLocalChecked(), Nan::New<Number>(envinfo.me_last_txnid));
     obj->Set(context, Nan::New<String>("maxReaders").ToLocalChecked(), Nan::New<Number>(envinfo.me_maxreaders));
     obj->Set(context, Nan::New<String>("numReaders").ToLocalChecked(), Nan::New<Number>(envinfo.me_numreaders));
+    obj->Set(context, Nan::New<String>("allocTime").ToLocalChecked(), Nan::New<Number>(envinfo.me_alloc_time / 1e6));
+    obj->Set(context, Nan::New<String>("arenaSize").ToLocalChecked(), Nan::New<Number>(envinfo.me_arena_size));
+    obj->Set(context, Nan::New<String>("arenaHits").ToLocalChecked(), Nan::New<Number>(envinfo.me_arena_hits));
+    obj->Set(context, Nan::New<String>("arenaMisses").ToLocalChecked(), Nan::New<Number>(envinfo.me_arena_misses));
+    obj->Set(context, Nan::New<String>("arenaFrees").ToLocalChecked(), Nan::New<Number>(envinfo.me_arena_frees));
 
     info.GetReturnValue().Set(obj);
 }
@@ -663,61 +1994,162 @@ NAN_METHOD(EnvWrap::readersCheck)
     int rc = mdb_reader_check(ew->env, &dead);
     if (rc != 0)
     {
-        return throwLmdbError(rc);
+        return throwLmdbError(rc);
+    }
+
+    v8::Local<v8::Number> result = Nan::New<Number>(dead);
+
+    info.GetReturnValue().Set(result);
+}
+
+NAN_METHOD(EnvWrap::getFreePagesCount)
+{
+    MDB_txn *txn;
+    MDB_cursor *cursor;
+    MDB_val key, data;
+    mdb_size_t pages = 0, *iptr;
+    MDB_dbi dbi = 0;
+    int rc;
+
+    EnvWrap *ew = Nan::ObjectWrap::Unwrap<EnvWrap>(info.This());
+    if (!ew->env)
+    {
+        return Nan::ThrowError("The environment is already closed.");
+    }
+
+    rc = mdb_txn_begin(ew->env, NULL, MDB_RDONLY, &txn);
+    if (rc)
+    {
+        mdb_txn_abort(txn);
+        return throwLmdbError(rc);
+    }
+
+    rc = mdb_cursor_open(txn, dbi, &cursor);
+    if (rc)
+    {
+        mdb_txn_abort(txn);
+        return throwLmdbError(rc);
+    }
+
+    while ((rc = mdb_cursor_get(cursor, &key, &data, MDB_NEXT)) == 0)
+    {
+        iptr = static_cast<mdb_size_t *>(data.mv_data);
+        pages += *iptr;
+    }
+
+    mdb_cursor_close(cursor);
+    mdb_txn_commit(txn);
+
+    info.GetReturnValue().Set(Nan::New<Number>(pages));
+}
+
+NAN_METHOD(EnvWrap::copy)
+{
+    Nan::HandleScope scope;
+
+    // Get the wrapper
+    EnvWrap *ew = Nan::ObjectWrap::Unwrap<EnvWrap>(info.This());
+
+    if (!ew->env)
+    {
+        return Nan::ThrowError("The environment is already closed.");
+    }
+
+    // Check that the correct number/type of arguments was given.
+    if (!info[0]->IsString())
+    {
+        return Nan::ThrowError("Call env.copy(path, compact?, callback) with a file path.");
+    }
+    if (!info[info.Length() - 1]->IsFunction())
+    {
+        return Nan::ThrowError("Call env.copy(path, compact?, callback) with a file path.");
+    }
+    Nan::Utf8String path(info[0].As<String>());
+
+    int flags = 0;
+    if (info.Length() > 1 && info[1]->IsTrue())
+    {
+        flags = MDB_CP_COMPACT;
     }
 
-    v8::Local<v8::Number> result = Nan::New<Number>(dead);
+    Nan::Callback *callback = new Nan::Callback(
+        v8::Local<v8::Function>::Cast(info[info.Length() > 2 ? 2 : 1]));
 
-    info.GetReturnValue().Set(result);
+    CopyWorker *worker = new CopyWorker(
+        ew->env, *path, flags, callback);
+
+    Nan::AsyncQueueWorker(worker);
 }
 
-NAN_METHOD(EnvWrap::getFreePagesCount)
+NAN_METHOD(EnvWrap::compact)
 {
-    MDB_txn *txn;
-    MDB_cursor *cursor;
-    MDB_val key, data;
-    mdb_size_t pages = 0, *iptr;
-    MDB_dbi dbi = 0;
-    int rc;
+    Nan::HandleScope scope;
 
+    // Get the wrapper
     EnvWrap *ew = Nan::ObjectWrap::Unwrap<EnvWrap>(info.This());
+
     if (!ew->env)
     {
         return Nan::ThrowError("The environment is already closed.");
     }
 
-    rc = mdb_txn_begin(ew->env, NULL, MDB_RDONLY, &txn);
-    if (rc)
+    // Check that the correct number/type of arguments was given.
+    if (info.Length() != 1 || !info[0]->IsFunction())
     {
-        mdb_txn_abort(txn);
-        return throwLmdbError(rc);
+        return Nan::ThrowError("Call env.compact(callback) with exactly one argument which is a function.");
     }
 
-    rc = mdb_cursor_open(txn, dbi, &cursor);
-    if (rc)
+#if defined(_WIN32) || defined(MDB_VL32)
+    return Nan::ThrowError("env.compact() is not supported on this platform.");
+#else
+    const char *envPath;
+    unsigned int envFlags;
+    mdb_env_get_path(ew->env, &envPath);
+    mdb_env_get_flags(ew->env, &envFlags);
+    if (envFlags & MDB_RDONLY)
     {
-        mdb_txn_abort(txn);
-        return throwLmdbError(rc);
+        return Nan::ThrowError("env.compact() can't be used with a read-only environment.");
+    }
+    if (ew->activeWorkers)
+    {
+        // Their transactions would keep the compacted copy from being swapped in
+        return Nan::ThrowError("env.compact() can't be called while env.backup(), env.parallelScan() or env.compact() of this Env is in progress.");
     }
 
-    while ((rc = mdb_cursor_get(cursor, &key, &data, MDB_NEXT)) == 0)
+    // The copy is made next to the data file, so that it can be renamed over it
+    std::string path, dataPath;
+    if (envFlags & MDB_NOSUBDIR)
     {
-        iptr = static_cast<mdb_size_t *>(data.mv_data);
-        pages += *iptr;
+        path = dataPath = std::string(envPath) + ".compact";
+    }
+    else
+    {
+        path = std::string(envPath) + "/compact";
+        dataPath = path + "/data.mdb";
+        uv_fs_t req;
+        int rc = uv_fs_mkdir(Nan::GetCurrentEventLoop(), &req, path.c_str(), 0755, nullptr);
+        uv_fs_req_cleanup(&req);
+        if (rc != 0 && rc != UV_EEXIST)
+        {
+            return Nan::ThrowError(uv_strerror(rc));
+        }
     }
 
-    mdb_cursor_close(cursor);
-    mdb_txn_commit(txn);
+    Nan::Callback *callback = new Nan::Callback(info[0].As<Function>());
+    CompactWorker *worker = new CompactWorker(ew, path, dataPath, callback);
+    worker->SaveToPersistent("env", info.This());
 
-    info.GetReturnValue().Set(Nan::New<Number>(pages));
+    Nan::AsyncQueueWorker(worker);
+#endif
 }
 
-NAN_METHOD(EnvWrap::copy)
+NAN_METHOD(EnvWrap::backup)
 {
     Nan::HandleScope scope;
 
     // Get the wrapper
     EnvWrap *ew = Nan::ObjectWrap::Unwrap<EnvWrap>(info.This());
+    Local<Context> context = Nan::GetCurrentContext();
 
     if (!ew->env)
     {
@@ -725,27 +2157,45 @@ NAN_METHOD(EnvWrap::copy)
     }
 
     // Check that the correct number/type of arguments was given.
-    if (!info[0]->IsString())
+    if (info.Length() != 2 || !info[0]->IsObject() || !info[1]->IsFunction())
     {
-        return Nan::ThrowError("Call env.copy(path, compact?, callback) with a file path.");
+        return Nan::ThrowError("Call env.backup(options, callback) with an options object and a callback.");
     }
-    if (!info[info.Length() - 1]->IsFunction())
+
+    Local<Object> options = Local<Object>::Cast(info[0]);
+    Local<Value> fdValue = options->Get(context, Nan::New<String>("fd").ToLocalChecked()).ToLocalChecked();
+    Local<Value> streamValue = options->Get(context, Nan::New<String>("stream").ToLocalChecked()).ToLocalChecked();
+    bool toStream = streamValue->IsObject();
+    if (!toStream && !fdValue->IsInt32())
     {
-        return Nan::ThrowError("Call env.copy(path, compact?, callback) with a file path.");
+        return Nan::ThrowError("Call env.backup(options, callback) with either options.fd or options.stream.");
     }
-    Nan::Utf8String path(info[0].As<String>());
+    int fd = toStream ? -1 : fdValue->Int32Value(context).FromJust();
 
     int flags = 0;
-    if (info.Length() > 1 && info[1]->IsTrue())
+    setFlagFromValue(&flags, MDB_CP_COMPACT, "compact", false, options);
+
+    double maxBytesPerSec = 0;
+    Local<Value> maxBytesPerSecValue = options->Get(context, Nan::New<String>("maxBytesPerSec").ToLocalChecked()).ToLocalChecked();
+    if (maxBytesPerSecValue->IsNumber() && Nan::To<double>(maxBytesPerSecValue).FromJust() > 0)
     {
-        flags = MDB_CP_COMPACT;
+        maxBytesPerSec = Nan::To<double>(maxBytesPerSecValue).FromJust();
     }
 
-    Nan::Callback *callback = new Nan::Callback(
-        v8::Local<v8::Function>::Cast(info[info.Length() > 2 ? 2 : 1]));
+    Nan::Callback *progress = nullptr;
+    Local<Value> onProgressValue = options->Get(context, Nan::New<String>("onProgress").ToLocalChecked()).ToLocalChecked();
+    if (onProgressValue->IsFunction())
+    {
+        progress = new Nan::Callback(onProgressValue.As<Function>());
+    }
 
-    CopyWorker *worker = new CopyWorker(
-        ew->env, *path, flags, callback);
+    Nan::Callback *callback = new Nan::Callback(info[1].As<Function>());
+    BackupWorker *worker = new BackupWorker(ew, fd, toStream, flags, maxBytesPerSec, callback, progress);
+    worker->SaveToPersistent("env", info.This());
+    if (toStream)
+    {
+        worker->SaveToPersistent("stream", streamValue);
+    }
 
     Nan::AsyncQueueWorker(worker);
 }
@@ -779,6 +2229,233 @@ NAN_METHOD(EnvWrap::beginTxn)
     info.GetReturnValue().Set(instance);
 }
 
+NAN_METHOD(EnvWrap::acquireReadTxn)
+{
+    Nan::HandleScope scope;
+
+    // The third constructor argument tells TxnWrap::ctor to take its handle from the pool
+    const int argc = 3;
+
+    Local<Value> argv[argc] = {info.This(), Nan::Undefined(), Nan::True()};
+    Nan::MaybeLocal<Object> maybeInstance = Nan::NewInstance(Nan::New(*txnCtor), argc, argv);
+
+    // Check if txn could be created
+    if ((maybeInstance.IsEmpty()))
+    {
+        // The txnCtor already threw an error
+        return;
+    }
+
+    info.GetReturnValue().Set(maybeInstance.ToLocalChecked());
+}
+
+Nan::NAN_METHOD_RETURN_TYPE EnvWrap::getCommon(Nan::NAN_METHOD_ARGS_TYPE info, Local<Value> (*successFunc)(MDB_val &))
+{
+    Nan::HandleScope scope;
+
+    if (info.Length() != 2 && info.Length() != 3)
+    {
+        return Nan::ThrowError("Invalid number of arguments to env.get");
+    }
+
+    EnvWrap *ew = Nan::ObjectWrap::Unwrap<EnvWrap>(info.This());
+    DbiWrap *dw = Nan::ObjectWrap::Unwrap<DbiWrap>(Local<Object>::Cast(info[0]));
+
+    if (!ew->env)
+    {
+        return Nan::ThrowError("The environment is already closed.");
+    }
+
+    MDB_val key, oldkey, data;
+    bool keyIsValid;
+    auto keyType = inferAndValidateKeyType(info[1], info[2], dw->keyType, keyIsValid);
+    if (!keyIsValid)
+    {
+        // inferAndValidateKeyType already threw an error
+        return;
+    }
+    auto freeKey = argToKey(info[1], key, keyType, keyIsValid);
+    if (!keyIsValid)
+    {
+        // argToKey already threw an error
+        return;
+    }
+
+    // Bookkeeping for old key so that we can free it even if key will point inside LMDB
+    oldkey.mv_data = key.mv_data;
+    oldkey.mv_size = key.mv_size;
+
+    MDB_txn *txn;
+    int rc = ew->getSharedReadTxn(&txn);
+    if (rc == 0)
+    {
+        rc = mdb_get(txn, dw->dbi, &key, &data);
+    }
+
+    if (freeKey)
+    {
+        freeKey(oldkey);
+    }
+
+    if (rc == MDB_NOTFOUND)
+    {
+        return info.GetReturnValue().Set(Nan::Null());
+    }
+    else if (rc != 0)
+    {
+        return throwLmdbError(rc);
+    }
+
+    // The value is copied by successFunc, since the snapshot may be reset before it is used
+    return info.GetReturnValue().Set(successFunc(data));
+}
+
+NAN_METHOD(EnvWrap::getString)
+{
+    return getCommon(info, valToString);
+}
+
+NAN_METHOD(EnvWrap::getBinary)
+{
+    return getCommon(info, valToBinary);
+}
+
+NAN_METHOD(EnvWrap::getNumber)
+{
+    return getCommon(info, valToNumber);
+}
+
+NAN_METHOD(EnvWrap::getBoolean)
+{
+    return getCommon(info, valToBoolean);
+}
+
+NAN_METHOD(EnvWrap::getRange)
+{
+    Nan::HandleScope scope;
+
+    EnvWrap *ew = Nan::ObjectWrap::Unwrap<EnvWrap>(info.This());
+    Local<Context> context = Nan::GetCurrentContext();
+
+    if (!ew->env)
+    {
+        return Nan::ThrowError("The environment is already closed.");
+    }
+    if (info.Length() < 3 || info.Length() > 4 || !info[0]->IsObject())
+    {
+        return Nan::ThrowError("env.getRange should be called with a dbi, a start key, an end key and optional options.");
+    }
+
+    DbiWrap *dw = Nan::ObjectWrap::Unwrap<DbiWrap>(Local<Object>::Cast(info[0]));
+    if (!dw->isOpen)
+    {
+        return Nan::ThrowError("The Dbi is not open.");
+    }
+
+    uint32_t limit = UINT32_MAX;
+    if (info[3]->IsObject())
+    {
+        Local<Value> limitValue = Local<Object>::Cast(info[3])->Get(context, Nan::New<String>("limit").ToLocalChecked()).ToLocalChecked();
+        if (limitValue->IsUint32())
+        {
+            limit = limitValue->Uint32Value(context).FromJust();
+        }
+    }
+
+    auto keyType = keyTypeFromOptions(info[3], dw->keyType);
+    if (keyType == NodeLmdbKeyType::InvalidKey)
+    {
+        // keyTypeFromOptions already threw an error
+        return;
+    }
+
+    // A null or undefined boundary means the range is open on that side
+    MDB_val keys[2];
+    argtokey_callback_t freeKeys[2] = {nullptr, nullptr};
+    bool hasKey[2] = {false, false};
+    for (int i = 0; i < 2; i++)
+    {
+        Local<Value> keyHandle = info[i + 1];
+        if (keyHandle->IsNull() || keyHandle->IsUndefined())
+        {
+            continue;
+        }
+
+        bool keyIsValid;
+        keyType = inferAndValidateKeyType(keyHandle, info[3], dw->keyType, keyIsValid);
+        if (keyIsValid)
+        {
+            freeKeys[i] = argToKey(keyHandle, keys[i], keyType, keyIsValid);
+        }
+        if (!keyIsValid)
+        {
+            // inferAndValidateKeyType or argToKey already threw an error
+            if (i == 1 && freeKeys[0])
+            {
+                freeKeys[0](keys[0]);
+            }
+            return;
+        }
+        hasKey[i] = true;
+    }
+
+    MDB_txn *txn;
+    MDB_cursor *cursor = nullptr;
+    int rc = ew->getSharedReadTxn(&txn);
+    if (rc == 0)
+    {
+        cursor = ew->takePooledCursor(txn, dw->dbi);
+        if (!cursor)
+        {
+            rc = mdb_cursor_open(txn, dw->dbi, &cursor);
+        }
+    }
+
+    Local<Array> results = Nan::New<Array>();
+    uint32_t count = 0;
+    if (rc == 0)
+    {
+        MDB_val key, data;
+        if (hasKey[0])
+        {
+            key = keys[0];
+            rc = mdb_cursor_get(cursor, &key, &data, MDB_SET_RANGE);
+        }
+        else
+        {
+            rc = mdb_cursor_get(cursor, &key, &data, MDB_FIRST);
+        }
+        while (rc == 0 && count < limit)
+        {
+            if (hasKey[1] && mdb_cmp(txn, dw->dbi, &key, &keys[1]) >= 0)
+            {
+                break;
+            }
+            Local<Object> entry = Nan::New<Object>();
+            entry->Set(context, Nan::New<String>("key").ToLocalChecked(), keyToHandle(key, keyType));
+            entry->Set(context, Nan::New<String>("value").ToLocalChecked(), valToBinary(data));
+            results->Set(context, count++, entry);
+            rc = mdb_cursor_get(cursor, &key, &data, MDB_NEXT);
+        }
+        ew->releaseCursor(cursor);
+    }
+
+    for (int i = 0; i < 2; i++)
+    {
+        if (freeKeys[i])
+        {
+            freeKeys[i](keys[i]);
+        }
+    }
+
+    if (rc != 0 && rc != MDB_NOTFOUND)
+    {
+        return throwLmdbError(rc);
+    }
+
+    info.GetReturnValue().Set(results);
+}
+
 NAN_METHOD(EnvWrap::openDbi)
 {
     Nan::HandleScope scope;
@@ -995,6 +2672,116 @@ NAN_METHOD(EnvWrap::batchWrite)
     return;
 }
 
+NAN_METHOD(EnvWrap::parallelScan)
+{
+    Nan::HandleScope scope;
+
+    EnvWrap *ew = Nan::ObjectWrap::Unwrap<EnvWrap>(info.This());
+    Local<Context> context = Nan::GetCurrentContext();
+
+    if (!ew->env)
+    {
+        return Nan::ThrowError("The environment is already closed.");
+    }
+    if (info.Length() < 3 || !info[0]->IsObject() || !info[1]->IsObject() || !info[2]->IsFunction())
+    {
+        return Nan::ThrowError("env.parallelScan should be called with a dbi, an options object and a callback.");
+    }
+
+    DbiWrap *dw = Nan::ObjectWrap::Unwrap<DbiWrap>(Local<Object>::Cast(info[0]));
+    if (!dw->isOpen)
+    {
+        return Nan::ThrowError("The Dbi is not open.");
+    }
+
+    Local<Object> options = Local<Object>::Cast(info[1]);
+    Local<Value> workerValue = options->Get(context, Nan::New<String>("worker").ToLocalChecked()).ToLocalChecked();
+    if (!workerValue->IsFunction())
+    {
+        return Nan::ThrowError("The worker option of env.parallelScan must be a function.");
+    }
+
+    uint32_t partitions = 0;
+    Local<Value> partitionsValue = options->Get(context, Nan::New<String>("partitions").ToLocalChecked()).ToLocalChecked();
+    if (partitionsValue->IsUint32())
+    {
+        partitions = partitionsValue->Uint32Value(context).FromJust();
+    }
+    if (partitions == 0)
+    {
+        uv_cpu_info_t *cpus;
+        int cpuCount;
+        if (uv_cpu_info(&cpus, &cpuCount) == 0)
+        {
+            uv_free_cpu_info(cpus, cpuCount);
+            partitions = cpuCount;
+        }
+        partitions = partitions > 0 ? partitions : 1;
+    }
+
+    uint32_t chunkSize = 1000;
+    Local<Value> chunkSizeValue = options->Get(context, Nan::New<String>("chunkSize").ToLocalChecked()).ToLocalChecked();
+    if (chunkSizeValue->IsUint32() && chunkSizeValue->Uint32Value(context).FromJust() > 0)
+    {
+        chunkSize = chunkSizeValue->Uint32Value(context).FromJust();
+    }
+
+    auto keyType = keyTypeFromOptions(options, dw->keyType);
+    if (keyType == NodeLmdbKeyType::InvalidKey)
+    {
+        // keyTypeFromOptions already threw an error
+        return;
+    }
+
+    // Split the key space using the first transaction
+    MDB_txn *first;
+    int rc = mdb_txn_begin(ew->env, nullptr, MDB_RDONLY, &first);
+    if (rc != 0)
+    {
+        return throwLmdbError(rc);
+    }
+    unsigned int splitCount = partitions - 1;
+    std::vector<MDB_val> splitKeys(splitCount);
+    rc = mdb_split_points(first, dw->dbi, splitKeys.data(), &splitCount);
+    if (rc != 0)
+    {
+        mdb_txn_abort(first);
+        return throwLmdbError(rc);
+    }
+    std::vector<std::vector<char>> splits;
+    for (unsigned int i = 0; i < splitCount; i++)
+    {
+        splits.emplace_back((char *)splitKeys[i].mv_data, (char *)splitKeys[i].mv_data + splitKeys[i].mv_size);
+    }
+
+    // The other partitions need their own transactions (a transaction is bound to a single thread),
+    // which are attached to the snapshot of the first one, whatever was committed since it began
+    std::vector<MDB_txn *> txns;
+    txns.push_back(first);
+    while (txns.size() <= splits.size())
+    {
+        MDB_txn *txn;
+        rc = mdb_txn_begin_snapshot(ew->env, first, &txn);
+        if (rc != 0)
+        {
+            for (MDB_txn *started : txns)
+            {
+                mdb_txn_abort(started);
+            }
+            return throwLmdbError(rc);
+        }
+        txns.push_back(txn);
+    }
+
+    Nan::Callback *callback = new Nan::Callback(Local<Function>::Cast(info[2]));
+    Nan::Callback *worker = new Nan::Callback(Local<Function>::Cast(workerValue));
+    ParallelScanWorker *scanWorker = new ParallelScanWorker(ew, dw->dbi, txns, splits, chunkSize, keyType, callback, worker);
+    scanWorker->SaveToPersistent("env", info.This());
+    scanWorker->SaveToPersistent("dbi", info[0]);
+
+    Nan::AsyncQueueWorker(scanWorker);
+}
+
 void EnvWrap::setupExports(Local<Object> exports)
 {
     // EnvWrap: Prepare constructor template
@@ -1006,6 +2793,12 @@ void EnvWrap::setupExports(Local<Object> exports)
     envTpl->PrototypeTemplate()->Set(isolate, "open", Nan::New<FunctionTemplate>(EnvWrap::open));
     envTpl->PrototypeTemplate()->Set(isolate, "close", Nan::New<FunctionTemplate>(EnvWrap::close));
     envTpl->PrototypeTemplate()->Set(isolate, "beginTxn", Nan::New<FunctionTemplate>(EnvWrap::beginTxn));
+    envTpl->PrototypeTemplate()->Set(isolate, "acquireReadTxn", Nan::New<FunctionTemplate>(EnvWrap::acquireReadTxn));
+    envTpl->PrototypeTemplate()->Set(isolate, "getString", Nan::New<FunctionTemplate>(EnvWrap::getString));
+    envTpl->PrototypeTemplate()->Set(isolate, "getBinary", Nan::New<FunctionTemplate>(EnvWrap::getBinary));
+    envTpl->PrototypeTemplate()->Set(isolate, "getNumber", Nan::New<FunctionTemplate>(EnvWrap::getNumber));
+    envTpl->PrototypeTemplate()->Set(isolate, "getBoolean", Nan::New<FunctionTemplate>(EnvWrap::getBoolean));
+    envTpl->PrototypeTemplate()->Set(isolate, "getRange", Nan::New<FunctionTemplate>(EnvWrap::getRange));
     envTpl->PrototypeTemplate()->Set(isolate, "openDbi", Nan::New<FunctionTemplate>(EnvWrap::openDbi));
     envTpl->PrototypeTemplate()->Set(isolate, "sync", Nan::New<FunctionTemplate>(EnvWrap::sync));
     envTpl->PrototypeTemplate()->Set(isolate, "batchWrite", Nan::New<FunctionTemplate>(EnvWrap::batchWrite));
@@ -1016,7 +2809,10 @@ void EnvWrap::setupExports(Local<Object> exports)
     envTpl->PrototypeTemplate()->Set(isolate, "getFreePagesCount", Nan::New<FunctionTemplate>(EnvWrap::getFreePagesCount));
     envTpl->PrototypeTemplate()->Set(isolate, "resize", Nan::New<FunctionTemplate>(EnvWrap::resize));
     envTpl->PrototypeTemplate()->Set(isolate, "copy", Nan::New<FunctionTemplate>(EnvWrap::copy));
+    envTpl->PrototypeTemplate()->Set(isolate, "compact", Nan::New<FunctionTemplate>(EnvWrap::compact));
+    envTpl->PrototypeTemplate()->Set(isolate, "backup", Nan::New<FunctionTemplate>(EnvWrap::backup));
     envTpl->PrototypeTemplate()->Set(isolate, "detachBuffer", Nan::New<FunctionTemplate>(EnvWrap::detachBuffer));
+    envTpl->PrototypeTemplate()->Set(isolate, "parallelScan", Nan::New<FunctionTemplate>(EnvWrap::parallelScan));
 
     // TxnWrap: Prepare constructor template
     Local<FunctionTemplate> txnTpl = Nan::New<FunctionTemplate>(TxnWrap::ctor);
@@ -1038,6 +2834,8 @@ void EnvWrap::setupExports(Local<Object> exports)
     txnTpl->PrototypeTemplate()->Set(isolate, "del", Nan::New<FunctionTemplate>(TxnWrap::del));
     txnTpl->PrototypeTemplate()->Set(isolate, "reset", Nan::New<FunctionTemplate>(TxnWrap::reset));
     txnTpl->PrototypeTemplate()->Set(isolate, "renew", Nan::New<FunctionTemplate>(TxnWrap::renew));
+    txnTpl->PrototypeTemplate()->Set(isolate, "release", Nan::New<FunctionTemplate>(TxnWrap::release));
+    txnTpl->PrototypeTemplate()->Set(isolate, "exportSnapshot", Nan::New<FunctionTemplate>(TxnWrap::exportSnapshot));
     // TODO: wrap mdb_cmp too
     // TODO: wrap mdb_dcmp too
     // TxnWrap: Get constructor
@@ -1052,6 +2850,8 @@ void EnvWrap::setupExports(Local<Object> exports)
     dbiTpl->PrototypeTemplate()->Set(isolate, "close", Nan::New<FunctionTemplate>(DbiWrap::close));
     dbiTpl->PrototypeTemplate()->Set(isolate, "drop", Nan::New<FunctionTemplate>(DbiWrap::drop));
     dbiTpl->PrototypeTemplate()->Set(isolate, "stat", Nan::New<FunctionTemplate>(DbiWrap::stat));
+    dbiTpl->PrototypeTemplate()->Set(isolate, "estimateRange", Nan::New<FunctionTemplate>(DbiWrap::estimateRange));
+    dbiTpl->PrototypeTemplate()->Set(isolate, "splitPoints", Nan::New<FunctionTemplate>(DbiWrap::splitPoints));
     // TODO: wrap mdb_stat too
     // DbiWrap: Get constructor
     EnvWrap::dbiCtor = new Nan::Persistent<Function>();
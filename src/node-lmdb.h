@@ -25,7 +25,9 @@
 #define NODE_LMDB_H
 
 #include <vector>
+#include <string>
 #include <algorithm>
+#include <unordered_map>
 #include <v8.h>
 #include <node.h>
 #include <node_buffer.h>
@@ -101,11 +103,30 @@ class TxnWrap;
 class DbiWrap;
 class EnvWrap;
 class CursorWrap;
+class CompactWorker;
+// Database opened in an environment, so that other Env objects of it can use the handle without a transaction
+struct dbi_entry_t
+{
+    MDB_dbi dbi;
+    int flags;
+    NodeLmdbKeyType keyType;
+};
+// Environment opened in this process, shared by the Env objects of all threads using the same path
 struct env_path_t
 {
     MDB_env *env;
-    char *path;
+    std::string path;
     int count;
+    // Opened databases by name, the unnamed database has an empty name
+    std::unordered_map<std::string, dbi_entry_t> dbis;
+};
+// Snapshot exported by txn.exportSnapshot(), valid until the exporting transaction ends or gets reset
+struct exported_snapshot_t
+{
+    MDB_env *env;
+    MDB_txn *txn;
+    // The exporting transaction, which may share txn with others
+    TxnWrap *exporter;
 };
 
 /*
@@ -120,21 +141,124 @@ private:
     MDB_env *env;
     // Current write transaction
     TxnWrap *currentWriteTxn;
-    // List of open read transactions
-    std::vector<TxnWrap *> readTxns;
+    // Open read transactions, as an intrusive list linked through TxnWrap::prevReadTxn / nextReadTxn
+    TxnWrap *readTxns;
     // Constructor for TxnWrap
     static thread_local Nan::Persistent<Function> *txnCtor;
     // Constructor for DbiWrap
     static thread_local Nan::Persistent<Function> *dbiCtor;
 
+    // Cursors of read-only transactions kept for reuse with mdb_cursor_renew
+    std::vector<MDB_cursor *> cursorPool;
+    // Maximum number of cursors kept in cursorPool
+    size_t maxPooledCursors;
+    // Reset read-only transactions kept for reuse with mdb_txn_renew
+    std::vector<MDB_txn *> readTxnPool;
+    // Maximum number of transactions kept in readTxnPool
+    size_t maxPooledReadTxns;
+    // Whether read transactions on the same snapshot share one MDB_txn (and so one reader slot)
+    bool shareReaderSlots;
+    // Number of read transactions using each shared MDB_txn
+    std::unordered_map<MDB_txn *, unsigned> readTxnRefs;
+    // Shared MDB_txn that new read transactions join while its snapshot is the latest one
+    MDB_txn *currentReadTxn;
+
+    // Read-only transaction behind env.get* and env.getRange, shared by all such reads of this Env (and so of its thread)
+    MDB_txn *sharedReadTxn;
+    // Whether sharedReadTxn currently holds a snapshot (otherwise it is reset)
+    bool sharedReadTxnActive;
+    // When sharedReadTxn got its current snapshot (uv_hrtime)
+    uint64_t sharedReadTxnStart;
+    // Maximum age of the shared snapshot in milliseconds, 0 for no limit
+    uint32_t sharedSnapshotMaxAgeMs;
+    // Resets sharedReadTxn once the event loop gets to run, so an idle Env doesn't pin old pages
+    uv_timer_t *sharedReadTxnTimer;
+
+    // Read transactions holding a snapshot for longer than this many milliseconds are over budget, 0 for no limit
+    uint32_t maxReadTxnAgeMs;
+    // Read transactions whose snapshot is more than this many transactions behind are over budget, 0 for no limit
+    uint32_t maxReadTxnLagTxns;
+    // Whether read transactions over budget are renewed automatically
+    bool renewStaleReadTxns;
+    // Called with details about every read transaction that went over budget
+    Nan::Callback *readTxnBudgetCallback;
+    Nan::AsyncResource *readTxnBudgetResource;
+    // Periodically checks the read transactions against the budget
+    uv_timer_t *readTxnBudgetTimer;
+
     static uv_mutex_t *envsLock;
-    static std::vector<env_path_t> envs;
+    // Opened environments by normalized path, guarded by envsLock
+    static std::unordered_map<std::string, env_path_t> envs;
     static uv_mutex_t *initMutex();
+    // Entry of this Env in envs while it is open
+    env_path_t *envPath;
+    // Drops this Env's reference to its environment, and closes it when no other Env uses it
+    void releaseEnvPath();
+    // Looks up a database opened by any Env of this environment
+    bool findDbi(const std::string &name, dbi_entry_t *entry);
+    // Remembers / forgets an opened database of this environment
+    void cacheDbi(const std::string &name, const dbi_entry_t &entry);
+    void uncacheDbi(MDB_dbi dbi);
+    // Snapshots exported by read transactions of all threads, by the id in their token
+    static uv_mutex_t *snapshotsLock;
+    static std::unordered_map<uint64_t, exported_snapshot_t> exportedSnapshots;
+    static uint64_t lastSnapshotId;
+    // Number of exportedSnapshots entries whose transaction belongs to this Env
+    unsigned exportedSnapshotCount;
+    // Number of env.backup(), env.parallelScan() and env.compact() workers of this Env that haven't called back yet
+    unsigned activeWorkers;
+    // Removes the snapshots exported by a read transaction before it leaves its MDB_txn, or all of them when the MDB_txn ends or gets reset
+    void unexportSnapshots(MDB_txn *txn, TxnWrap *exporter);
     // Cleans up stray transactions
     void cleanupStrayTxns();
+    // Closes all cursors kept in the cursor pool
+    void cleanupCursorPool();
+    // Takes a pooled cursor of the given dbi and renews it for the given read-only txn, or returns nullptr
+    MDB_cursor *takePooledCursor(MDB_txn *txn, MDB_dbi dbi);
+    // Keeps a read-only cursor for reuse, or closes it when the pool is full
+    void releaseCursor(MDB_cursor *cursor);
+    // Closes the pooled cursors of a dbi that is being closed, since its handle may be reused with other flags
+    void cleanupCursorPool(MDB_dbi dbi);
+    // Aborts all transactions kept in the read transaction pool
+    void cleanupReadTxnPool();
+    // Renews a pooled read-only transaction, or begins a new one
+    int takePooledReadTxn(MDB_txn **txn);
+    // Resets a read-only transaction and keeps it for reuse, or aborts it when the pool is full
+    void releaseReadTxn(MDB_txn *txn);
+    // Takes another reference to currentReadTxn if it still holds the latest snapshot
+    bool joinCurrentReadTxn(MDB_txn **txn);
+    // Makes a freshly begun or renewed MDB_txn the one new read transactions join
+    void makeCurrentReadTxn(MDB_txn *txn);
+    // Joins currentReadTxn if it still holds the latest snapshot, otherwise begins a new one (from the pool if pooled)
+    int beginReadTxn(MDB_txn **txn, bool pooled);
+    // Drops the reference of a read transaction to its MDB_txn, and releases (or aborts) it when nobody uses it anymore
+    void endReadTxn(TxnWrap *tw, bool release);
+    // Resets the MDB_txn of a read transaction, or switches it to an own reset one when other transactions still share it
+    int resetReadTxn(TxnWrap *tw);
+    // Renews a reset read-only MDB_txn, joining currentReadTxn when possible
+    int renewReadTxn(MDB_txn **txn);
+    // Adds a read transaction to / removes it from readTxns in O(1)
+    void addReadTxn(TxnWrap *tw);
+    void removeReadTxn(TxnWrap *tw);
+    // Gets the shared read-only transaction, renewing it when a newer transaction was committed or it got too old
+    int getSharedReadTxn(MDB_txn **txn);
+    // Resets the shared read-only transaction, so that it doesn't hold a snapshot
+    void resetSharedReadTxn();
+    // Aborts the shared read-only transaction and closes its timer
+    void cleanupSharedReadTxn();
+    static void onSharedReadTxnIdle(uv_timer_t *timer);
+    // Checks all read transactions against maxReadTxnAgeMs / maxReadTxnLagTxns
+    void checkReadTxnBudget();
+    static void onReadTxnBudgetTimer(uv_timer_t *timer);
+    // Stops the budget timer and frees the budget callback
+    void cleanupReadTxnBudget();
+    // Common code for env.get* methods
+    static Nan::NAN_METHOD_RETURN_TYPE getCommon(Nan::NAN_METHOD_ARGS_TYPE info, Local<Value> (*successFunc)(MDB_val &));
 
     friend class TxnWrap;
     friend class DbiWrap;
+    friend class CursorWrap;
+    friend class CompactWorker;
 
 public:
     EnvWrap();
@@ -183,7 +307,29 @@ public:
         * maxDbs: the maximum number of named databases you can have in the environment (default is 1)
         * maxReaders: the maximum number of concurrent readers of the environment (default is 126)
         * mapSize: maximal size of the memory map (the full environment) in bytes (default is 10485760 bytes)
+        * pageSize: page size of a newly created environment in bytes, a power of two from the OS page size up to 32768
+          (default is the OS page size). Larger pages make trees shallower and store larger values without overflow pages.
+          Existing environments keep their page size.
+        * maxMapSize: if given, the memory map grows automatically up to this size when it gets full, instead of failing with MDB_MAP_FULL.
+          It grows in place while transactions are open, and other threads and processes with this option adopt the new size.
+          Not supported on Windows and 32-bit platforms.
+        * mapGrowthStep: bytes added on each growth of the memory map (default is 0, grow geometrically)
+        * mapGrowthFactor: the memory map grows to this multiple of its size when mapGrowthStep is not given (default is 2)
+        * maxDirtySize: bytes of changed pages a write transaction keeps in memory before it writes some of them out early (default is 131071 pages).
+          Raising it speeds up very large transactions and lets nested transactions within them hold more changes.
+        * maxArenaSize: bytes of memory that write transactions used for changed pages, kept for reuse by later ones (default is 64MB).
+          Chunks of up to 16 pages are kept, so large values are not malloc'd and freed on every write. See arenaHits and arenaMisses in env.info().
         * path: path to the database environment
+        * cursorPoolSize: the maximum number of closed read-only cursors kept for reuse (default is 32)
+        * readTxnPoolSize: the maximum number of released read-only transactions kept for reuse (default is 8). Each of them keeps its reader slot.
+        * shareReaderSlots: if true, read-only transactions started while no newer transaction was committed share one LMDB transaction
+          and so one slot of the reader table, making the number of readers independent of the number of open read transactions (default is true)
+        * sharedSnapshotMaxAgeMs: the maximum age of the snapshot used by env.get* and env.getRange in milliseconds, 0 for no limit (default is 1000)
+        * maxReadTxnAgeMs: read-only transactions holding a snapshot for longer than this are over budget (default is 0, no limit)
+        * maxReadTxnLagTxns: read-only transactions whose snapshot is more than this many transactions behind the last commit are over budget (default is 0, no limit)
+        * onReadTxnBudgetExceeded: function called with { txn, stack, ageMs, lagTxns, renewed } for each read-only transaction that went over budget.
+          stack is where the transaction was started.
+        * renewStaleReadTxns: if true, read-only transactions over budget are renewed to the latest snapshot and their cursors re-seek to their current key
     */
     static NAN_METHOD(open);
 
@@ -210,7 +356,42 @@ public:
     static NAN_METHOD(copy);
 
     /*
-        Closes the database environment.
+        Compacts the database environment in place: a compacted copy is made in the background,
+        then renamed over the data file and mapped instead of it, so the file shrinks to the size of the data.
+        Writes committed while copying make it copy again, the last time while holding the write lock.
+        When the copy is swapped in, no other process and no other Env of this process may use the environment,
+        and this Env may not have open transactions; the callback gets an error otherwise. Read transactions
+        that begin meanwhile wait until the copy is swapped in. Throws while env.backup(), env.parallelScan()
+        or env.compact() of this Env is in progress, and the Env can't be closed until the callback is called.
+        Not supported on Windows.
+        (Wrapper for `mdb_env_compact_copy` and `mdb_env_compact_swap`)
+
+        Parameters:
+
+        * callback - Callback when finished (this is performed asynchronously)
+    */
+    static NAN_METHOD(compact);
+
+    /*
+        Writes a hot backup of the database environment to a file descriptor or a stream, optionally throttled.
+        The copy is made by a background thread from a read-only transaction, which stays open until it is done,
+        so a throttled backup keeps old pages from being reused for longer.
+        (Wrapper for `mdb_env_copyfd3`)
+
+        Parameters:
+
+        * options object that contains possible configuration options:
+            * fd - File descriptor to write the backup to, it is not closed afterwards
+            * stream - Writable stream to write the backup to, in chunks of 1MB; it is not ended afterwards
+            * compact - Omit free pages and renumber all pages (default is false)
+            * maxBytesPerSec - Limit the rate of writing the backup (default is unlimited)
+            * onProgress - Called with { bytes, totalBytes, pages, totalPages } as the backup proceeds
+        * callback - Callback when finished (this is performed asynchronously)
+    */
+    static NAN_METHOD(backup);
+
+    /*
+        Closes the database environment. Throws while a backup, parallel scan or compaction of it is in progress.
         (Wrapper for `mdb_env_close`)
     */
     static NAN_METHOD(close);
@@ -226,9 +407,54 @@ public:
         Possible options are:
 
         * readOnly: if true, the transaction is read-only
+        * snapshot: a token returned by `txn.exportSnapshot()`, possibly in another thread. The transaction is read-only and
+          reads exactly the snapshot of the exporting transaction, which must still be open when this is called.
     */
     static NAN_METHOD(beginTxn);
 
+    /*
+        Starts a read-only transaction, reusing a transaction handle from the pool of the environment when there is one.
+        The transaction should be given back with `txn.release()` instead of `txn.abort()`.
+        (Wrapper for `mdb_txn_renew`, or `mdb_txn_begin` when the pool is empty)
+    */
+    static NAN_METHOD(acquireReadTxn);
+
+    /*
+        Gets data associated with the given key from a database, without an explicit transaction.
+        All these reads share one read-only snapshot per Env, which is renewed when a newer transaction was committed
+        or it is older than sharedSnapshotMaxAgeMs, and reset once the event loop gets to run.
+        Data written by an uncommitted write transaction is not visible.
+
+        Parameters:
+
+        * database instance created with calling `openDbi()` on an `Env` instance
+        * key for which the value is retrieved
+        * Options object (optional) with the key type
+    */
+    static NAN_METHOD(getString);
+    static NAN_METHOD(getBinary);
+    static NAN_METHOD(getNumber);
+    static NAN_METHOD(getBoolean);
+
+    /*
+        Gets the key/value pairs of a range of keys, using the same shared snapshot as env.get*.
+
+        Parameters:
+
+        * database instance created with calling `openDbi()` on an `Env` instance
+        * start key (inclusive), or null to start at the first key
+        * end key (exclusive), or null to end after the last key
+        * Options object (optional)
+
+        Possible options are:
+
+        * limit: the maximum number of entries returned
+        * keyIsUint32, keyIsBuffer, keyIsString: key type of the given and returned keys
+
+        Returns an array of { key, value } objects, where value is a Buffer.
+    */
+    static NAN_METHOD(getRange);
+
     /*
         Opens a database in the environment.
         (Wrapper for `mdb_dbi_open`)
@@ -247,6 +473,9 @@ public:
         * dupFixed: if dupSort is true, indicates that the data items are all the same size
         * integerDup: duplicate data items are also integers, and should be sorted as such
         * reverseDup: duplicate data items should be compared as strings in reverse order
+
+        Databases opened by any Env of the same environment (also in other threads) are reused without a transaction.
+        Their flags and key type then apply unless other ones are given.
     */
     static NAN_METHOD(openDbi);
 
@@ -268,6 +497,26 @@ public:
         * Callback to be executed after the sync is complete.
     */
     static NAN_METHOD(batchWrite);
+
+    /*
+        Scans a whole database on native threads, one read-only transaction per partition.
+        All transactions read the same snapshot. Partitions are bounded by the keys returned by `dbi.splitPoints`.
+
+        Parameters:
+
+        * Dbi object
+        * Options object
+        * Callback to be executed after all partitions are scanned, with an error and the id of the scanned snapshot
+
+        Possible options are:
+
+        * worker: function called on the main thread with an array of { key, value } entries (value is a Buffer) and the partition index
+        * partitions: number of partitions and threads (default is the number of CPUs)
+        * chunkSize: number of entries passed to a single worker call (default is 1000), at most two chunks
+          per partition wait for the worker before the scanning threads pause
+        * keyIsUint32, keyIsBuffer, keyIsString: key type of the entries (default is the key type of the Dbi)
+    */
+    static NAN_METHOD(parallelScan);
 };
 
 /*
@@ -290,6 +539,22 @@ private:
     // Flags used with mdb_txn_begin
     unsigned int flags;
 
+    // Neighbours in the read transaction list of the EnvWrap
+    TxnWrap *prevReadTxn;
+    TxnWrap *nextReadTxn;
+
+    // Open cursors of this transaction
+    std::vector<CursorWrap *> cursors;
+    // When the current snapshot was taken (uv_hrtime), or 0 when the transaction is reset
+    uint64_t snapshotTime;
+    // Whether the current snapshot was already reported as over budget
+    bool overBudgetReported;
+    // Error object created where the transaction was started, only kept when the Env has a read transaction budget
+    Nan::Persistent<Object> startStack;
+
+    // Renews the snapshot of a read-only transaction and moves its cursors to the same keys in the new snapshot
+    int renewSnapshot();
+
     // Remove the current TxnWrap from its EnvWrap
     void removeFromEnvWrap();
 
@@ -334,6 +599,21 @@ public:
     */
     static NAN_METHOD(renew);
 
+    /*
+        Ends a read-only transaction and gives its handle back to the pool of the environment, see `env.acquireReadTxn()`.
+        (Wrapper for `mdb_txn_reset`)
+    */
+    static NAN_METHOD(release);
+
+    /*
+        Exports the snapshot of a read-only transaction, so that transactions of other threads can read the same version
+        of the data with `env.beginTxn({ snapshot })`. Each of them keeps the pages of the snapshot alive by itself,
+        so the token is valid until this transaction ends or is reset, also while other transactions still share its snapshot.
+
+        Returns an object { snapshotId, txnId } that can be passed to other threads with postMessage.
+    */
+    static NAN_METHOD(exportSnapshot);
+
     /*
         Gets string data (JavaScript string type) associated with the given key from a database. You need to open a database in the environment to use this.
         This method is not zero-copy and the return value will usable as long as there is a reference to it.
@@ -517,6 +797,39 @@ public:
     static NAN_METHOD(drop);
 
     static NAN_METHOD(stat);
+
+    /*
+        Estimates the number of keys between two keys without scanning them.
+        Only the two boundary leaf pages are counted, the pages between them are extrapolated from the tree's fan-out.
+        (Wrapper for `mdb_estimate_range`)
+
+        Parameters:
+
+        * Transaction object
+        * start key (inclusive), or null to start at the first key
+        * end key (exclusive), or null to end after the last key
+        * Options object (optional)
+
+        Possible options are:
+
+        * errorBound: if true, returns { estimate, errorBound } where errorBound is the number of keys that were extrapolated rather than counted
+    */
+    static NAN_METHOD(estimateRange);
+
+    /*
+        Finds keys that split the database into partitions of similar size, by reading the branch pages near the root.
+        (Wrapper for `mdb_split_points`)
+
+        Parameters:
+
+        * Transaction object
+        * number of partitions
+        * Options object (optional) with the key type of the returned keys
+
+        Returns an array of at most (partitions - 1) keys in ascending order. Partition i covers [keys[i - 1], keys[i]).
+        Small databases may return fewer keys.
+    */
+    static NAN_METHOD(splitPoints);
 };
 
 /*
@@ -536,13 +849,24 @@ private:
     MDB_val key, data;
     // Free function for the current key
     argtokey_callback_t freeKey;
+    // Number of sibling pages read ahead during scans, see mdb_cursor_readahead
+    unsigned int readAhead;
 
     DbiWrap *dw;
     TxnWrap *tw;
 
+    friend class TxnWrap;
+
     template <size_t keyIndex, size_t optionsIndex>
     friend argtokey_callback_t cursorArgToKey(CursorWrap *cw, Nan::NAN_METHOD_ARGS_TYPE info, MDB_val &key, bool &keyIsValid);
 
+    // Calls mdb_cursor_get with the cursor's own key, freeing the previous key once it points inside LMDB
+    int cursorGet(MDB_val *data, MDB_cursor_op op);
+    // Opens a cursor, reusing a pooled one for read-only transactions
+    static int openCursor(TxnWrap *tw, DbiWrap *dw, MDB_cursor **cursor);
+    // Closes the wrapped cursor, returning it to the pool when it belongs to a read-only transaction
+    void closeCursor();
+
 public:
     CursorWrap(MDB_cursor *cursor);
     ~CursorWrap();
@@ -558,6 +882,10 @@ public:
 
         * Transaction object
         * Database instance object
+        * Options object (optional), with the key type and:
+          - readAhead: when goToNext or goToPrev move to another leaf page, ask the OS to read this many of
+            the following pages in the background, so scans of data which is not in memory don't wait for
+            each page in turn (default is 0, off). Not supported on 32-bit platforms.
     */
     static NAN_METHOD(ctor);
 
@@ -572,6 +900,16 @@ public:
     */
     static NAN_METHOD(close);
 
+    /*
+        Rebinds the cursor to another read-only transaction on the same database, also after it has been closed.
+        (Wrapper for `mdb_cursor_renew`)
+
+        Parameters:
+
+        * Transaction object
+    */
+    static NAN_METHOD(renew);
+
     static NAN_METHOD(exists);
 
     // Helper method for getters (not exposed)
@@ -674,6 +1012,8 @@ public:
 
     /*
         Asks the cursor to go to the specified key in the database.
+        On a cursor that is already positioned, the search starts from the current page and only climbs
+        the tree as far as needed, so lookups near the previous one are cheaper. The same goes for goToRange.
         (Wrapper for `mdb_cursor_get`)
     */
     static NAN_METHOD(goToKey);
@@ -684,6 +1024,27 @@ public:
     */
     static NAN_METHOD(goToRange);
 
+    /*
+        Looks up a list of keys in one call, reusing the cursor's position between lookups.
+        When the keys are sorted in ascending order, most lookups are resolved on the current leaf page
+        or its right sibling instead of descending from the root. Unsorted keys work too, just slower.
+        (Wrapper for `mdb_cursor_get` with `MDB_SET_KEY`)
+
+        Parameters:
+
+        * Array of keys
+        * Options object (optional)
+
+        Possible options are:
+
+        * valueType: "binary" (default), "string", "number" or "boolean"
+        * keyIsUint32, keyIsBuffer, keyIsString: key type of the given keys
+
+        Returns an array with the value of each key, or null where the key was not found.
+        The cursor is left on the last key that was found.
+    */
+    static NAN_METHOD(seekMany);
+
     /*
         For databases with the dupSort option. Asks the cursor to go to the first occurence of the current key.
         (Wrapper for `mdb_cursor_get`)
@@ -724,6 +1085,43 @@ public:
 
     static NAN_METHOD(goToPrevNoDup);
 
+    /*
+        For databases with the dupFixed option. Gets all data items of the current key as a single typed array.
+        The items are fetched a page at a time and copied, so the result can be used after the transaction ends.
+        Leaves the cursor on the last data item of the current key.
+        (Wrapper for `mdb_cursor_get` with `MDB_GET_MULTIPLE` and `MDB_NEXT_MULTIPLE`)
+
+        Parameters:
+
+        * Options object (optional)
+
+        Possible options are:
+
+        * arrayType: one of "Uint32Array", "Int32Array", "Float64Array", "BigUint64Array" or "Buffer".
+          Defaults to Uint32Array for 4 byte items, BigUint64Array (integerDup) or Float64Array for 8 byte items and Buffer otherwise.
+    */
+    static NAN_METHOD(getMultiple);
+
+    /*
+        For databases with the dupFixed option. Gets the data items of the current key that are on the same page as the cursor.
+        (Wrapper for `mdb_cursor_get` with `MDB_GET_MULTIPLE`)
+
+        Parameters:
+
+        * Options object (optional), see getMultiple
+    */
+    static NAN_METHOD(getCurrentMultiple);
+
+    /*
+        For databases with the dupFixed option. Moves to the next page of data items of the current key and returns them, or null at the end.
+        (Wrapper for `mdb_cursor_get` with `MDB_NEXT_MULTIPLE`)
+
+        Parameters:
+
+        * Options object (optional), see getMultiple
+    */
+    static NAN_METHOD(goToNextMultiple);
+
     /*
         Deletes the key/data pair to which the cursor refers.
         (Wrapper for `mdb_cursor_del`)
@@ -30,14 +30,24 @@ TxnWrap::TxnWrap(MDB_env *env, MDB_txn *txn) {
     this->env = env;
     this->txn = txn;
     this->flags = 0;
+    this->prevReadTxn = nullptr;
+    this->nextReadTxn = nullptr;
+    this->snapshotTime = uv_hrtime();
+    this->overBudgetReported = false;
 }
 
 TxnWrap::~TxnWrap() {
     // Close if not closed already
     if (this->txn) {
-        mdb_txn_abort(txn);
+        if (this->ew && (this->flags & MDB_RDONLY)) {
+            this->ew->endReadTxn(this, false);
+        }
+        else {
+            mdb_txn_abort(txn);
+        }
         this->removeFromEnvWrap();
     }
+    this->startStack.Reset();
 }
 
 void TxnWrap::removeFromEnvWrap() {
@@ -46,10 +56,7 @@ void TxnWrap::removeFromEnvWrap() {
             this->ew->currentWriteTxn = nullptr;
         }
         else {
-            auto it = std::find(ew->readTxns.begin(), ew->readTxns.end(), this);
-            if (it != ew->readTxns.end()) {
-                ew->readTxns.erase(it);
-            }
+            this->ew->removeReadTxn(this);
         }
         
         this->ew->Unref();
@@ -62,6 +69,7 @@ NAN_METHOD(TxnWrap::ctor) {
 
     EnvWrap *ew = Nan::ObjectWrap::Unwrap<EnvWrap>(Local<Object>::Cast(info[0]));
     int flags = 0;
+    Local<Value> snapshotToken = Nan::Undefined();
 
     if (info[1]->IsObject()) {
         Local<Object> options = Local<Object>::Cast(info[1]);
@@ -69,6 +77,12 @@ NAN_METHOD(TxnWrap::ctor) {
         // Get flags from options
 
         setFlagFromValue(&flags, MDB_RDONLY, "readOnly", false, options);
+
+        // Transactions attached to an exported snapshot can only read it
+        snapshotToken = options->Get(Nan::GetCurrentContext(), Nan::New<String>("snapshot").ToLocalChecked()).ToLocalChecked();
+        if (snapshotToken->IsObject()) {
+            flags = MDB_RDONLY;
+        }
     }
     
     // Check existence of current write transaction
@@ -76,8 +90,44 @@ NAN_METHOD(TxnWrap::ctor) {
         return Nan::ThrowError("You have already opened a write transaction in the current process, can't open a second one.");
     }
 
+    // Transactions of env.acquireReadTxn() come from the pool of the environment
+    bool pooled = info[2]->IsTrue();
+    if (pooled) {
+        flags = MDB_RDONLY;
+    }
+
     MDB_txn *txn;
-    int rc = mdb_txn_begin(ew->env, nullptr, flags, &txn);
+    int rc = 0;
+    if (snapshotToken->IsObject()) {
+        Local<Value> snapshotId = Local<Object>::Cast(snapshotToken)->Get(Nan::GetCurrentContext(), Nan::New<String>("snapshotId").ToLocalChecked()).ToLocalChecked();
+        if (!snapshotId->IsNumber()) {
+            return Nan::ThrowError("Invalid snapshot token, it should be the result of txn.exportSnapshot().");
+        }
+
+        // The exporting transaction can't end while the lock is held, so its snapshot stays valid until we hold it too
+        const char *error = nullptr;
+        uv_mutex_lock(EnvWrap::snapshotsLock);
+        auto snapshot = EnvWrap::exportedSnapshots.find((uint64_t) Nan::To<double>(snapshotId).FromJust());
+        if (snapshot == EnvWrap::exportedSnapshots.end()) {
+            error = "The snapshot is no longer available, the transaction that exported it has ended or was reset.";
+        }
+        else if (snapshot->second.env != ew->env) {
+            error = "The snapshot belongs to another environment.";
+        }
+        else {
+            rc = mdb_txn_begin_snapshot(ew->env, snapshot->second.txn, &txn);
+        }
+        uv_mutex_unlock(EnvWrap::snapshotsLock);
+        if (error) {
+            return Nan::ThrowError(error);
+        }
+    }
+    else if (flags & MDB_RDONLY) {
+        rc = ew->beginReadTxn(&txn, pooled);
+    }
+    else {
+        rc = mdb_txn_begin(ew->env, nullptr, flags, &txn);
+    }
     if (rc != 0) {
         if (rc == EINVAL) {
             return Nan::ThrowError("Invalid parameter, which on MacOS is often due to more transactions than available robust locked semaphors (see node-lmdb docs for more info)");
@@ -96,7 +146,11 @@ NAN_METHOD(TxnWrap::ctor) {
         ew->currentWriteTxn = tw;
     }
     else {
-        ew->readTxns.push_back(tw);
+        ew->addReadTxn(tw);
+        if (ew->maxReadTxnAgeMs || ew->maxReadTxnLagTxns) {
+            // Remember where the transaction was started, to report it when it goes over budget
+            tw->startStack.Reset(Nan::To<Object>(Nan::Error("Read transaction started")).ToLocalChecked());
+        }
     }
 
     return info.GetReturnValue().Set(info.This());
@@ -111,7 +165,14 @@ NAN_METHOD(TxnWrap::commit) {
         return Nan::ThrowError("The transaction is already closed.");
     }
 
-    int rc = mdb_txn_commit(tw->txn);
+    int rc = 0;
+    if (tw->ew && (tw->flags & MDB_RDONLY)) {
+        // Committing a read-only transaction just ends it
+        tw->ew->endReadTxn(tw, false);
+    }
+    else {
+        rc = mdb_txn_commit(tw->txn);
+    }
     tw->removeFromEnvWrap();
     tw->txn = nullptr;
 
@@ -129,7 +190,12 @@ NAN_METHOD(TxnWrap::abort) {
         return Nan::ThrowError("The transaction is already closed.");
     }
 
-    mdb_txn_abort(tw->txn);
+    if (tw->ew && (tw->flags & MDB_RDONLY)) {
+        tw->ew->endReadTxn(tw, false);
+    }
+    else {
+        mdb_txn_abort(tw->txn);
+    }
     tw->removeFromEnvWrap();
     tw->txn = nullptr;
 }
@@ -143,7 +209,11 @@ NAN_METHOD(TxnWrap::reset) {
         return Nan::ThrowError("The transaction is already closed.");
     }
 
-    mdb_txn_reset(tw->txn);
+    int rc = (tw->ew && (tw->flags & MDB_RDONLY)) ? tw->ew->resetReadTxn(tw) : (mdb_txn_reset(tw->txn), 0);
+    if (rc != 0) {
+        return throwLmdbError(rc);
+    }
+    tw->snapshotTime = 0;
 }
 
 NAN_METHOD(TxnWrap::renew) {
@@ -155,10 +225,132 @@ NAN_METHOD(TxnWrap::renew) {
         return Nan::ThrowError("The transaction is already closed.");
     }
 
-    int rc = mdb_txn_renew(tw->txn);
+    int rc = (tw->ew && (tw->flags & MDB_RDONLY)) ? tw->ew->renewReadTxn(&tw->txn) : mdb_txn_renew(tw->txn);
     if (rc != 0) {
         return throwLmdbError(rc);
     }
+    tw->snapshotTime = uv_hrtime();
+    tw->overBudgetReported = false;
+}
+
+int TxnWrap::renewSnapshot() {
+    // Copy the position of every cursor first, since the keys point into the old snapshot
+    struct position_t {
+        CursorWrap *cw;
+        std::vector<char> key;
+        std::vector<char> data;
+        bool isPositioned;
+    };
+    std::vector<position_t> positions(this->cursors.size());
+    for (size_t i = 0; i < this->cursors.size(); i++) {
+        position_t &position = positions[i];
+        position.cw = this->cursors[i];
+        MDB_val key, data;
+        position.isPositioned = mdb_cursor_get(position.cw->cursor, &key, &data, MDB_GET_CURRENT) == 0;
+        if (position.isPositioned) {
+            position.key.assign((char *)key.mv_data, (char *)key.mv_data + key.mv_size);
+            position.data.assign((char *)data.mv_data, (char *)data.mv_data + data.mv_size);
+        }
+    }
+
+    // Other transactions may still share the old snapshot, so switch to a renewed (or the current) one
+    int rc = this->ew->resetReadTxn(this);
+    if (rc != 0) {
+        return rc;
+    }
+    this->snapshotTime = 0;
+    rc = this->ew->renewReadTxn(&this->txn);
+    if (rc != 0) {
+        return rc;
+    }
+    this->snapshotTime = uv_hrtime();
+    this->overBudgetReported = false;
+
+    for (position_t &position : positions) {
+        CursorWrap *cw = position.cw;
+        int crc = mdb_cursor_renew(this->txn, cw->cursor);
+        if (crc == 0 && position.isPositioned) {
+            // Go to the same key (and data item for dupSort), or the next one if it was deleted meanwhile
+            MDB_val key, data;
+            key.mv_size = position.key.size();
+            key.mv_data = position.key.data();
+            data.mv_size = position.data.size();
+            data.mv_data = position.data.data();
+            bool isDupSort = cw->dw->flags & MDB_DUPSORT;
+            crc = mdb_cursor_get(cw->cursor, &key, &data, isDupSort ? MDB_GET_BOTH_RANGE : MDB_SET_RANGE);
+            if (crc == MDB_NOTFOUND && isDupSort) {
+                // All data items of the key are gone or smaller, so continue at the next key
+                MDB_val savedKey;
+                savedKey.mv_size = position.key.size();
+                savedKey.mv_data = position.key.data();
+                key = savedKey;
+                crc = mdb_cursor_get(cw->cursor, &key, &data, MDB_SET_RANGE);
+                if (crc == 0 && mdb_cmp(this->txn, cw->dw->dbi, &key, &savedKey) == 0) {
+                    crc = mdb_cursor_get(cw->cursor, &key, &data, MDB_NEXT_NODUP);
+                }
+            }
+            // A user supplied key stays valid, otherwise the cursor's key must point into the new snapshot
+            if (!cw->freeKey) {
+                cw->key.mv_size = crc == 0 ? key.mv_size : 0;
+                cw->key.mv_data = crc == 0 ? key.mv_data : nullptr;
+            }
+        }
+    }
+    return 0;
+}
+
+NAN_METHOD(TxnWrap::release) {
+    Nan::HandleScope scope;
+
+    TxnWrap *tw = Nan::ObjectWrap::Unwrap<TxnWrap>(info.This());
+
+    if (!tw->txn) {
+        return Nan::ThrowError("The transaction is already closed.");
+    }
+    if (!(tw->flags & MDB_RDONLY)) {
+        return Nan::ThrowError("Only read-only transactions can be released.");
+    }
+
+    if (tw->ew) {
+        tw->ew->endReadTxn(tw, true);
+    }
+    else {
+        mdb_txn_abort(tw->txn);
+    }
+    tw->startStack.Reset();
+    tw->removeFromEnvWrap();
+    tw->txn = nullptr;
+}
+
+NAN_METHOD(TxnWrap::exportSnapshot) {
+    Nan::HandleScope scope;
+
+    TxnWrap *tw = Nan::ObjectWrap::Unwrap<TxnWrap>(info.This());
+
+    if (!tw->txn) {
+        return Nan::ThrowError("The transaction is already closed.");
+    }
+    if (!(tw->flags & MDB_RDONLY) || !tw->ew) {
+        return Nan::ThrowError("Only read-only transactions can export their snapshot.");
+    }
+    if (!tw->snapshotTime) {
+        return Nan::ThrowError("The transaction is reset, renew it before exporting its snapshot.");
+    }
+
+    uv_mutex_lock(EnvWrap::snapshotsLock);
+    uint64_t snapshotId = ++EnvWrap::lastSnapshotId;
+    exported_snapshot_t &snapshot = EnvWrap::exportedSnapshots[snapshotId];
+    snapshot.env = tw->ew->env;
+    snapshot.txn = tw->txn;
+    snapshot.exporter = tw;
+    uv_mutex_unlock(EnvWrap::snapshotsLock);
+    tw->ew->exportedSnapshotCount++;
+
+    Local<Context> context = Nan::GetCurrentContext();
+    Local<Object> token = Nan::New<Object>();
+    token->Set(context, Nan::New<String>("snapshotId").ToLocalChecked(), Nan::New<Number>((double) snapshotId));
+    token->Set(context, Nan::New<String>("txnId").ToLocalChecked(), Nan::New<Number>((double) mdb_txn_id(tw->txn)));
+    info.GetReturnValue().Set(token);
 }
 
 Nan::NAN_METHOD_RETURN_TYPE TxnWrap::getCommon(Nan::NAN_METHOD_ARGS_TYPE info, Local<Value> (*successFunc)(MDB_val&)) {
@@ -209,6 +209,11 @@ describe('Node.js LMDB Bindings', function() {
       info.lastTxnId.should.be.a('number');
       info.maxReaders.should.be.a('number');
       info.numReaders.should.be.a('number');
+      info.allocTime.should.be.a('number');
+      info.arenaSize.should.be.a('number');
+      info.arenaHits.should.be.a('number');
+      info.arenaMisses.should.be.a('number');
+      info.arenaFrees.should.be.a('number');
 
       should.equal(info.mapSize, MAX_DB_SIZE);
       should.equal(info.maxReaders, 422);
@@ -255,6 +260,240 @@ describe('Node.js LMDB Bindings', function() {
       should.equal(info.mapSize, 2 * MAX_DB_SIZE);
       dbi.close();
     });
+    it('will grow the mapSize automatically when it is full', function() {
+      if (process.platform == 'win32') {
+        return this.skip();
+      }
+      var growEnv = new lmdb.Env();
+      growEnv.open({
+        path: path.resolve(testDirPath, 'grow.mdb'),
+        noSubdir: true,
+        mapSize: 1024 * 1024,
+        maxMapSize: 64 * 1024 * 1024
+      });
+      var dbi = growEnv.openDbi({
+        name: 'grow',
+        create: true,
+        keyIsUint32: true
+      });
+      // A read transaction stays valid while the map grows under it
+      var readTxn = growEnv.beginTxn({ readOnly: true });
+      var txn = growEnv.beginTxn();
+      var value = Buffer.alloc(1000, 1);
+      for (var i = 0; i < 4000; i++) {
+        txn.putBinary(dbi, i, value);
+      }
+      txn.commit();
+      growEnv.info().mapSize.should.be.above(4 * 1024 * 1024);
+      should.equal(readTxn.getBinary(dbi, 1), null);
+      readTxn.abort();
+      txn = growEnv.beginTxn({ readOnly: true });
+      txn.getBinary(dbi, 3999).length.should.equal(1000);
+      txn.abort();
+      growEnv.close();
+    });
+    it('will reuse freed page runs for large values', function() {
+      var runsEnv = new lmdb.Env();
+      runsEnv.open({
+        path: path.resolve(testDirPath, 'runs.mdb'),
+        noSubdir: true,
+        mapSize: 64 * 1024 * 1024
+      });
+      var dbi = runsEnv.openDbi({
+        name: 'runs',
+        create: true,
+        keyIsUint32: true
+      });
+      var value = Buffer.alloc(20000, 1);
+      var txn = runsEnv.beginTxn();
+      for (var i = 0; i < 200; i++) {
+        txn.putBinary(dbi, i, value);
+      }
+      txn.commit();
+      txn = runsEnv.beginTxn();
+      for (i = 0; i < 200; i += 2) {
+        txn.del(dbi, i);
+      }
+      txn.commit();
+      // Pages freed by the last commit become free once it is not the latest
+      txn = runsEnv.beginTxn();
+      txn.putBinary(dbi, 1, value);
+      txn.commit();
+      var before = runsEnv.info().lastPageNumber;
+      txn = runsEnv.beginTxn();
+      for (i = 1000; i < 1100; i++) {
+        txn.putBinary(dbi, i, value);
+      }
+      txn.commit();
+      var info = runsEnv.info();
+      (info.lastPageNumber - before).should.be.below(250);
+      info.allocTime.should.be.above(0);
+      dbi.close();
+      runsEnv.close();
+    });
+    it('will compact the environment in place', function(done) {
+      if (process.platform == 'win32') {
+        return this.skip();
+      }
+      var compactPath = path.resolve(testDirPath, 'compact.mdb');
+      var compactEnv = new lmdb.Env();
+      compactEnv.open({
+        path: compactPath,
+        noSubdir: true,
+        mapSize: 64 * 1024 * 1024
+      });
+      var dbi = compactEnv.openDbi({
+        name: 'compact',
+        create: true,
+        keyIsUint32: true
+      });
+      var txn = compactEnv.beginTxn();
+      var value = Buffer.alloc(1000, 1);
+      for (var i = 0; i < 4000; i++) {
+        txn.putBinary(dbi, i, value);
+      }
+      txn.commit();
+      txn = compactEnv.beginTxn();
+      for (var i = 100; i < 4000; i++) {
+        txn.del(dbi, i);
+      }
+      txn.commit();
+      var size = require('fs').statSync(compactPath).size;
+      compactEnv.compact(function(err) {
+        if (err) {
+          return done(err);
+        }
+        require('fs').statSync(compactPath).size.should.be.below(size / 4);
+        var txn = compactEnv.beginTxn();
+        txn.getBinary(dbi, 99).length.should.equal(1000);
+        should.equal(txn.getBinary(dbi, 100), null);
+        txn.putBinary(dbi, 4000, value);
+        txn.commit();
+        compactEnv.getBinary(dbi, 4000).length.should.equal(1000);
+        compactEnv.close();
+        done();
+      });
+      // The copy is swapped in by the worker, so nothing may close the environment or compact it again meanwhile
+      (function() {
+        compactEnv.compact(function() {});
+      }).should.throw('env.compact() can\'t be called while env.backup(), env.parallelScan() or env.compact() of this Env is in progress.');
+      (function() {
+        compactEnv.close();
+      }).should.throw('The environment can\'t be closed before env.backup(), env.parallelScan() or env.compact() calls back.');
+    });
+    it('will create an environment with a larger page size', function() {
+      var pageEnv = new lmdb.Env();
+      pageEnv.open({
+        path: path.resolve(testDirPath, 'pagesize.mdb'),
+        noSubdir: true,
+        mapSize: 64 * 1024 * 1024,
+        pageSize: 32768
+      });
+      pageEnv.stat().pageSize.should.equal(32768);
+      var dbi = pageEnv.openDbi({
+        name: 'pagesize',
+        create: true,
+        keyIsUint32: true
+      });
+      var txn = pageEnv.beginTxn();
+      for (var i = 0; i < 100; i++) {
+        txn.putBinary(dbi, i, Buffer.alloc(3000, i));
+      }
+      txn.commit();
+      // 3000-byte values fit on 32KB pages without overflow pages
+      var readTxn = pageEnv.beginTxn({ readOnly: true });
+      dbi.stat(readTxn).overflowPages.should.equal(0);
+      readTxn.abort();
+      dbi.close();
+      pageEnv.close();
+      (function() {
+        var badEnv = new lmdb.Env();
+        badEnv.open({ path: path.resolve(testDirPath, 'badpagesize.mdb'), noSubdir: true, pageSize: 6000 });
+      }).should.throw();
+    });
+    it('will keep more dirty pages with maxDirtySize', function() {
+      var bigEnv = new lmdb.Env();
+      bigEnv.open({
+        path: path.resolve(testDirPath, 'dirty.mdb'),
+        noSubdir: true,
+        mapSize: 1024 * 1024 * 1024,
+        maxDirtySize: 1024 * 1024 * 1024
+      });
+      var dbi = bigEnv.openDbi({
+        name: 'dirty',
+        create: true,
+        keyIsUint32: true
+      });
+      var txn = bigEnv.beginTxn();
+      var value = Buffer.alloc(3000, 2);
+      for (var i = 0; i < 20000; i++) {
+        txn.putBinary(dbi, (i * 7919) % 20000, value);
+      }
+      for (i = 0; i < 20000; i += 2) {
+        txn.putBinary(dbi, i, Buffer.alloc(10, 3));
+      }
+      txn.commit();
+      txn = bigEnv.beginTxn({ readOnly: true });
+      txn.getBinary(dbi, 19998).length.should.equal(10);
+      txn.getBinary(dbi, 19999).length.should.equal(3000);
+      txn.abort();
+      dbi.close();
+      bigEnv.close();
+    });
+    it('will reuse dirty page memory across write transactions', function() {
+      var arenaEnv = new lmdb.Env();
+      arenaEnv.open({
+        path: path.resolve(testDirPath, 'arena.mdb'),
+        noSubdir: true,
+        mapSize: 64 * 1024 * 1024,
+        maxArenaSize: 1024 * 1024
+      });
+      var dbi = arenaEnv.openDbi({
+        name: 'arena',
+        create: true,
+        keyIsUint32: true
+      });
+      var value = Buffer.alloc(10000, 4);
+      for (var round = 0; round < 5; round++) {
+        var txn = arenaEnv.beginTxn();
+        for (var i = 0; i < 50; i++) {
+          txn.putBinary(dbi, round * 50 + i, value);
+        }
+        txn.commit();
+      }
+      var info = arenaEnv.info();
+      info.arenaHits.should.be.above(info.arenaMisses);
+      info.arenaSize.should.be.within(1, 1024 * 1024);
+      dbi.close();
+      arenaEnv.close();
+    });
+    it('will open thousands of named databases', function() {
+      var count = 2000;
+      var manyPath = path.resolve(testDirPath, 'many.mdb');
+      var manyEnv = new lmdb.Env();
+      manyEnv.open({ path: manyPath, noSubdir: true, maxDbs: count + 10 });
+      var txn = manyEnv.beginTxn();
+      var dbis = [];
+      for (var i = 0; i < count; i++) {
+        dbis.push(manyEnv.openDbi({ name: 'tenant-' + ((i * 7919) % count), create: true, txn: txn }));
+        txn.putString(dbis[i], 'id', String((i * 7919) % count));
+      }
+      txn.commit();
+      dbis.forEach(function(dbi) { dbi.close(); });
+      manyEnv.close();
+
+      manyEnv = new lmdb.Env();
+      manyEnv.open({ path: manyPath, noSubdir: true, maxDbs: count + 10 });
+      txn = manyEnv.beginTxn({ readOnly: true });
+      dbis = [];
+      for (i = 0; i < count; i += 97) {
+        dbis.push(manyEnv.openDbi({ name: 'tenant-' + i, txn: txn }));
+        txn.getString(dbis[dbis.length - 1], 'id').should.equal(String(i));
+      }
+      txn.abort();
+      dbis.forEach(function(dbi) { dbi.close(); });
+      manyEnv.close();
+    });
     it('will get statistics about an environment', function() {
       var stat = env.stat();
       stat.pageSize.should.be.a('number');
@@ -278,6 +517,87 @@ describe('Node.js LMDB Bindings', function() {
       txn.abort();
       dbi.close();
     });
+    it('will estimate the number of keys in a range', function() {
+      var dbi = env.openDbi({
+        name: 'estimateRange',
+        create: true,
+        keyIsUint32: true
+      });
+      var txn = env.beginTxn();
+      for (var i = 0; i < 20000; i++) {
+        txn.putNumber(dbi, i, i);
+      }
+      txn.commit();
+
+      txn = env.beginTxn({ readOnly: true });
+      var total = dbi.estimateRange(txn, null, null);
+      total.should.be.within(20000 * 0.8, 20000 * 1.2);
+      var range = dbi.estimateRange(txn, 1000, 15000);
+      range.should.be.within(14000 * 0.8, 14000 * 1.2);
+      // Both boundaries on the same leaf page are counted exactly
+      dbi.estimateRange(txn, 10, 15).should.equal(5);
+      dbi.estimateRange(txn, 15, 10).should.equal(0);
+      // So is a reversed range spanning many pages
+      dbi.estimateRange(txn, 15000, 1000).should.equal(0);
+      var bounded = dbi.estimateRange(txn, 1000, 15000, { errorBound: true });
+      bounded.estimate.should.equal(range);
+      bounded.errorBound.should.be.within(0, bounded.estimate);
+      dbi.estimateRange(txn, 10, 15, { errorBound: true }).errorBound.should.equal(0);
+      txn.abort();
+      dbi.drop();
+    });
+    it('will scan a database in parallel partitions', function(done) {
+      var dbi = env.openDbi({
+        name: 'parallelScan',
+        create: true,
+        keyIsUint32: true
+      });
+      var txn = env.beginTxn();
+      for (var i = 0; i < 20000; i++) {
+        txn.putNumber(dbi, i, i);
+      }
+      txn.commit();
+
+      txn = env.beginTxn({ readOnly: true });
+      var splits = dbi.splitPoints(txn, 4);
+      splits.length.should.equal(3);
+      splits[0].should.be.below(splits[1]);
+      splits[1].should.be.below(splits[2]);
+      dbi.splitPoints(txn, 1).length.should.equal(0);
+      txn.abort();
+
+      var seen = new Array(20000).fill(0);
+      var partitionsSeen = {};
+      var closeTried = false;
+      env.parallelScan(dbi, {
+        partitions: 4,
+        chunkSize: 500,
+        worker: function(entries, partition) {
+          if (!closeTried) {
+            // The partitions still read from the environment
+            closeTried = true;
+            (function() {
+              env.close();
+            }).should.throw('The environment can\'t be closed before env.backup(), env.parallelScan() or env.compact() calls back.');
+          }
+          entries.length.should.be.within(1, 500);
+          partitionsSeen[partition] = true;
+          entries.forEach(function(entry) {
+            entry.value.readDoubleLE(0).should.equal(entry.key);
+            seen[entry.key]++;
+          });
+        }
+      }, function(err, txnId) {
+        if (err) {
+          return done(err);
+        }
+        txnId.should.be.a('number');
+        Object.keys(partitionsSeen).length.should.equal(4);
+        seen.every(function(count) { return count === 1; }).should.equal(true);
+        dbi.drop();
+        done();
+      });
+    });
     it('will create a database with a user-supplied transaction', function () {
       var txn = env.beginTxn();
       var dbi = env.openDbi({
@@ -309,6 +629,66 @@ describe('Node.js LMDB Bindings', function() {
       });
 //      console.log('sent copy')
     });
+    it('will back up to a file descriptor and to a stream', function (done) {
+      var fs = require('fs');
+      var Writable = require('stream').Writable;
+      var backupPath = path.resolve(testDirPath, 'backup.mdb');
+      var fd = fs.openSync(backupPath, 'w');
+      var progress = [];
+      env.backup({
+        fd: fd,
+        compact: true,
+        maxBytesPerSec: 64 * 1024 * 1024,
+        onProgress: function(p) {
+          if (!progress.length) {
+            // The backup still reads from the environment
+            (function() {
+              env.close();
+            }).should.throw('The environment can\'t be closed before env.backup(), env.parallelScan() or env.compact() calls back.');
+          }
+          progress.push(p);
+        }
+      }, function(error) {
+        fs.closeSync(fd);
+        if (error) {
+          return done(error);
+        }
+        progress.length.should.be.above(0);
+        var last = progress[progress.length - 1];
+        last.bytes.should.equal(last.totalBytes);
+        last.pages.should.equal(last.totalPages);
+        fs.statSync(backupPath).size.should.equal(last.totalBytes);
+
+        var backupEnv = new lmdb.Env();
+        backupEnv.open({ path: backupPath, noSubdir: true, readOnly: true, maxDbs: 10 });
+        var dbi = backupEnv.openDbi({ name: 'backup' });
+        var txn = backupEnv.beginTxn({ readOnly: true });
+        txn.getString(dbi, 'hello').should.equal('world');
+        txn.abort();
+        backupEnv.close();
+
+        var chunks = [];
+        var stream = new Writable({
+          write: function(chunk, encoding, callback) {
+            if (!chunks.length) {
+              (function() {
+                env.close();
+              }).should.throw('The environment can\'t be closed before env.backup(), env.parallelScan() or env.compact() calls back.');
+            }
+            chunks.push(chunk);
+            setImmediate(callback);
+          }
+        });
+        env.backup({ stream: stream }, function(error) {
+          if (error) {
+            return done(error);
+          }
+          chunks.length.should.be.above(0);
+          Buffer.concat(chunks).length.should.equal(env.info().lastPageNumber * env.stat().pageSize + env.stat().pageSize);
+          done();
+        });
+      });
+    });
   });
   describe('Data types', function() {
     this.timeout(10000);
@@ -459,6 +839,221 @@ describe('Node.js LMDB Bindings', function() {
       }).should.throw('Permission denied');
       readTxn.abort();
     });
+    it('will read through the shared snapshot of the environment', function(done) {
+      should.equal(env.getString(dbi, 1), 'Hello1');
+      should.equal(env.getString(dbi, 3), null);
+
+      // A commit renews the snapshot right away
+      var writeTxn = env.beginTxn();
+      writeTxn.putString(dbi, 3, 'Hello3');
+      should.equal(env.getString(dbi, 3), null);
+      writeTxn.commit();
+      should.equal(env.getString(dbi, 3), 'Hello3');
+
+      var entries = env.getRange(dbi, 2, null);
+      entries.map(function(entry) { return entry.key; }).should.deep.equal([2, 3]);
+      entries[1].value.toString('utf16le').should.equal('Hello3\0');
+      env.getRange(dbi, null, null, { limit: 1 }).length.should.equal(1);
+      env.getRange(dbi, 1, 3).length.should.equal(2);
+
+      setImmediate(function() {
+        // The snapshot was reset in the meantime, reads renew it
+        should.equal(env.getString(dbi, 3), 'Hello3');
+        writeTxn = env.beginTxn();
+        writeTxn.del(dbi, 3);
+        writeTxn.commit();
+        should.equal(env.getString(dbi, 3), null);
+        done();
+      });
+    });
+    it('will report and renew read transactions over budget', function(done) {
+      var reports = [];
+      var budgetEnv = new lmdb.Env();
+      budgetEnv.open({
+        path: testDirPath,
+        maxDbs: 10,
+        maxReadTxnAgeMs: 20,
+        renewStaleReadTxns: true,
+        onReadTxnBudgetExceeded: function(details) {
+          reports.push(details);
+        }
+      });
+      var budgetDbi = budgetEnv.openDbi({
+        name: 'mydb4',
+        keyIsUint32: true
+      });
+      var readTxn = budgetEnv.beginTxn({ readOnly: true });
+      var cursor = new lmdb.Cursor(readTxn, budgetDbi);
+      cursor.goToKey(2).should.equal(2);
+
+      var writeTxn = budgetEnv.beginTxn();
+      writeTxn.putString(budgetDbi, 5, 'Renewed');
+      writeTxn.commit();
+      should.equal(readTxn.getString(budgetDbi, 5), null);
+
+      setTimeout(function() {
+        reports.length.should.equal(1);
+        reports[0].txn.should.equal(readTxn);
+        reports[0].renewed.should.equal(true);
+        reports[0].ageMs.should.be.at.least(20);
+        reports[0].stack.should.contain('index.test.js');
+        // The snapshot moved forward, the cursor stayed on its key
+        should.equal(readTxn.getString(budgetDbi, 5), 'Renewed');
+        cursor.getCurrentString(function(key) {
+          key.should.equal(2);
+        });
+        cursor.close();
+        readTxn.abort();
+        budgetDbi.close();
+        budgetEnv.close();
+        done();
+      }, 100);
+    });
+    it('will reuse released read-only transactions', function() {
+      var readTxn = env.acquireReadTxn();
+      should.equal(readTxn.getString(dbi, 2), 'Hello2');
+      readTxn.release();
+      (function() {
+        readTxn.getString(dbi, 2);
+      }).should.throw('The transaction is already closed.');
+
+      var writeTxn = env.beginTxn();
+      writeTxn.putString(dbi, 2, 'Hello2 again');
+      (function() {
+        writeTxn.release();
+      }).should.throw('Only read-only transactions can be released.');
+      writeTxn.commit();
+
+      // A released transaction stays closed, also once its handle is handed out again
+      var stale = env.acquireReadTxn();
+      stale.release();
+      var renewed = env.acquireReadTxn();
+      renewed.should.not.equal(stale);
+      (function() {
+        stale.release();
+      }).should.throw('The transaction is already closed.');
+      (function() {
+        stale.abort();
+      }).should.throw('The transaction is already closed.');
+      should.equal(renewed.getString(dbi, 2), 'Hello2 again');
+      renewed.release();
+
+      // A pooled handle is renewed, so it sees the latest commit
+      var txns = [];
+      for (var i = 0; i < 20; i++) {
+        txns.push(env.acquireReadTxn());
+      }
+      txns.forEach(function(txn) {
+        should.equal(txn.getString(dbi, 2), 'Hello2 again');
+        txn.release();
+      });
+      var txn = env.acquireReadTxn();
+      should.equal(txn.getString(dbi, 1), 'Ha ha ha');
+      txn.abort();
+    });
+    it('will share one reader slot among read-only transactions on the same snapshot', function() {
+      var countReaders = function() {
+        return env.readers().split('\n').filter(function(line) {
+          return /^\s*\d+/.test(line);
+        }).length;
+      };
+      var readersBefore = countReaders();
+      var txns = [];
+      for (var i = 0; i < 20; i++) {
+        txns.push(env.beginTxn({ readOnly: true }));
+      }
+      countReaders().should.be.at.most(readersBefore + 1);
+
+      var writeTxn = env.beginTxn();
+      writeTxn.putString(dbi, 2, 'Hello2 shared');
+      writeTxn.commit();
+
+      // A transaction started after the commit gets the new snapshot, the others keep theirs
+      var newTxn = env.beginTxn({ readOnly: true });
+      should.equal(newTxn.getString(dbi, 2), 'Hello2 shared');
+      should.equal(txns[0].getString(dbi, 2), 'Hello2 again');
+
+      // Resetting one of the transactions doesn't affect the others sharing its snapshot
+      txns[0].reset();
+      should.equal(txns[1].getString(dbi, 2), 'Hello2 again');
+      txns[0].renew();
+      should.equal(txns[0].getString(dbi, 2), 'Hello2 shared');
+
+      txns.forEach(function(txn) {
+        txn.abort();
+      });
+      should.equal(newTxn.getString(dbi, 2), 'Hello2 shared');
+      newTxn.abort();
+    });
+    it('will attach a read-only transaction to an exported snapshot', function() {
+      var readTxn = env.beginTxn({ readOnly: true });
+      var token = readTxn.exportSnapshot();
+      token.should.have.property('snapshotId');
+      token.should.have.property('txnId');
+
+      var writeTxn = env.beginTxn();
+      writeTxn.putString(dbi, 2, 'Hello2 exported');
+      (function() {
+        writeTxn.exportSnapshot();
+      }).should.throw('Only read-only transactions can export their snapshot.');
+      writeTxn.commit();
+
+      // Token objects are plain data, as they would be after postMessage to a worker
+      var attachedTxn = env.beginTxn({ snapshot: JSON.parse(JSON.stringify(token)) });
+      readTxn.abort();
+      should.equal(attachedTxn.getString(dbi, 2), 'Hello2 shared');
+      (function() {
+        attachedTxn.putString(dbi, 2, 'Hello2 attached');
+      }).should.throw();
+      attachedTxn.abort();
+
+      (function() {
+        env.beginTxn({ snapshot: token });
+      }).should.throw('The snapshot is no longer available, the transaction that exported it has ended or was reset.');
+
+      // The token of a transaction sharing its snapshot goes away when that transaction is reset, not when all of them are
+      var sharingTxns = [env.beginTxn({ readOnly: true }), env.beginTxn({ readOnly: true })];
+      var resetToken = sharingTxns[0].exportSnapshot();
+      var openToken = sharingTxns[1].exportSnapshot();
+      sharingTxns[0].reset();
+      (function() {
+        env.beginTxn({ snapshot: resetToken });
+      }).should.throw('The snapshot is no longer available, the transaction that exported it has ended or was reset.');
+      attachedTxn = env.beginTxn({ snapshot: openToken });
+      should.equal(attachedTxn.getString(dbi, 2), 'Hello2 exported');
+      attachedTxn.abort();
+      sharingTxns[1].abort();
+      (function() {
+        env.beginTxn({ snapshot: openToken });
+      }).should.throw('The snapshot is no longer available, the transaction that exported it has ended or was reset.');
+      sharingTxns[0].abort();
+    });
+    it('will share the environment and its databases with another Env of the same path', function() {
+      var env2 = new lmdb.Env();
+      env2.open({
+        path: testDirPath + '/../testdata/.',
+        maxDbs: 10
+      });
+      // The database and its key type come from the first Env
+      var dbi2 = env2.openDbi({ name: 'mydb4' });
+      var txn = env2.beginTxn({ readOnly: true });
+      should.equal(txn.getString(dbi2, 2), 'Hello2 exported');
+      txn.abort();
+
+      // Other flags than the ones the database was opened with are refused
+      (function() {
+        env2.openDbi({ name: 'mydb4', dupSort: true, keyIsUint32: true });
+      }).should.throw('MDB_INCOMPATIBLE');
+      (function() {
+        env2.openDbi({ name: 'mydb4', keyIsString: true });
+      }).should.throw('MDB_INCOMPATIBLE');
+
+      // Closing one Env keeps the environment open for the other one
+      env2.close();
+      txn = env.beginTxn({ readOnly: true });
+      should.equal(txn.getString(dbi, 2), 'Hello2 exported');
+      txn.abort();
+    });
   });
   describe('Cursors, basic operation', function() {
     this.timeout(10000);
@@ -514,6 +1109,22 @@ describe('Node.js LMDB Bindings', function() {
 
       done();
     });
+    it('will read ahead pages while the cursor scans', function () {
+      var txn = env.beginTxn({ readOnly: true });
+      var cursor = new lmdb.Cursor(txn, dbi, { readAhead: 16 });
+      var count = 0;
+      for (var key = cursor.goToFirst(); key; key = cursor.goToNext()) {
+        count++;
+      }
+      should.equal(count, total);
+      count = 0;
+      for (key = cursor.goToLast(); key; key = cursor.goToPrev()) {
+        count++;
+      }
+      should.equal(count, total);
+      cursor.close();
+      txn.abort();
+    });
     it('will move cursor over values, expects to get correct key even if key is binary', function (done) {
       var txn = env.beginTxn({ readOnly: true });
       var cursor = new lmdb.Cursor(txn, dbi);
@@ -659,6 +1270,121 @@ describe('Node.js LMDB Bindings', function() {
       cursor.close();
       txn.abort();
     });
+    it('will look up a sorted list of keys in one call', function() {
+      var txn = env.beginTxn({ readOnly: true });
+      var cursor = new lmdb.Cursor(txn, dbi);
+      var keys = [];
+      for (var i = 0; i < total + 10; i += 3) {
+        keys.push(i);
+      }
+      var values = cursor.seekMany(keys);
+      values.length.should.equal(keys.length);
+      keys.forEach(function(key, index) {
+        if (key < total) {
+          values[index].readDoubleBE().should.equal(key);
+        } else {
+          should.equal(values[index], null);
+        }
+      });
+      // Left on the last key that was found
+      cursor.getCurrentBinary(function(key) {
+        key.should.equal(999);
+      });
+      // Unsorted keys still resolve correctly
+      cursor.seekMany([500, 2, 999]).map(function(value) {
+        return value.readDoubleBE();
+      }).should.deep.equal([500, 2, 999]);
+      cursor.close();
+      txn.abort();
+    });
+    it('will insert between two pages through a positioned cursor', function() {
+      var gapDbi = env.openDbi({
+        name: 'gaps',
+        create: true,
+        keyIsUint32: true
+      });
+      var txn = env.beginTxn();
+      var cursor = new lmdb.Cursor(txn, gapDbi);
+      var value = Buffer.alloc(8, 1);
+      var count = 2000;
+      for (var i = 0; i < count; i++) {
+        txn.putBinary(gapDbi, i * 10, value);
+      }
+      // Whenever i * 10 is the last key on its page, i * 10 + 5 sorts
+      // between that page and the next one
+      for (i = 0; i < count; i++) {
+        cursor.goToKey(i * 10);
+        cursor.put(i * 10 + 5, value);
+      }
+      for (i = 0; i < count; i++) {
+        should.exist(txn.getBinary(gapDbi, i * 10 + 5));
+      }
+      cursor.close();
+      txn.abort();
+      gapDbi.drop();
+    });
+    it('will seek forward and backward from the current position', function() {
+      var txn = env.beginTxn({ readOnly: true });
+      var cursor = new lmdb.Cursor(txn, dbi);
+      var key;
+      cursor.goToFirst();
+      for (key = 0; key < total; key += 37) {
+        cursor.goToKey(key).should.equal(key);
+      }
+      for (key = total - 1; key >= 0; key -= 53) {
+        cursor.goToRange(key).should.equal(key);
+        cursor.getCurrentBinary(function(k, value) {
+          value.readDoubleBE().should.equal(key);
+        });
+      }
+      cursor.goToLast();
+      should.equal(cursor.goToKey(total + 5), null);
+      cursor.goToKey(3).should.equal(3);
+      cursor.close();
+      txn.abort();
+    });
+    it('will reuse cursors across read-only transactions', function() {
+      var txn = env.beginTxn({ readOnly: true });
+      var cursor = new lmdb.Cursor(txn, dbi);
+      cursor.goToKey(40).should.equal(40);
+      cursor.close();
+      (function() {
+        cursor.close();
+      }).should.throw('The cursor is already closed.');
+      txn.abort();
+
+      for (var i = 0; i < 5; i++) {
+        txn = env.beginTxn({ readOnly: true });
+        // Picks up the pooled cursor of the previous iteration
+        cursor = new lmdb.Cursor(txn, dbi);
+        cursor.goToKey(i).should.equal(i);
+        cursor.close();
+        txn.abort();
+      }
+
+      var txn1 = env.beginTxn({ readOnly: true });
+      cursor = new lmdb.Cursor(txn1, dbi);
+      cursor.goToLast().should.equal(total - 1);
+      var txn2 = env.beginTxn({ readOnly: true });
+      cursor.renew(txn2);
+      txn1.abort();
+      cursor.goToFirst().should.equal(0);
+      txn2.abort();
+
+      // A closed cursor can be rebound as well
+      cursor.close();
+      txn = env.beginTxn({ readOnly: true });
+      cursor.renew(txn);
+      cursor.goToKey(7).should.equal(7);
+      cursor.close();
+      txn.abort();
+
+      var wtxn = env.beginTxn();
+      (function() {
+        cursor.renew(wtxn);
+      }).should.throw('Only cursors of read-only transactions can be renewed.');
+      wtxn.abort();
+    });
   });
   describe('Cursors, dupsort', function() {
     this.timeout(10000);
@@ -1176,6 +1902,54 @@ describe('Node.js LMDB Bindings', function() {
         });
       });
     });
+    it('will read all data items of a key at once', function() {
+      var intDbi = env.openDbi({
+        name: 'mydb7int',
+        create: true,
+        dupSort: true,
+        dupFixed: true,
+        integerDup: true
+      });
+      var txn = env.beginTxn();
+      var value = Buffer.alloc(4);
+      for (var i = 0; i < 5000; i++) {
+        value.writeUInt32LE(i, 0);
+        txn.putBinary(intDbi, 'many', value);
+      }
+      value.writeUInt32LE(7, 0);
+      txn.putBinary(intDbi, 'one', value);
+      txn.commit();
+
+      var txn2 = env.beginTxn({readOnly: true});
+      var cursor = new lmdb.Cursor(txn2, intDbi);
+      cursor.goToKey('many');
+      var values = cursor.getMultiple();
+      values.should.be.instanceof(Uint32Array);
+      values.length.should.equal(5000);
+      for (var j = 0; j < values.length; j++) {
+        values[j].should.equal(j);
+      }
+      should.not.exist(cursor.goToNextDup());
+
+      cursor.goToKey('many');
+      var chunks = 0, total = 0;
+      for (var chunk = cursor.getCurrentMultiple({ arrayType: 'Buffer' }); chunk; chunk = cursor.goToNextMultiple({ arrayType: 'Buffer' })) {
+        chunks++;
+        total += chunk.length / 4;
+      }
+      chunks.should.be.above(1);
+      total.should.equal(5000);
+
+      cursor.goToKey('one');
+      var single = cursor.getMultiple({ arrayType: 'Int32Array' });
+      single.should.be.instanceof(Int32Array);
+      single.length.should.equal(1);
+      single[0].should.equal(7);
+      (function() { cursor.getMultiple({ arrayType: 'Float64Array' }); }).should.throw();
+      cursor.close();
+      txn2.abort();
+      intDbi.drop();
+    });
   });
   describe('Memory Freeing / Garbage Collection', function() {
     it('should not cause a segment fault', function(done) {